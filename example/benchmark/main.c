@@ -0,0 +1,724 @@
+/// \file main.c
+/// \brief Example: cycle count benchmark of driver and algorithmes
+/// \details Cycles are measured by \c DWT->CYCCNT. Results are printed to USART1 as CSV:
+/// \details \c i2c, \c odr, \c function, \c calls, \c busy, \c errors, \c min, \c mean, \c max (cycles per call)
+/// \details Rows \c bus_* measure plain HAL transfer of the same size: bus time of appropriate API
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "main.h"
+#include <stdio.h>
+
+#include "log.h"
+#include "lsm303dlhc.h"
+#include "lsm303algo.h"
+#include "lsm303fixed.h"
+#include "lsm303dec.h"
+
+#define CALLS 256U      // measured calls of every function
+#define WARMUP 64U      // calls before measurement for filters setup
+#define BLOCK 32U       // block size of *_block functions
+
+I2C_HandleTypeDef hi2c3;
+DMA_HandleTypeDef hdma_i2c3_rx;
+UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
+
+void SystemClock_Config(void);
+static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
+static void MX_I2C3_Init(void);
+static void MX_USART1_UART_Init(void);
+
+// Statistics of one function
+typedef struct {
+    uint32_t calls;
+    uint32_t busy;
+    uint32_t errors;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} bench_t;
+
+// I2C timing for I2CCLK = 4 MHz (MSI range 6)
+typedef struct {
+    const char* name;
+    uint32_t timing;
+    uint8_t fmp;
+} bench_i2c_t;
+
+static const bench_i2c_t timings_[] = {
+    { "sm100", 0x00100D14, 0U },    // Standard-mode 100 kHz (CubeMX)
+    { "fm400", 0x00100205, 0U },    // Fast-mode ~400 kHz
+    { "fmp1000", 0x00000001, 1U },  // Fast-mode Plus ~660 kHz at 4 MHz: above LSM303DLHC specification, errors are expected
+};
+
+typedef struct {
+    const char* name;
+    lsm303_la_datarate_t odr;
+} bench_la_odr_t;
+
+static const bench_la_odr_t la_odr_[] = {
+    { "a10", LSM303_ADATARATE_10 },
+    { "a100", LSM303_ADATARATE_100 },
+    { "a400", LSM303_ADATARATE_400 },
+    { "a1344", LSM303_ADATARATE_SPEC },
+};
+
+typedef struct {
+    const char* name;
+    lsm303_mf_do_t odr;
+} bench_mf_odr_t;
+
+static const bench_mf_odr_t mf_odr_[] = {
+    { "m15", LSM303_MDATARATE_15 },
+    { "m75", LSM303_MDATARATE_75 },
+    { "m220", LSM303_MDATARATE_220 },
+};
+
+static uint32_t overhead_ = 0U;     // measurement overhead
+static volatile float sink_ = 0.0F; // keep results of algorithmes
+static volatile uint8_t done_ = 0U; // asynchronous transfer complete
+static volatile uint32_t stop_ = 0U;// cycle counter on transfer complete
+static uint8_t async_st_ = HAL_OK;
+
+static float a_[CALLS][3] = { 0 };  // accelerometer data for algorithmes
+static float m_[CALLS][3] = { 0 };  // magnetometer data for algorithmes
+static float as_[3][CALLS] = { 0 }; // accelerometer data for *_block functions
+static float ms_[3][CALLS] = { 0 }; // magnetometer data for *_block functions
+static int16_t ar_[3][CALLS] = { 0 };
+static int16_t mr_[3][CALLS] = { 0 };
+static int16_t fifo_[LSM303_FIFO_SIZE * 3] = { 0 };
+static lsm303_sample_t samples_[LSM303_FIFO_SIZE] = { 0 };
+
+#define BENCH(b, call) do {                                 \
+        const uint32_t t0_ = DWT->CYCCNT;                   \
+        const uint8_t r_ = (call);                          \
+        bench_add(&(b), DWT->CYCCNT - t0_, r_);             \
+    } while (0)
+
+#define BENCHV(b, stmt) do {                                \
+        const uint32_t t0_ = DWT->CYCCNT;                   \
+        stmt;                                               \
+        bench_add(&(b), DWT->CYCCNT - t0_, HAL_OK);         \
+    } while (0)
+
+static void bench_reset(bench_t* b)
+{
+    b->calls = 0U;
+    b->busy = 0U;
+    b->errors = 0U;
+    b->min = UINT32_MAX;
+    b->max = 0U;
+    b->sum = 0U;
+}
+
+static void bench_add(bench_t* b, uint32_t cycles, const uint8_t status)
+{
+    cycles = (cycles > overhead_) ? cycles - overhead_ : 0U;
+    if (status == HAL_BUSY) {
+        b->busy++;
+        return;
+    }
+    if (status != HAL_OK) {
+        b->errors++;
+        return;
+    }
+    b->calls++;
+    b->sum += cycles;
+    if (cycles < b->min) b->min = cycles;
+    if (cycles > b->max) b->max = cycles;
+}
+
+static void bench_print(const char* i2c, const char* odr, const char* name, const bench_t* b)
+{
+    char buf[128];
+    const uint32_t mean = b->calls ? (uint32_t)(b->sum / b->calls) : 0U;
+    const uint32_t min = b->calls ? b->min : 0U;
+    const int sz = snprintf(&buf[0], sizeof(buf), "%s,%s,%s,%lu,%lu,%lu,%lu,%lu,%lu\n", i2c, odr, name,
+        (unsigned long)b->calls, (unsigned long)b->busy, (unsigned long)b->errors,
+        (unsigned long)min, (unsigned long)mean, (unsigned long)b->max);
+    HAL_UART_Transmit(&huart1, (uint8_t*)&buf[0], (uint16_t)sz, 1000);
+}
+
+static void bench_cb(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const uint8_t status, const float x, const float y, const float z)
+{
+    stop_ = DWT->CYCCNT;
+    async_st_ = status;
+    sink_ = x + y + z;
+    done_ = 1U;
+}
+
+// Reinitialization of I2C with new timing
+static uint8_t bench_i2c(const bench_i2c_t* t)
+{
+    HAL_I2C_DeInit(&hi2c3);
+    hi2c3.Init.Timing = t->timing;
+    if (HAL_I2C_Init(&hi2c3) != HAL_OK) return HAL_ERROR;
+    if (HAL_I2CEx_ConfigAnalogFilter(&hi2c3, I2C_ANALOGFILTER_ENABLE) != HAL_OK) return HAL_ERROR;
+    if (HAL_I2CEx_ConfigDigitalFilter(&hi2c3, 0) != HAL_OK) return HAL_ERROR;
+    if (t->fmp) HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C3);
+    else HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C3);
+    HAL_NVIC_SetPriority(I2C3_EV_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(I2C3_EV_IRQn);
+    HAL_NVIC_SetPriority(I2C3_ER_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(I2C3_ER_IRQn);
+    return HAL_OK;
+}
+
+// Asynchronous read: cycles from start to completion callback
+static void bench_async(const char* i2c, const char* odr, const char* name, const lsm303_sensor_t sensor, const lsm303_async_t mode)
+{
+    bench_t b;
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) {
+        done_ = 0U;
+        const uint32_t t0 = DWT->CYCCNT;
+        uint8_t ret = (sensor == LSM303_LA) ? lsm303_la_async(&lsm303, mode, bench_cb) : lsm303_mf_async(&lsm303, mode, bench_cb);
+        if (ret == HAL_OK) {
+            const uint32_t tick = HAL_GetTick();
+            while (!done_ && HAL_GetTick() - tick < 10U);
+            ret = done_ ? async_st_ : HAL_TIMEOUT;
+        }
+        bench_add(&b, (ret == HAL_OK) ? stop_ - t0 : 0U, ret);
+    }
+    bench_print(i2c, odr, name, &b);
+}
+
+// Plain HAL transfer of size bytes
+static void bench_bus(const char* i2c, const char* odr, const char* name, const uint16_t sad, const uint8_t reg, const uint16_t size)
+{
+    static uint8_t buf[LSM303_FIFO_SIZE * 6];
+    // HAL timeout bounds the whole transfer: 10 ms and transfer time budget at 100 kHz, as blocking transfers of library
+    const uint32_t timeout = 10U + (size + LSM303_TIMEOUT_RATE - 1U) / LSM303_TIMEOUT_RATE;
+    bench_t b;
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) {
+        BENCH(b, HAL_I2C_Mem_Read(&hi2c3, sad, reg, I2C_MEMADD_SIZE_8BIT, &buf[0], size, timeout));
+    }
+    bench_print(i2c, odr, name, &b);
+}
+
+static void bench_la(const char* i2c, const char* odr)
+{
+    bench_t b;
+    float x, y, z;
+    int16_t rx, ry, rz;
+    uint8_t sr;
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_la_raw(&lsm303, &rx, &ry, &rz));
+    bench_print(i2c, odr, "lsm303_la_raw", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_la_rawsr(&lsm303, &rx, &ry, &rz, &sr));
+    bench_print(i2c, odr, "lsm303_la_rawsr", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_la_read(&lsm303, &x, &y, &z));
+    bench_print(i2c, odr, "lsm303_la_read", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_la_readsr(&lsm303, &x, &y, &z, &sr));
+    bench_print(i2c, odr, "lsm303_la_readsr", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_la_sample(&lsm303, &samples_[0]));
+    bench_print(i2c, odr, "lsm303_la_sample", &b);
+    bench_bus(i2c, odr, "bus_la7", 0x32, 0xA7, 7U);
+    bench_async(i2c, odr, "lsm303_la_async_it", LSM303_LA, LSM303_ASYNC_IT);
+    bench_async(i2c, odr, "lsm303_la_async_dma", LSM303_LA, LSM303_ASYNC_DMA);
+}
+
+static void bench_fifo(const char* i2c, const char* odr, const uint32_t period)
+{
+    bench_t b;
+    uint8_t cnt = 0U;
+    float x[LSM303_FIFO_SIZE], y[LSM303_FIFO_SIZE], z[LSM303_FIFO_SIZE];
+    bench_reset(&b);
+    if (lsm303_la_fifo(&lsm303, LSM303_AFIFO_STREAM, 0U, 0U) != HAL_OK) b.errors++;
+    for (uint32_t i = 0; i < 16U; ++i) {
+        HAL_Delay(period);  // FIFO is full
+        BENCH(b, lsm303_la_fifo_read(&lsm303, &fifo_[0], LSM303_FIFO_SIZE, &cnt));
+    }
+    bench_print(i2c, odr, "lsm303_la_fifo_read", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCHV(b, lsm303_la_soa(&lsm303, &fifo_[0], LSM303_FIFO_SIZE, &x[0], &y[0], &z[0]));
+    bench_print(i2c, odr, "lsm303_la_soa", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < 16U; ++i) {
+        HAL_Delay(period);  // FIFO is full
+        BENCH(b, lsm303_la_fifo_samples(&lsm303, &samples_[0], LSM303_FIFO_SIZE, &cnt));
+    }
+    bench_print(i2c, odr, "lsm303_la_fifo_samples", &b);
+    lsm303_la_fifo(&lsm303, LSM303_AFIFO_BYPASS, 0U, 0U);
+    bench_bus(i2c, odr, "bus_fifo192", 0x32, 0xA8, LSM303_FIFO_SIZE * 6U);
+}
+
+static void bench_mf(const char* i2c, const char* odr)
+{
+    bench_t b;
+    float x, y, z;
+    int16_t rx, ry, rz;
+    uint8_t sr;
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_mf_raw(&lsm303, &rx, &ry, &rz));
+    bench_print(i2c, odr, "lsm303_mf_raw", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_mf_rawsr(&lsm303, &rx, &ry, &rz, &sr));
+    bench_print(i2c, odr, "lsm303_mf_rawsr", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_mf_read(&lsm303, &x, &y, &z));
+    bench_print(i2c, odr, "lsm303_mf_read", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_mf_readsr(&lsm303, &x, &y, &z, &sr));
+    bench_print(i2c, odr, "lsm303_mf_readsr", &b);
+    bench_reset(&b);
+    for (uint32_t i = 0; i < CALLS; ++i) BENCH(b, lsm303_mf_sample(&lsm303, &samples_[0]));
+    bench_print(i2c, odr, "lsm303_mf_sample", &b);
+    bench_bus(i2c, odr, "bus_mf7", 0x3C, 0x03, 7U);
+    bench_async(i2c, odr, "lsm303_mf_async_it", LSM303_MF, LSM303_ASYNC_IT);
+    bench_async(i2c, odr, "lsm303_mf_async_dma", LSM303_MF, LSM303_ASYNC_DMA);
+}
+
+// Input data for algorithmes
+static void bench_data(void)
+{
+    uint32_t i = 0U;
+    const uint32_t tick = HAL_GetTick();
+    while (i < CALLS && HAL_GetTick() - tick < 5000U) {
+        if (lsm303_la_raw(&lsm303, &ar_[0][i], &ar_[1][i], &ar_[2][i]) != HAL_OK) continue;
+        if (lsm303_mf_raw(&lsm303, &mr_[0][i], &mr_[1][i], &mr_[2][i]) != HAL_OK) continue;
+        for (uint8_t c = 0; c < 3; ++c) {
+            a_[i][c] = as_[c][i] = (float)ar_[c][i] * lsm303.alsb;
+            m_[i][c] = ms_[c][i] = (float)mr_[c][i] / (c == 2 ? lsm303.mlsb_z : lsm303.mlsb_xy) * 100.0F;
+        }
+        ++i;
+    }
+}
+
+#define BENCH_STEP(name, init, call) do {                                   \
+        bench_reset(&b);                                                    \
+        init;                                                               \
+        for (j = 0; j < WARMUP; ++j) sink_ = (float)(call);                \
+        for (j = 0; j < CALLS; ++j) BENCHV(b, sink_ = (float)(call));      \
+        bench_print("-", "-", name, &b);                                    \
+    } while (0)
+
+static void bench_algo(void)
+{
+    bench_t b;
+    float p, r, y;
+    float R[3][3], q[4];
+    const float A = getAlpha(200.0F, 1.0F);
+    const float H = getAlpha(200.0F, 30.0F);
+    lsm303_motion_lp_t mlp;
+    lsm303_motion_k_t mk;
+    lsm303_distortion_hp_t dhp;
+    lsm303_distortion_lp_t dlp;
+    lsm303_orient_lp_t olp;
+    lsm303_orient_k_t ok;
+    lsm303_incline_lp_t ilp;
+    lsm303_fall_t fall;
+    lsm303_motion_lp_q_t mlpq;
+    lsm303_motion_k_q_t mkq;
+    lsm303_distortion_hp_q_t dhpq;
+    lsm303_distortion_lp_q_t dlpq;
+    lsm303_fall_q_t fallq;
+    const float mlsb = 100.0F / lsm303.mlsb_xy;
+    static float dech[64], decbuf[LSM303_DEC_BUF(64)];
+    lsm303_dec_t dec;
+    float dv[3];
+    lsm303_dec_design(dech, 64U, 1344.0F, 40.0F);
+
+#define I (j % CALLS)
+#define AV a_[I][0], a_[I][1], a_[I][2]
+#define MV m_[I][0], m_[I][1], m_[I][2]
+#define AR ar_[0][I], ar_[1][I], ar_[2][I]
+#define MR mr_[0][I], mr_[1][I], mr_[2][I]
+#define A3 a_[I]
+#define M3 m_[I]
+    uint32_t j = 0U;
+    BENCH_STEP("motionLP_step", motionLP_init(&mlp, A, 0.1F, 20U), motionLP_step(&mlp, AV));
+    BENCH_STEP("motionLP", (void)0, motionLP(AV, A, 0.1F, 20U));
+    BENCH_STEP("motionK_step", motionK_init(&mk, 0.2F, 1.9F, 1.0F, 0.1F, 20U), motionK_step(&mk, AV));
+    BENCH_STEP("motionK", (void)0, motionK(AV, 0.2F, 1.9F, 1.0F, 0.1F, 20U));
+    BENCH_STEP("distortionHP_step", distortionHP_init(&dhp, H, 1.6F), distortionHP_step(&dhp, MV));
+    BENCH_STEP("distortionHP", (void)0, distortionHP(MV, H, 1.6F));
+    BENCH_STEP("distortionLP_step", distortionLP_init(&dlp, A, 1.6F), distortionLP_step(&dlp, MV));
+    BENCH_STEP("distortionLP", (void)0, distortionLP(MV, A, 1.6F));
+    BENCH_STEP("orientLP_step", orientLP_init(&olp, 0.1F), orientLP_step(&olp, A3, M3, &p, &r, &y));
+    BENCH_STEP("orientLP", (void)0, orientLP(A3, M3, 0.1F, &p, &r, &y));
+    BENCH_STEP("orientK_step", orientK_init(&ok, 0.2F, 1.9F, 1.0F), orientK_step(&ok, A3, M3, &p, &r, &y));
+    BENCH_STEP("orientK", (void)0, orientK(A3, M3, 0.2F, 1.9F, 1.0F, &p, &r, &y));
+    BENCH_STEP("orientLP_dcm", orientLP_init(&olp, 0.1F), orientLP_dcm(&olp, A3, M3, R));
+    BENCH_STEP("orientK_dcm", orientK_init(&ok, 0.2F, 1.9F, 1.0F), orientK_dcm(&ok, A3, M3, R));
+    BENCH_STEP("lsm303_triad", (void)0, lsm303_triad(A3, M3, R));
+    BENCH_STEP("lsm303_dcm2quat", (void)0, (lsm303_dcm2quat(R, q), q[0]));
+    BENCH_STEP("lsm303_dcm2euler", (void)0, (lsm303_dcm2euler(R, &p, &r, &y), y));
+    BENCH_STEP("inclineLP_step", inclineLP_init(&ilp, 0.1F, 90.0F), inclineLP_step(&ilp, AV));
+    BENCH_STEP("inclineLP", (void)0, inclineLP(AV, 0.1F, 90.0F));
+    BENCH_STEP("detectFall_step", detectFall_init(&fall, 0.3F, 2.0F), detectFall_step(&fall, AV));
+    BENCH_STEP("detectFall", (void)0, detectFall(AV, 0.3F, 2.0F));
+    BENCH_STEP("getAlpha", (void)0, getAlpha(200.0F + (float)I, 1.0F));
+    // decimator: 64 taps, factor 16 (1344 Hz -> 84 Hz), mean cycles per input sample
+    BENCH_STEP("lsm303_dec_step", lsm303_dec_init(&dec, dech, 64U, 16U, decbuf), lsm303_dec_step(&dec, AV, dv));
+    // fixed-point
+    BENCH_STEP("motionLPq_step", motionLPq_init(&mlpq, A, 0.1F, lsm303.alsb, 20U), motionLPq_step(&mlpq, AR));
+    BENCH_STEP("motionKq_step", motionKq_init(&mkq, 0.2F, 1.9F, 1.0F, 0.1F, lsm303.alsb, 20U), motionKq_step(&mkq, AR));
+    BENCH_STEP("distortionHPq_step", distortionHPq_init(&dhpq, H, 1.6F, mlsb), distortionHPq_step(&dhpq, MR));
+    BENCH_STEP("distortionLPq_step", distortionLPq_init(&dlpq, A, 1.6F, mlsb), distortionLPq_step(&dlpq, MR));
+    BENCH_STEP("detectFallq_step", detectFallq_init(&fallq, 0.3F, 2.0F, lsm303.alsb), detectFallq_step(&fallq, AR));
+    // blocks: cycles per block of BLOCK samples
+    bench_reset(&b);
+    motionLP_init(&mlp, A, 0.1F, 20U);
+    for (j = 0; j < CALLS - BLOCK; j += 4U) {
+        const lsm303_block_t blk = { &as_[0][j], &as_[1][j], &as_[2][j] };
+        BENCHV(b, sink_ = motionLP_block(&mlp, &blk, BLOCK));
+    }
+    bench_print("-", "-", "motionLP_block32", &b);
+    bench_reset(&b);
+    motionK_init(&mk, 0.2F, 1.9F, 1.0F, 0.1F, 20U);
+    for (j = 0; j < CALLS - BLOCK; j += 4U) {
+        const lsm303_block_t blk = { &as_[0][j], &as_[1][j], &as_[2][j] };
+        BENCHV(b, sink_ = motionK_block(&mk, &blk, BLOCK));
+    }
+    bench_print("-", "-", "motionK_block32", &b);
+    bench_reset(&b);
+    orientLP_init(&olp, 0.1F);
+    for (j = 0; j < CALLS - BLOCK; j += 4U) {
+        const lsm303_block_t blka = { &as_[0][j], &as_[1][j], &as_[2][j] };
+        const lsm303_block_t blkm = { &ms_[0][j], &ms_[1][j], &ms_[2][j] };
+        BENCHV(b, sink_ = orientLP_block(&olp, &blka, &blkm, BLOCK, &p, &r, &y));
+    }
+    bench_print("-", "-", "orientLP_block32", &b);
+    bench_reset(&b);
+    orientK_init(&ok, 0.2F, 1.9F, 1.0F);
+    for (j = 0; j < CALLS - BLOCK; j += 4U) {
+        const lsm303_block_t blka = { &as_[0][j], &as_[1][j], &as_[2][j] };
+        const lsm303_block_t blkm = { &ms_[0][j], &ms_[1][j], &ms_[2][j] };
+        BENCHV(b, sink_ = orientK_block(&ok, &blka, &blkm, BLOCK, &p, &r, &y));
+    }
+    bench_print("-", "-", "orientK_block32", &b);
+#undef I
+#undef AV
+#undef MV
+#undef AR
+#undef MR
+#undef A3
+#undef M3
+}
+
+int main(void)
+{
+  HAL_Init();
+  SystemClock_Config();
+  MX_GPIO_Init();
+  MX_DMA_Init();
+  MX_I2C3_Init();
+  MX_USART1_UART_Init();
+
+  // setup
+  HAL_Delay(2000);
+
+  // Log Off: no log messages in measurements, build with -DLSM303_LOG_LEVEL=0
+  setlog(0);
+
+  // Cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0U;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  // Measurement overhead
+  bench_t b;
+  bench_reset(&b);
+  for (uint32_t i = 0; i < CALLS; ++i) BENCHV(b, __NOP());
+  overhead_ = b.min;
+
+  char buf[64];
+  int sz = snprintf(&buf[0], sizeof(buf), "# cpu_hz,%lu,overhead,%lu\n", (unsigned long)SystemCoreClock, (unsigned long)overhead_);
+  HAL_UART_Transmit(&huart1, (uint8_t*)&buf[0], (uint16_t)sz, 1000);
+  sz = snprintf(&buf[0], sizeof(buf), "i2c,odr,function,calls,busy,errors,min,mean,max\n");
+  HAL_UART_Transmit(&huart1, (uint8_t*)&buf[0], (uint16_t)sz, 1000);
+
+  // LSM303DLHC on I2C3
+  lsm303_init(&lsm303, &hi2c3);
+
+  for (uint8_t t = 0; t < sizeof(timings_) / sizeof(timings_[0]); ++t) {
+    const char* const i2c = timings_[t].name;
+    if (bench_i2c(&timings_[t]) != HAL_OK) continue;
+    // Accelerometer
+    for (uint8_t o = 0; o < sizeof(la_odr_) / sizeof(la_odr_[0]); ++o) {
+      if (lsm303_la_setup(&lsm303, la_odr_[o].odr, 0U, 1U, LSM303_AFS_4G) != HAL_OK) continue;
+      HAL_Delay(20);
+      bench_la(i2c, la_odr_[o].name);
+      // FIFO is full after 32 samples
+      if (la_odr_[o].odr >= LSM303_ADATARATE_100) bench_fifo(i2c, la_odr_[o].name, la_odr_[o].odr == LSM303_ADATARATE_100 ? 330U : 100U);
+    }
+    // Magnetometer
+    for (uint8_t o = 0; o < sizeof(mf_odr_) / sizeof(mf_odr_[0]); ++o) {
+      if (lsm303_mf_setup(&lsm303, 0U, mf_odr_[o].odr, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) continue;
+      HAL_Delay(20);
+      bench_mf(i2c, mf_odr_[o].name);
+    }
+  }
+
+  // Algorithmes with default timing
+  bench_i2c(&timings_[0]);
+  lsm303_la_setup(&lsm303, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G);
+  lsm303_mf_setup(&lsm303, 0U, LSM303_MDATARATE_220, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS);
+  bench_data();
+  bench_algo();
+
+  sz = snprintf(&buf[0], sizeof(buf), "# done\n");
+  HAL_UART_Transmit(&huart1, (uint8_t*)&buf[0], (uint16_t)sz, 1000);
+  while (1);
+  return 0;
+}
+
+/**
+  * @brief DMA Initialization Function: I2C3_RX on DMA1 Channel 3
+  * @param None
+  * @retval None
+  */
+static void MX_DMA_Init(void)
+{
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  hdma_i2c3_rx.Instance = DMA1_Channel3;
+  hdma_i2c3_rx.Init.Request = DMA_REQUEST_3;
+  hdma_i2c3_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_i2c3_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_i2c3_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_i2c3_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_i2c3_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_i2c3_rx.Init.Mode = DMA_NORMAL;
+  hdma_i2c3_rx.Init.Priority = DMA_PRIORITY_LOW;
+  if (HAL_DMA_Init(&hdma_i2c3_rx) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  __HAL_LINKDMA(&hi2c3, hdmarx, hdma_i2c3_rx);
+
+  HAL_NVIC_SetPriority(DMA1_Channel3_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+}
+
+void I2C3_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&hi2c3);
+}
+
+void I2C3_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&hi2c3);
+}
+
+void DMA1_Channel3_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_i2c3_rx);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  lsm303_rx_cplt(&lsm303, hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  lsm303_rx_error(&lsm303, hi2c);
+}
+
+/**
+  * @brief System Clock Configuration
+  * @retval None
+  */
+void SystemClock_Config(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+  /** Configure the main internal regulator output voltage
+  */
+  if (HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the RCC Oscillators according to the specified parameters
+  * in the RCC_OscInitTypeDef structure.
+  */
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+  RCC_OscInitStruct.MSIState = RCC_MSI_ON;
+  RCC_OscInitStruct.MSICalibrationValue = 0;
+  RCC_OscInitStruct.MSIClockRange = RCC_MSIRANGE_6;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the CPU, AHB and APB buses clocks
+  */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_MSI;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief I2C3 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_I2C3_Init(void)
+{
+
+  /* USER CODE BEGIN I2C3_Init 0 */
+
+  /* USER CODE END I2C3_Init 0 */
+
+  /* USER CODE BEGIN I2C3_Init 1 */
+
+  /* USER CODE END I2C3_Init 1 */
+  hi2c3.Instance = I2C3;
+  hi2c3.Init.Timing = 0x00100D14;
+  hi2c3.Init.OwnAddress1 = 0;
+  hi2c3.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  hi2c3.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+  hi2c3.Init.OwnAddress2 = 0;
+  hi2c3.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+  hi2c3.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+  hi2c3.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+  if (HAL_I2C_Init(&hi2c3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Analogue filter
+  */
+  if (HAL_I2CEx_ConfigAnalogFilter(&hi2c3, I2C_ANALOGFILTER_ENABLE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Digital filter
+  */
+  if (HAL_I2CEx_ConfigDigitalFilter(&hi2c3, 0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN I2C3_Init 2 */
+
+  /* USER CODE END I2C3_Init 2 */
+
+}
+
+/**
+  * @brief USART1 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_USART1_UART_Init(void)
+{
+
+  /* USER CODE BEGIN USART1_Init 0 */
+
+  /* USER CODE END USART1_Init 0 */
+
+  /* USER CODE BEGIN USART1_Init 1 */
+
+  /* USER CODE END USART1_Init 1 */
+  huart1.Instance = USART1;
+  huart1.Init.BaudRate = 115200;
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;
+  huart1.Init.StopBits = UART_STOPBITS_1;
+  huart1.Init.Parity = UART_PARITY_NONE;
+  huart1.Init.Mode = UART_MODE_TX_RX;
+  huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+  huart1.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart1.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  if (HAL_UART_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN USART1_Init 2 */
+
+  /* USER CODE END USART1_Init 2 */
+
+}
+
+/**
+  * @brief GPIO Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_GPIO_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+/* USER CODE BEGIN MX_GPIO_Init_1 */
+/* USER CODE END MX_GPIO_Init_1 */
+
+  /* GPIO Ports Clock Enable */
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+
+  /*Configure GPIO pins : INT1_Pin INT2_Pin */
+  GPIO_InitStruct.Pin = INT1_Pin|INT2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+/* USER CODE BEGIN MX_GPIO_Init_2 */
+/* USER CODE END MX_GPIO_Init_2 */
+}
+
+/* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
+
+/* USER CODE END 4 */
+
+/**
+  * @brief  This function is executed in case of error occurrence.
+  * @retval None
+  */
+void Error_Handler(void)
+{
+  /* USER CODE BEGIN Error_Handler_Debug */
+  /* User can add his own implementation to report the HAL error return state */
+  __disable_irq();
+  while (1)
+  {
+  }
+  /* USER CODE END Error_Handler_Debug */
+}
+
+#ifdef  USE_FULL_ASSERT
+/**
+  * @brief  Reports the name of the source file and the source line number
+  *         where the assert_param error has occurred.
+  * @param  file: pointer to the source file name
+  * @param  line: assert_param error line source number
+  * @retval None
+  */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+  /* USER CODE BEGIN 6 */
+  /* User can add his own implementation to report the file name and line number,
+     ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
+  /* USER CODE END 6 */
+}
+#endif /* USE_FULL_ASSERT */
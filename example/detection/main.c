@@ -12,6 +12,7 @@
 
 I2C_HandleTypeDef hi2c3;
 UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
 
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
@@ -32,65 +33,62 @@ int main(void)
   // Log On
   setlog(&huart1);
 
+  // LSM303DLHC on I2C3
+  lsm303_init(&lsm303, &hi2c3);
+  // Bus recovery pins: SCL PA7, SDA PB4
+  lsm303_bus(&lsm303, GPIOA, GPIO_PIN_7, GPIOB, GPIO_PIN_4);
+
   // Accelerometer setup
-  if (lsm303_la_setup(&hi2c3, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
+  // Retry after bus recovery: sensor may hold SDA low after MCU reset
+  while (lsm303_la_setup(&lsm303, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
     xError("LSM303DLHC Accelerometer Setup Error!\n");
-    while (1);
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
   }
 
   // Magnetometer setup
-  if (lsm303_mf_setup(&hi2c3, 0U, LSM303_MDATARATE_220, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) {
+  while (lsm303_mf_setup(&lsm303, 0U, LSM303_MDATARATE_220, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) {
     xError("LSM303DLHC Magnetometer Setup Error!\n");
-    while (1);
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
   }
   
-  typedef struct {
-    float x;
-    float y;
-    float z;
-  } axis_t;
-  
-  axis_t a = { 0 };   // Accelerometer axis
-  axis_t m = { 0 };   // Magnetic axis
+  lsm303_sample_t a = { 0 };  // Accelerometer axis
+  lsm303_sample_t m = { 0 };  // Magnetic axis
   float angle = 0.0;  // initial angle
   
   while (1) {
-    if (lsm303_la_read(&hi2c3, &a.x, &a.y, &a.z) != HAL_OK) continue;
+    if (lsm303_la_sample(&lsm303, &a) != HAL_OK) continue;
     if ((angle = inclineLP(a.x, a.y, a.z, 0.01618, 0.0)) != 0.0) break;
   }
   
-  // Low-pass filter
-  const float A = getAlpha(200.0, 1.0);  // Coefficient (alpha)
-  const float T = 0.1F;  // Threshould (delta)
-
-  // Kalmann filter
-  const float Q = 0.2F; // Process covariance
-  const float R = 1.9F; // Measurement covariance
-  const float E = 1.0F; // Error prediction
-  const float D = 0.1F; // Threshould (delta)
-
-  const uint8_t S = 20;  // Measurement samples ~ 50ms
-  
+  // Detector pipeline: one filter pass per sample for all accelerometer detectors
+  const float A = getAlpha(200.0, 1.0);  // Low-pass filter coefficient (alpha)
+  const uint8_t S = 20;                  // Measurement samples ~ 50ms
+  lsm303_pipe_t pipe;
+  lsm303_pipe_init(&pipe);
+  lsm303_pipe_lp(&pipe, LSM303_LA, A);
+  uint8_t motion, incline, fall;
+  lsm303_pipe_add(&pipe, LSM303_LA, LSM303_PIPE_MOTION, 0.1F, 0.0F, S, &motion);             // 0.1g
+  lsm303_pipe_add(&pipe, LSM303_LA, LSM303_PIPE_INCLINE, angle + 5.0F, 0.0F, 0U, &incline);  // 5 degree of initial angle
+  lsm303_pipe_add(&pipe, LSM303_LA, LSM303_PIPE_FALL, 0.3F, 2.0F, 0U, &fall);                // 0.3g, impact 2g
+  // Magnetic field distortion by high-pass filter: pipeline streams are low-pass or Kalman filtered
   const float H = getAlpha(200.0, 30.0); // High-pass filter alpha
-  
-  for (uint8_t i = 0; i < CNTSETUP * 2; i++) {
-    if (lsm303_la_read(&hi2c3, &a.x, &a.y, &a.z) != HAL_OK) continue;
-    if (lsm303_mf_read(&hi2c3, &m.x, &m.y, &m.z) != HAL_OK) continue;
-    motionLP(a.x, a.y, a.z, A, T, S);
-    motionK(a.x, -a.z, -a.y, Q, R, E, D, S);
-  }
+  lsm303_distortion_hp_t dhp;
+  distortionHP_init(&dhp, H, 1.6F);      // 1.6 uT
+  float d = 0.0F;
 
-  angle += 5.0F;  // incline more then 5 degree of initial angle
   // loop
   while (1) {
     // read
-    if (lsm303_la_read(&hi2c3, &a.x, &a.y, &a.z) != HAL_OK) continue;
-    if (lsm303_mf_read(&hi2c3, &m.x, &m.y, &m.z) != HAL_OK) continue;
+    if (lsm303_la_sample(&lsm303, &a) != HAL_OK) continue;
+    if (lsm303_mf_sample(&lsm303, &m) != HAL_OK) continue;
     // detection
-    motionLP(a.x, a.y, a.z, A, T, S);
-    motionK(a.x, a.y, a.z, Q, R, E, D, S);
-    distortionHP(m.x, m.y, m.z, H, 1.6);
-    inclineLP(a.x, a.y, a.z, 0.1618, angle);
+    const uint32_t ev = lsm303_pipe_step(&pipe, LSM303_LA, a.x, a.y, a.z);
+    if (ev & (1UL << motion)) xDebug("Motion: %f\n", pipe.d[motion].value);
+    if (ev & (1UL << incline)) xDebug("Incline: %.02f\n", pipe.d[incline].value);
+    if (ev & (1UL << fall)) xDebug("Fall: %f\n", pipe.d[fall].value);
+    if ((d = distortionHP_step(&dhp, m.x, m.y, m.z)) != 0.0F) xDebug("Distortion: %f\n", d);
   }
   return 0;
 }
@@ -255,6 +253,10 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
 
 /* USER CODE END 4 */
 
@@ -1,5 +1,5 @@
 /// \file main.c
-/// \brief Example: using interrupt for detect motion or weightlessness (free fall) by LSM303DLHC
+/// \brief Example: using interrupt for detect motion, free fall and double click by LSM303DLHC
 /// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
 ///	\author Oleksandr Ilushenko
 ///	\date 2024
@@ -8,16 +8,22 @@
 
 #include "log.h"
 #include "lsm303dlhc.h"
+#include "lsm303adapt.h"
 
 I2C_HandleTypeDef hi2c3;
 UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
 
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_I2C3_Init(void);
 static void MX_USART1_UART_Init(void);
+static uint8_t events_setup(void);
 
-volatile uint8_t irq1_ = 0U;
+// Interrupt pins raised: sources are read in the main loop, not by blocking I2C in interrupt handler
+volatile uint8_t int1_ = 0U;
+volatile uint8_t int2_ = 0U;
+uint8_t irq1_ = 0U;
 
 int main(void)
 {
@@ -33,68 +39,117 @@ int main(void)
   // Init Log
   setlog(&huart1);
 
+  // LSM303DLHC on I2C3
+  lsm303_init(&lsm303, &hi2c3);
+  // Bus recovery pins: SCL PA7, SDA PB4
+  lsm303_bus(&lsm303, GPIOA, GPIO_PIN_7, GPIOB, GPIO_PIN_4);
+
   // Accelerometer setup
-  if (lsm303_la_setup(&hi2c3, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
+  // Retry after bus recovery: sensor may hold SDA low after MCU reset
+  while (lsm303_la_setup(&lsm303, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
     xError("LSM303DLHC Accelerometer Setup Error!\n");
-    while (1);
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
   }
   HAL_Delay(10);
 
-  const float T = 1.0F / 400; // one tact duration
-
-  // === Accelerometer detect motion by INT1 ===
-  lsm303_reg_int_cfg_a_t cfg = { 0 };                         // INT1_CFG_A
-  cfg.xhe = 1U;                                               // Enabe X high event
-  cfg.yhe = 1U;                                               // Enabe Y high event
-  cfg.zhe = 1U;                                               // Enabe Z high event
-  cfg.aoi6d = LSM303_AOR;                                     // OR combination of interrupt events
-  const uint8_t threshould = (uint8_t)(0.05F / lsm303_alsb);  // 0.05g
-  const uint8_t duration = (uint8_t)(0.05 / T);               // 50ms
-  if (lsm303_la_int1(&hi2c3, cfg.reg, threshould, duration) != HAL_OK) {
-    xError("LSM303DLHC Accelerometer Config INT1 Error!\n");
-    while (1);
-  }
-
-  // === Accelerometer detect weightlessness by INT1 ===
-  // lsm303_reg_int_cfg_a_t cfg = { 0 };                       // INT1_CFG_A
-  // cfg.xle = 1U;                                             // Enable X for low level
-  // cfg.yle = 1U;                                             // Enable Y for low level
-  // cfg.zle = 1U;                                             // Enable Z for low level
-  // cfg.aoi6d = LSM303_AOR;                                   // OR combination of interrupt events
-  // const uint8_t threshould = (uint8_t)(0.2F / lsm303_alsb); // 0.2g
-  // const uint8_t duration = (uint8_t)(0.02 / T);             // 20ms
-  // if (lsm303_la_int1(&hi2c3, cfg.reg, threshould, duration) != HAL_OK) {
-  //   xError("LSM303DLHC Accelerometer Config INT1 Error!\n");
-  //   while (1);
-  // }
+  // Event durations are data rate ticks: configured for 400 Hz here and reprogrammed on adaptive data rate switch
+  if (events_setup() != HAL_OK) while (1);
 
   // === Accelerometer deactivate interrupt by INT1 ===
-  // if (lsm303_la_int1(&hi2c3, 0U, 0U, 0U) != HAL_OK) {
+  // if (lsm303_la_int1(&lsm303, 0U, 0U, 0U) != HAL_OK) {
   //   xError("LSM303DLHC Accelerometer Deactivate INT1 Error!\n");
   //   while (1);
   // }
 
+  // Adaptive data rate: 10 Hz low-power mode after 5 s without INT1 events
+  lsm303_adapt_t adapt;
+  if (lsm303_adapt_init(&adapt, &lsm303, LSM303_ADATARATE_10, LSM303_ADATARATE_400, 1U, 5000U, HAL_GetTick()) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Adaptive Data Rate Error!\n");
+    while (1);
+  }
+
   // IRQ test loop
   while (1) {
+    uint8_t activity = 0U;
+    if (int1_ != 0U) {
+      int1_ = 0U;
+      lsm303_reg_int_src_a_t src = { 0 };
+      lsm303_la_src1(&lsm303, &src.reg);
+      if (src.ia) ++irq1_;
+    }
     if (irq1_ > 1U) {
       irq1_ ^= irq1_; // 0
+      activity = 1U;
       xDebug("Interrupt on INT1\n");
     }
+    if (int2_ != 0U) {
+      int2_ = 0U;
+      // Free fall and click share INT2: check both sources
+      lsm303_reg_int_src_a_t src = { 0 };
+      lsm303_la_src2(&lsm303, &src.reg);
+      if (src.ia) {
+        activity = 1U;
+        xDebug("Free fall on INT2\n");
+      }
+      lsm303_reg_click_src_a_t csrc = { 0 };
+      lsm303_la_click_src(&lsm303, &csrc.reg);
+      if (csrc.dclick) {
+        activity = 1U;
+        xDebug("Double click on INT2\n");
+      }
+    }
+    const uint32_t switches = adapt.switches;
+    lsm303_adapt_step(&adapt, activity, HAL_GetTick());
+    // 10 Hz: durations are rounded to 100 ms ticks, click limit is one tick
+    if (adapt.switches != switches && events_setup() != HAL_OK) xError("LSM303DLHC Accelerometer Events Error!\n");
   }
   return 0;
 }
 
-// Interrupt callback
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+// Motion, free fall and double click events for current data rate
+static uint8_t events_setup(void)
 {
-  if (INT1_Pin == GPIO_Pin) {
-    lsm303_reg_int_src_a_t src = { 0 };
-    lsm303_la_src1(&hi2c3, &src.reg);
-    if (src.ia) ++irq1_;
+  // === Accelerometer detect motion by INT1 ===
+  lsm303_reg_int_cfg_a_t cfg = { 0 };                         // INT1_CFG_A
+  cfg.xhe = 1U;                                               // Enabe X high event
+  cfg.yhe = 1U;                                               // Enabe Y high event
+  cfg.zhe = 1U;                                               // Enabe Z high event
+  cfg.aoi6d = LSM303_AOR;                                     // OR combination of interrupt events
+  const uint8_t threshould = lsm303_la_ths(&lsm303, 0.05F);   // 0.05g
+  const uint8_t duration = lsm303_la_ticks(&lsm303, 50.0F);   // 50ms
+  if (lsm303_la_int1(&lsm303, cfg.reg, threshould, duration) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Config INT1 Error!\n");
+    return HAL_ERROR;
   }
-  if (INT2_Pin == GPIO_Pin) {
-    // todo
+
+  // === Accelerometer detect free fall by INT2 ===
+  // All axes below 0.35g during 30ms: AND combination of X, Y, Z low events by interrupt generator 2
+  if (lsm303_la_freefall(&lsm303, LSM303_APAD_INT2, 0.35F, 30.0F) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Config Free Fall Error!\n");
+    return HAL_ERROR;
   }
+
+  // === Accelerometer detect double click by INT2 ===
+  lsm303_reg_click_cfg_a_t click = { 0 };                     // CLICK_CFG_A
+  click.zd = 1U;                                              // Enable Z double click
+  const uint8_t cths = lsm303_la_ths(&lsm303, 1.5F);          // 1.5g
+  uint8_t limit = lsm303_la_ticks(&lsm303, 20.0F);            // 20ms above threshold
+  if (limit == 0U) limit = 1U;
+  const uint8_t latency = lsm303_la_ticks(&lsm303, 50.0F);    // 50ms after first click
+  const uint8_t window = lsm303_la_ticks(&lsm303, 300.0F);    // 300ms for second click
+  if (lsm303_la_click(&lsm303, click.reg, cths, limit, latency, window, LSM303_APAD_INT2) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Config Click Error!\n");
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+// Interrupt callback
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (INT1_Pin == GPIO_Pin) int1_ = 1U;
+  if (INT2_Pin == GPIO_Pin) int2_ = 1U;
 }
 
 
@@ -258,6 +313,10 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
 
 /* USER CODE END 4 */
 
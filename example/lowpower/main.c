@@ -0,0 +1,301 @@
+/// \file main.c
+/// \brief Example: low-power acquisition by LSM303DLHC with MCU in STOP2 between FIFO watermarks
+/// \details Accelerometer collects samples in FIFO at 50 Hz low-power mode, FIFO watermark on \c INT1 wakes MCU up
+/// every 0.5 s: window features of samples are printed and MCU enters STOP2 again. Duty-cycle report is printed every 20 wakeups
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "main.h"
+#include <stdio.h>
+
+#include "log.h"
+#include "lsm303dlhc.h"
+#include "lsm303power.h"
+#include "lsm303stat.h"
+
+I2C_HandleTypeDef hi2c3;
+UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
+lsm303_lp_t lp;
+
+void SystemClock_Config(void);
+static void MX_GPIO_Init(void);
+static void MX_I2C3_Init(void);
+static void MX_USART1_UART_Init(void);
+
+// Block of samples: features of 1 s tumbling windows instead of raw samples
+static lsm303_stat_t stat_;
+
+static void block(void* ctx, lsm303_sample_t* s, const uint8_t n)
+{
+  lsm303_feat_t f[2];
+  const uint16_t k = lsm303_stat_samples(&stat_, s, n, f, 2U);
+  for (uint16_t i = 0; i < k; ++i) {
+    xDebug("RMS %.3f %.3f %.3f, P2P %.3f %.3f %.3f, SMA %.3f\n",
+           f[i].rms[0], f[i].rms[1], f[i].rms[2], f[i].p2p[0], f[i].p2p[1], f[i].p2p[2], f[i].sma);
+  }
+}
+
+int main(void)
+{
+  HAL_Init();
+  SystemClock_Config();
+  MX_GPIO_Init();
+  MX_I2C3_Init();
+  MX_USART1_UART_Init();
+
+  // setup
+  HAL_Delay(2000);
+
+  // Init Log
+  setlog(&huart1);
+
+  // LSM303DLHC on I2C3
+  lsm303_init(&lsm303, &hi2c3);
+  // Bus recovery pins: SCL PA7, SDA PB4
+  lsm303_bus(&lsm303, GPIOA, GPIO_PIN_7, GPIOB, GPIO_PIN_4);
+
+  // Accelerometer setup: 50 Hz low-power mode
+  // Retry after bus recovery: sensor may hold SDA low after MCU reset
+  while (lsm303_la_setup(&lsm303, LSM303_ADATARATE_50, 1U, 0U, LSM303_AFS_2G) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Setup Error!\n");
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
+  }
+
+  // FIFO stream mode, watermark interrupt on INT1 at 25 samples
+  if (lsm303_la_fifo(&lsm303, LSM303_AFIFO_STREAM, 25U, 1U) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer FIFO Error!\n");
+    while (1);
+  }
+
+  // Window features: 50 samples (1 s) tumbling window
+  lsm303_stat_init(&stat_, 50U, 0U, 0, 0);
+
+  // Low-power acquisition: full FIFO in one block
+  static lsm303_sample_t s[LSM303_FIFO_SIZE];
+  if (lsm303_lp_init(&lp, &lsm303, s, LSM303_FIFO_SIZE, block, 0) != HAL_OK) {
+    xError("LSM303DLHC Low-Power Init Error!\n");
+    while (1);
+  }
+  // UART and I2C are re-initialized, system clock is restored after STOP2
+  lsm303_lp_periph(&lp, &huart1, SystemClock_Config, 0);
+
+  // Acquisition loop
+  while (1) {
+    if (lsm303_lp_step(&lp) == HAL_OK && lp.rep.wakeups % 20U == 0U) {
+      lsm303_lp_report_t rep;
+      lsm303_lp_report(&lp, &rep);
+      xDebug("Wakeups %lu, samples %lu, awake %lu ms (%.3f ms per sample)\n",
+             (unsigned long)rep.wakeups, (unsigned long)rep.samples, (unsigned long)rep.awake,
+             rep.samples != 0U ? (float)rep.awake / rep.samples : 0.0F);
+    }
+  }
+  return 0;
+}
+
+// Interrupt callback
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (INT1_Pin == GPIO_Pin) lsm303_lp_irq(&lp);
+}
+
+
+/**
+  * @brief System Clock Configuration
+  * @retval None
+  */
+void SystemClock_Config(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+  /** Configure the main internal regulator output voltage
+  */
+  if (HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the RCC Oscillators according to the specified parameters
+  * in the RCC_OscInitTypeDef structure.
+  */
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+  RCC_OscInitStruct.MSIState = RCC_MSI_ON;
+  RCC_OscInitStruct.MSICalibrationValue = 0;
+  RCC_OscInitStruct.MSIClockRange = RCC_MSIRANGE_6;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the CPU, AHB and APB buses clocks
+  */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_MSI;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief I2C3 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_I2C3_Init(void)
+{
+
+  /* USER CODE BEGIN I2C3_Init 0 */
+
+  /* USER CODE END I2C3_Init 0 */
+
+  /* USER CODE BEGIN I2C3_Init 1 */
+
+  /* USER CODE END I2C3_Init 1 */
+  hi2c3.Instance = I2C3;
+  hi2c3.Init.Timing = 0x00100D14;
+  hi2c3.Init.OwnAddress1 = 0;
+  hi2c3.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  hi2c3.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+  hi2c3.Init.OwnAddress2 = 0;
+  hi2c3.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+  hi2c3.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+  hi2c3.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+  if (HAL_I2C_Init(&hi2c3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Analogue filter
+  */
+  if (HAL_I2CEx_ConfigAnalogFilter(&hi2c3, I2C_ANALOGFILTER_ENABLE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Digital filter
+  */
+  if (HAL_I2CEx_ConfigDigitalFilter(&hi2c3, 0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN I2C3_Init 2 */
+
+  /* USER CODE END I2C3_Init 2 */
+
+}
+
+/**
+  * @brief USART1 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_USART1_UART_Init(void)
+{
+
+  /* USER CODE BEGIN USART1_Init 0 */
+
+  /* USER CODE END USART1_Init 0 */
+
+  /* USER CODE BEGIN USART1_Init 1 */
+
+  /* USER CODE END USART1_Init 1 */
+  huart1.Instance = USART1;
+  huart1.Init.BaudRate = 115200;
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;
+  huart1.Init.StopBits = UART_STOPBITS_1;
+  huart1.Init.Parity = UART_PARITY_NONE;
+  huart1.Init.Mode = UART_MODE_TX_RX;
+  huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+  huart1.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart1.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  if (HAL_UART_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN USART1_Init 2 */
+
+  /* USER CODE END USART1_Init 2 */
+
+}
+
+/**
+  * @brief GPIO Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_GPIO_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+/* USER CODE BEGIN MX_GPIO_Init_1 */
+/* USER CODE END MX_GPIO_Init_1 */
+
+  /* GPIO Ports Clock Enable */
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+
+  /*Configure GPIO pins : INT1_Pin INT2_Pin */
+  GPIO_InitStruct.Pin = INT1_Pin|INT2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+/* USER CODE BEGIN MX_GPIO_Init_2 */
+/* USER CODE END MX_GPIO_Init_2 */
+}
+
+/* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
+
+/* USER CODE END 4 */
+
+/**
+  * @brief  This function is executed in case of error occurrence.
+  * @retval None
+  */
+void Error_Handler(void)
+{
+  /* USER CODE BEGIN Error_Handler_Debug */
+  /* User can add his own implementation to report the HAL error return state */
+  __disable_irq();
+  while (1)
+  {
+  }
+  /* USER CODE END Error_Handler_Debug */
+}
+
+#ifdef  USE_FULL_ASSERT
+/**
+  * @brief  Reports the name of the source file and the source line number
+  *         where the assert_param error has occurred.
+  * @param  file: pointer to the source file name
+  * @param  line: assert_param error line source number
+  * @retval None
+  */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+  /* USER CODE BEGIN 6 */
+  /* User can add his own implementation to report the file name and line number,
+     ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
+  /* USER CODE END 6 */
+}
+#endif /* USE_FULL_ASSERT */
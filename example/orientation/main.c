@@ -9,9 +9,14 @@
 #include "log.h"
 #include "lsm303dlhc.h"
 #include "lsm303algo.h"
+#include "lsm303cal.h"
+
+// Calibration in the last flash page of STM32L432KC (256 KB)
+#define MCAL_ADDR (FLASH_BASE + 0x40000UL - FLASH_PAGE_SIZE)
 
 I2C_HandleTypeDef hi2c3;
 UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
 
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
@@ -32,18 +37,43 @@ int main(void)
   // Log on
   setlog(&huart1);
 
+  // LSM303DLHC on I2C3
+  lsm303_init(&lsm303, &hi2c3);
+  // Bus recovery pins: SCL PA7, SDA PB4
+  lsm303_bus(&lsm303, GPIOA, GPIO_PIN_7, GPIOB, GPIO_PIN_4);
+
   // Accelerometer setup
-  if (lsm303_la_setup(&hi2c3, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
+  // Retry after bus recovery: sensor may hold SDA low after MCU reset
+  while (lsm303_la_setup(&lsm303, LSM303_ADATARATE_400, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
     xError("LSM303DLHC Accelerometer Setup Error!\n");
-    while (1);
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
   }
 
   // Magnetometer setup
-  if (lsm303_mf_setup(&hi2c3, 0U, LSM303_MDATARATE_220, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) {
+  while (lsm303_mf_setup(&lsm303, 0U, LSM303_MDATARATE_220, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) {
     xError("LSM303DLHC Magnetometer Setup Error!\n");
-    while (1);
+    lsm303_recover(&lsm303);
+    HAL_Delay(100);
   }
 
+  // Magnetometer calibration: load or fit while the board is rotated through all orientations
+  lsm303_mcal_t cal;
+  if (lsm303_mcal_load(MCAL_ADDR, &cal) != HAL_OK) {
+    xDebug("Calibration: rotate the board\n");
+    lsm303_mcal_fit_t fit;
+    lsm303_mcal_fit_init(&fit);
+    int16_t r[3];
+    do {
+      for (uint16_t i = 0; i < 2200U; ++i) {
+        if (lsm303_mf_raw(&lsm303, &r[0], &r[1], &r[2]) == HAL_OK) lsm303_mcal_fit_step(&fit, r[0], r[1], r[2]);
+        HAL_Delay(5);
+      }
+    } while (lsm303_mcal_fit_solve(&fit, &lsm303, &cal) != HAL_OK);
+    lsm303_mcal_save(MCAL_ADDR, &cal);
+  }
+  lsm303_mf_calib(&lsm303, &cal);
+
   // Log off
   setlog(0);
 
@@ -57,8 +87,8 @@ int main(void)
   // loop
   while (1) {
     for (uint8_t i = 0; i < CNTSETUP * 2; ++i) {
-      if (lsm303_la_read(&hi2c3, &a[0], &a[1], &a[2]) != HAL_OK) continue;
-      if (lsm303_mf_read(&hi2c3, &m[0], &m[1], &m[2]) != HAL_OK) continue;
+      if (lsm303_la_read(&lsm303, &a[0], &a[1], &a[2]) != HAL_OK) continue;
+      if (lsm303_mf_read(&lsm303, &m[0], &m[1], &m[2]) != HAL_OK) continue;
       orientLP(a, m, 0.239, &pitchLP, &rollLP, &yawLP);
       //orientK(a, m, 1e-5, 1e-2, 1.0, &pitchK, &rollK, &yawK); // smoothing and lag
       orientK(a, m, 0.1, 1.0, 1.0, &pitchK, &rollK, &yawK);
@@ -233,6 +263,10 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
 
 /* USER CODE END 4 */
 
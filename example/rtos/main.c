@@ -0,0 +1,328 @@
+/// \file main.c
+/// \brief Example: FreeRTOS acquisition task and orientation consumer task sharing I2C3 by bus mutex
+/// \details Requires FreeRTOS kernel (STM32CubeMX middleware, HAL time base on a timer instead of \c SysTick) and
+/// build flag \c -DLSM303_RTOS. I2C3 interrupt priority must allow FreeRTOS API calls from ISR
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "main.h"
+#include <stdio.h>
+
+#include "log.h"
+#include "lsm303dlhc.h"
+#include "lsm303algo.h"
+#include "lsm303rtos.h"
+
+I2C_HandleTypeDef hi2c3;
+UART_HandleTypeDef huart1;
+lsm303_dev_t lsm303;
+
+void SystemClock_Config(void);
+static void MX_GPIO_Init(void);
+static void MX_I2C3_Init(void);
+static void MX_USART1_UART_Init(void);
+
+static lsm303_rtos_t bus_;  // I2C3 port: other drivers of I2C3 take bus_.mutex
+static lsm303_acq_t acq_;
+
+// Consumer: orientation by blocks of accelerometer and magnetometer samples
+static void orient_task(void* arg)
+{
+  lsm303_acq_blk_t blk;
+  float m[3] = { 0 };
+  float pitch = 0.0F, roll = 0.0F, yaw = 0.0F;
+  for (;;) {
+    if (lsm303_acq_pop(&acq_, &blk, portMAX_DELAY) != HAL_OK) continue;
+    // Magnetometer: the last sample of block
+    if (blk.sensor == LSM303_MF) {
+      m[0] = blk.s[blk.n - 1U].x;
+      m[1] = blk.s[blk.n - 1U].y;
+      m[2] = blk.s[blk.n - 1U].z;
+      continue;
+    }
+    for (uint8_t i = 0; i < blk.n; ++i) {
+      const float a[3] = { blk.s[i].x, blk.s[i].y, blk.s[i].z };
+      orientK(a, m, 0.1, 1.0, 1.0, &pitch, &roll, &yaw);
+    }
+    xDebug("%lu: pitch %.1f roll %.1f yaw %.1f dropped %lu\n", (unsigned long)blk.tick, pitch, roll, yaw, (unsigned long)lsm303_acq_dropped(&acq_));
+  }
+}
+
+static void setup_task(void* arg)
+{
+  // LSM303DLHC on I2C3 with FreeRTOS bus port
+  lsm303_init(&lsm303, &hi2c3);
+  // Bus recovery pins: SCL PA7, SDA PB4
+  lsm303_bus(&lsm303, GPIOA, GPIO_PIN_7, GPIOB, GPIO_PIN_4);
+  if (lsm303_rtos_init(&bus_, 0) != HAL_OK || lsm303_port(&lsm303, &bus_.port) != HAL_OK) {
+    xError("LSM303DLHC RTOS Port Error!\n");
+    vTaskDelete(0);
+  }
+
+  // Retry after bus recovery: sensor may hold SDA low after MCU reset
+  while (lsm303_la_setup(&lsm303, LSM303_ADATARATE_100, 0U, 1U, LSM303_AFS_4G) != HAL_OK) {
+    xError("LSM303DLHC Accelerometer Setup Error!\n");
+    lsm303_recover(&lsm303);
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+  while (lsm303_mf_setup(&lsm303, 0U, LSM303_MDATARATE_30, LSM303_MGAIN_1_3, LSM303_MMODE_CONTINUOUS) != HAL_OK) {
+    xError("LSM303DLHC Magnetometer Setup Error!\n");
+    lsm303_recover(&lsm303);
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+
+  // Acquisition: polling by 10 ms (data rate 100 Hz), blocks of LSM303_RTOS_BLOCK samples to consumer
+  const uint8_t sensors = (1U << LSM303_LA) | (1U << LSM303_MF);
+  if (lsm303_acq_start(&acq_, &lsm303, sensors, 0U, pdMS_TO_TICKS(10), 4U, tskIDLE_PRIORITY + 2U) != HAL_OK) {
+    xError("LSM303DLHC Acquisition Task Error!\n");
+  }
+  vTaskDelete(0);
+}
+
+int main(void)
+{
+  HAL_Init();
+  SystemClock_Config();
+  MX_GPIO_Init();
+  MX_I2C3_Init();
+  MX_USART1_UART_Init();
+
+  // I2C3 interrupts: transfers of bus port wait for completion
+  HAL_NVIC_SetPriority(I2C3_EV_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(I2C3_EV_IRQn);
+  HAL_NVIC_SetPriority(I2C3_ER_IRQn, 6, 0);
+  HAL_NVIC_EnableIRQ(I2C3_ER_IRQn);
+
+  // Init Log
+  setlog(&huart1);
+
+  xTaskCreate(setup_task, "setup", 256U, 0, tskIDLE_PRIORITY + 3U, 0);
+  xTaskCreate(orient_task, "orient", 512U, 0, tskIDLE_PRIORITY + 1U, 0);
+  vTaskStartScheduler();
+  while (1);
+  return 0;
+}
+
+void I2C3_EV_IRQHandler(void)
+{
+  HAL_I2C_EV_IRQHandler(&hi2c3);
+}
+
+void I2C3_ER_IRQHandler(void)
+{
+  HAL_I2C_ER_IRQHandler(&hi2c3);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  lsm303_rx_cplt(&lsm303, hi2c);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+  lsm303_tx_cplt(&lsm303, hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+  lsm303_rx_error(&lsm303, hi2c);
+}
+
+/**
+  * @brief System Clock Configuration
+  * @retval None
+  */
+void SystemClock_Config(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+  /** Configure the main internal regulator output voltage
+  */
+  if (HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the RCC Oscillators according to the specified parameters
+  * in the RCC_OscInitTypeDef structure.
+  */
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_MSI;
+  RCC_OscInitStruct.MSIState = RCC_MSI_ON;
+  RCC_OscInitStruct.MSICalibrationValue = 0;
+  RCC_OscInitStruct.MSIClockRange = RCC_MSIRANGE_6;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the CPU, AHB and APB buses clocks
+  */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                              |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_MSI;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/**
+  * @brief I2C3 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_I2C3_Init(void)
+{
+
+  /* USER CODE BEGIN I2C3_Init 0 */
+
+  /* USER CODE END I2C3_Init 0 */
+
+  /* USER CODE BEGIN I2C3_Init 1 */
+
+  /* USER CODE END I2C3_Init 1 */
+  hi2c3.Instance = I2C3;
+  hi2c3.Init.Timing = 0x00100D14;
+  hi2c3.Init.OwnAddress1 = 0;
+  hi2c3.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  hi2c3.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+  hi2c3.Init.OwnAddress2 = 0;
+  hi2c3.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+  hi2c3.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+  hi2c3.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+  if (HAL_I2C_Init(&hi2c3) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Analogue filter
+  */
+  if (HAL_I2CEx_ConfigAnalogFilter(&hi2c3, I2C_ANALOGFILTER_ENABLE) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Configure Digital filter
+  */
+  if (HAL_I2CEx_ConfigDigitalFilter(&hi2c3, 0) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN I2C3_Init 2 */
+
+  /* USER CODE END I2C3_Init 2 */
+
+}
+
+/**
+  * @brief USART1 Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_USART1_UART_Init(void)
+{
+
+  /* USER CODE BEGIN USART1_Init 0 */
+
+  /* USER CODE END USART1_Init 0 */
+
+  /* USER CODE BEGIN USART1_Init 1 */
+
+  /* USER CODE END USART1_Init 1 */
+  huart1.Instance = USART1;
+  huart1.Init.BaudRate = 115200;
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;
+  huart1.Init.StopBits = UART_STOPBITS_1;
+  huart1.Init.Parity = UART_PARITY_NONE;
+  huart1.Init.Mode = UART_MODE_TX_RX;
+  huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+  huart1.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart1.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  if (HAL_UART_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+  /* USER CODE BEGIN USART1_Init 2 */
+
+  /* USER CODE END USART1_Init 2 */
+
+}
+
+/**
+  * @brief GPIO Initialization Function
+  * @param None
+  * @retval None
+  */
+static void MX_GPIO_Init(void)
+{
+  GPIO_InitTypeDef GPIO_InitStruct = {0};
+/* USER CODE BEGIN MX_GPIO_Init_1 */
+/* USER CODE END MX_GPIO_Init_1 */
+
+  /* GPIO Ports Clock Enable */
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+
+  /*Configure GPIO pins : INT1_Pin INT2_Pin */
+  GPIO_InitStruct.Pin = INT1_Pin|INT2_Pin;
+  GPIO_InitStruct.Mode = GPIO_MODE_IT_RISING;
+  GPIO_InitStruct.Pull = GPIO_NOPULL;
+  HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+  /* EXTI interrupt init*/
+  HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+
+  HAL_NVIC_SetPriority(EXTI15_10_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+/* USER CODE BEGIN MX_GPIO_Init_2 */
+/* USER CODE END MX_GPIO_Init_2 */
+}
+
+/* USER CODE BEGIN 4 */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  log_txcplt(huart);
+}
+
+/* USER CODE END 4 */
+
+/**
+  * @brief  This function is executed in case of error occurrence.
+  * @retval None
+  */
+void Error_Handler(void)
+{
+  /* USER CODE BEGIN Error_Handler_Debug */
+  /* User can add his own implementation to report the HAL error return state */
+  __disable_irq();
+  while (1)
+  {
+  }
+  /* USER CODE END Error_Handler_Debug */
+}
+
+#ifdef  USE_FULL_ASSERT
+/**
+  * @brief  Reports the name of the source file and the source line number
+  *         where the assert_param error has occurred.
+  * @param  file: pointer to the source file name
+  * @param  line: assert_param error line source number
+  * @retval None
+  */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+  /* USER CODE BEGIN 6 */
+  /* User can add his own implementation to report the file name and line number,
+     ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
+  /* USER CODE END 6 */
+}
+#endif /* USE_FULL_ASSERT */
@@ -0,0 +1,132 @@
+/// \file hal_shim.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \details Host shim of STM32 HAL
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "stm32l4xx_hal.h"
+
+#include <stdio.h>
+#include <time.h>
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c)
+{
+    hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c)
+{
+    return HAL_OK;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c)
+{
+    return hi2c->ErrorCode;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data, uint16_t size, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size, uint32_t timeout)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size)
+{
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef* huart)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout)
+{
+    return (fwrite(data, 1U, size, stdout) == size) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    const HAL_StatusTypeDef ret = HAL_UART_Transmit(huart, data, size, HAL_MAX_DELAY);
+    if (ret == HAL_OK) HAL_UART_TxCpltCallback(huart);
+    return ret;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    return HAL_UART_Transmit_IT(huart, data, size);
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart)
+{
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init)
+{
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef* port, uint32_t pin)
+{
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state)
+{
+    if (state == GPIO_PIN_SET) port->ODR |= pin;
+    else port->ODR &= ~(uint32_t)pin;
+    port->IDR = port->ODR;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin)
+{
+    return (port->IDR & pin) != 0U ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_PWREx_EnterSTOP2Mode(uint8_t entry)
+{
+}
+
+uint32_t HAL_GetTick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000U + ts.tv_nsec / 1000000U);
+}
+
+void HAL_Delay(uint32_t delay)
+{
+    const struct timespec ts = { (time_t)(delay / 1000U), (long)(delay % 1000U) * 1000000L };
+    nanosleep(&ts, 0);
+}
+
+void HAL_SuspendTick(void)
+{
+}
+
+void HAL_ResumeTick(void)
+{
+}
@@ -0,0 +1,102 @@
+/// \file stm32l4xx_hal.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \details Host shim of STM32 HAL: types and functions used by the library.
+/// \details I2C transfers fail with \c HAL_ERROR, UART output is written to \c stdout
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __STM32L4xx_HAL_H
+#define __STM32L4xx_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+#define HAL_I2C_ERROR_NONE 0x00000000U
+#define HAL_I2C_ERROR_AF 0x00000004U
+#define HAL_I2C_ERROR_TIMEOUT 0x00000020U
+
+typedef struct {
+    uint32_t Timing;
+} I2C_InitTypeDef;
+
+typedef struct {
+    void* Instance;
+    I2C_InitTypeDef Init;
+    uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    void* Instance;
+    void* hdmatx;
+} UART_HandleTypeDef;
+
+typedef struct {
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0U,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_MODE_OUTPUT_OD 0x00000011U
+#define GPIO_NOPULL 0x00000000U
+#define GPIO_SPEED_FREQ_LOW 0x00000000U
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef* hi2c);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t addr, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_IT(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_IT(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef* hi2c, uint16_t addr, uint16_t reg, uint16_t regsize, uint8_t* data, uint16_t size);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init);
+void HAL_GPIO_DeInit(GPIO_TypeDef* port, uint32_t pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin);
+
+#define PWR_STOPENTRY_WFI 0x01U
+
+void HAL_PWREx_EnterSTOP2Mode(uint8_t entry);
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+void HAL_SuspendTick(void);
+void HAL_ResumeTick(void);
+
+#define __disable_irq() do { } while (0)
+#define __enable_irq() do { } while (0)
+#define __DMB() __sync_synchronize()
+static inline uint32_t __get_PRIMASK(void) { return 0U; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline uint32_t __get_IPSR(void) { return 0U; }
+
+#endif // __STM32L4xx_HAL_H
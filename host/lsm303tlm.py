@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+# lsm303tlm.py
+# This file is part of LSM303DLHC Library for STM32 Nucleo L4
+# (c) https://github.com/Ilushenko Oleksandr Ilushenko
+# Author: Oleksandr Ilushenko
+# Date: 2024
+#
+# Decoder of telemetry packets (src/lsm303tlm.h) to CSV: seq,sensor,tick,x,y,z
+#   python3 host/lsm303tlm.py capture.bin > samples.csv
+#   python3 host/lsm303tlm.py /dev/ttyACM0 --baud 115200 (requires pyserial)
+# Lost packets (sequence gaps), CRC errors and instrumentation packets are reported to stderr
+
+import argparse
+import struct
+import sys
+
+SYNC = b"\xAA\x55"
+HDR_SIZE = 14
+MAX_PAYLOAD = 9 * 255
+SENSORS = {0: "la", 1: "mf"}
+INSTR = 0x80
+INSTR_HEAD = ("samples", "overrun", "notready", "period", "intervals", "imin", "imax")
+INSTR_TAIL = ("reads", "bus_max", "bus", "lat_n", "lat_max", "lat")
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def varints(data):
+    v = 0
+    sh = 0
+    for b in data:
+        v |= (b & 0x7F) << sh
+        sh += 7
+        if not b & 0x80:
+            yield -((v + 1) >> 1) if v & 1 else v >> 1
+            v = 0
+            sh = 0
+    if sh:
+        raise ValueError("truncated varint")
+
+
+def packet(buf):
+    """Parse packet at start of buf: (header, samples or instrumentation dict, size),
+    None for incomplete packet, ValueError for wrong one"""
+    if len(buf) < HDR_SIZE:
+        return None
+    payload, seq, flags, n, tick, dt = struct.unpack_from("<HHBBIH", buf, 2)
+    if payload > MAX_PAYLOAD:
+        raise ValueError("wrong size")
+    end = HDR_SIZE + payload
+    if len(buf) < end + 2:
+        return None
+    if crc16(buf[2:end]) != struct.unpack_from("<H", buf, end)[0]:
+        raise ValueError("wrong CRC")
+    sensor = SENSORS.get(flags & 0x03, str(flags & 0x03))
+    if flags & INSTR:
+        return (seq, sensor, 0), instr(buf[HDR_SIZE:end], tick), end + 2
+    d = list(varints(buf[HDR_SIZE:end]))
+    if len(d) != 3 * n:
+        raise ValueError("wrong samples")
+    samples = []
+    x = y = z = 0
+    for i in range(n):
+        x += d[3 * i]
+        y += d[3 * i + 1]
+        z += d[3 * i + 2]
+        samples.append((tick + i * dt, x, y, z))
+    return (seq, sensor, n), samples, end + 2
+
+
+def instr(payload, tick):
+    """Instrumentation counters (lsm303_instr_t) of packet payload"""
+    bins = len(payload) // 4 - 15
+    if bins < 1 or len(payload) % 4:
+        raise ValueError("wrong instrumentation")
+    v = struct.unpack_from("<%dI" % (7 + bins), payload)
+    tail = struct.unpack_from("<IIQIIQ", payload, 4 * (7 + bins))
+    c = dict(zip(INSTR_HEAD, v[:7]))
+    c["hist"] = list(v[7:])
+    c.update(zip(INSTR_TAIL, tail))
+    c["tick"] = tick
+    return c
+
+
+def report(sensor, c):
+    """Instrumentation summary line"""
+    reads = max(c["reads"], 1)
+    lat_n = max(c["lat_n"], 1)
+    imin = c["imin"] if c["intervals"] else 0
+    return ("%s @%d: samples %d, overrun %d, notready %d, interval %d..%d hist %s, "
+            "i2c mean %.1f max %d, latency mean %.1f max %d\n") % (
+        sensor, c["tick"], c["samples"], c["overrun"], c["notready"], imin, c["imax"],
+        "/".join(str(h) for h in c["hist"]), c["bus"] / reads, c["bus_max"], c["lat"] / lat_n, c["lat_max"])
+
+
+def decode(chunks, out, err):
+    buf = b""
+    last = {}
+    total = lost = bad = 0
+    for chunk in chunks:
+        buf += chunk
+        while True:
+            s = buf.find(SYNC)
+            if s < 0:
+                buf = buf[-1:] if buf.endswith(SYNC[:1]) else b""
+                break
+            buf = buf[s:]
+            try:
+                p = packet(buf)
+            except ValueError as e:
+                bad += 1
+                err.write("skip: %s\n" % e)
+                buf = buf[1:]
+                continue
+            if p is None:
+                break
+            (seq, sensor, n), samples, size = p
+            buf = buf[size:]
+            if sensor in last:
+                gap = (seq - last[sensor] - 1) & 0xFFFF
+                if gap:
+                    lost += gap
+                    err.write("%s: %d packets lost before %d\n" % (sensor, gap, seq))
+            last[sensor] = seq
+            if isinstance(samples, dict):
+                err.write(report(sensor, samples))
+                continue
+            total += n
+            for tick, x, y, z in samples:
+                out.write("%d,%s,%d,%d,%d,%d\n" % (seq, sensor, tick, x, y, z))
+    err.write("%d samples, %d packets lost, %d errors\n" % (total, lost, bad))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Decode LSM303 telemetry packets to CSV")
+    ap.add_argument("input", help="capture file or serial port")
+    ap.add_argument("--baud", type=int, default=0, help="serial port baud rate")
+    args = ap.parse_args()
+
+    if args.baud:
+        import serial
+        port = serial.Serial(args.input, args.baud, timeout=1)
+        chunks = iter(lambda: port.read(256), None)
+    else:
+        f = open(args.input, "rb")
+        chunks = iter(lambda: f.read(4096), b"")
+    sys.stdout.write("seq,sensor,tick,x,y,z\n")
+    try:
+        decode(chunks, sys.stdout, sys.stderr)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
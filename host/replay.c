@@ -0,0 +1,314 @@
+/// \file replay.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \details Host tool: replay of raw samples trace through algorithmes, generation of synthetic trace
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "log.h"
+#include "lsm303algo.h"
+#include "lsm303fixed.h"
+#include "lsm303trace.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// Replay parameters
+typedef struct {
+    float A;        // low-pass alpha
+    float H;        // high-pass alpha
+    float D;        // motion threshold, g
+    float M;        // distortion threshold, uT
+    float Q;        // Kalman process covariance
+    float R;        // Kalman measurement covariance
+    float E;        // Kalman error prediction
+    uint8_t S;      // motion samples
+    float I;        // incline threshold, degree
+    float W;        // weighlessness threshold, g
+    float F;        // impact threshold, g
+    uint8_t fixed;  // fixed-point detectors
+    uint8_t orient; // print orientation
+    uint8_t quiet;  // don't print events
+} params_t;
+
+// Decoded sample
+typedef struct {
+    lsm303_sensor_t sensor;
+    lsm303_raw_t raw;
+} sample_t;
+
+static UART_HandleTypeDef huart = { 0 };
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* uart)
+{
+    log_txcplt(uart);
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] trace.bin\n"
+        "  -g N     generate synthetic trace of N samples per sensor into trace.bin\n"
+        "  -n N     replay trace N times\n"
+        "  -a A     low-pass alpha (default getAlpha(200, 1))\n"
+        "  -h A     high-pass alpha (default getAlpha(200, 30))\n"
+        "  -d D     motion threshold, g (0.1)\n"
+        "  -m D     distortion threshold, uT (1.6)\n"
+        "  -Q Q     Kalman process covariance (0.2)\n"
+        "  -R R     Kalman measurement covariance (1.9)\n"
+        "  -E E     Kalman error prediction (1.0)\n"
+        "  -s N     motion samples (20)\n"
+        "  -i D     incline threshold, degree (5.0)\n"
+        "  -w W     weighlessness threshold, g (0.3)\n"
+        "  -f F     impact threshold, g (2.0)\n"
+        "  -x       fixed-point detectors\n"
+        "  -o       print orientation\n"
+        "  -q       don't print events\n"
+        "  -v       library log messages\n", name);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static float noise(const float a)
+{
+    return a * ((float)rand() / (float)RAND_MAX * 2.0F - 1.0F);
+}
+
+// Synthetic trace: accelerometer 400 Hz, magnetometer 220 Hz, motion and distortion every 2 s, fall every 10 s
+static int generate(const char* path, const long n)
+{
+    FILE* f = fopen(path, "wb");
+    if (f == 0) {
+        perror(path);
+        return 1;
+    }
+    lsm303_dev_t dev = { 0 };
+    dev.alsb = 0.00195F;    // ±4 g, high resolution
+    dev.mlsb_xy = 1100.0F;  // ±1.3 gauss
+    dev.mlsb_z = 980.0F;
+    uint8_t buf[LSM303_TRACE_HDR_SIZE > LSM303_TRACE_REC_MAX ? LSM303_TRACE_HDR_SIZE : LSM303_TRACE_REC_MAX];
+    fwrite(&buf[0], 1U, lsm303_trace_header(&dev, &buf[0]), f);
+    lsm303_trace_t t;
+    lsm303_trace_init(&t);
+    long na = 0, nm = 0;
+    while (na < n || nm < n) {
+        // next sample by time: accelerometer 2.5 ms, magnetometer 4.545 ms
+        const double ta = (double)na * 2.5;
+        const double tm = (double)nm * (1000.0 / 220.0);
+        const uint8_t la = (na < n) && (nm >= n || ta <= tm);
+        const double ms = la ? ta : tm;
+        const double sec = fmod(ms / 1000.0, 10.0);
+        const uint8_t event = fmod(ms / 1000.0, 2.0) > 1.9;
+        lsm303_raw_t s = { .tick = (uint32_t)ms };
+        if (la) {
+            float z = 1.0F;
+            if (sec > 9.0 && sec < 9.3) z = 0.1F;       // weighlessness
+            else if (sec >= 9.3 && sec < 9.35) z = 3.0F;// impact
+            const float m = event ? 0.5F : 0.0F;
+            s.x = (int16_t)((m + noise(0.01F)) / dev.alsb);
+            s.y = (int16_t)(noise(0.01F) / dev.alsb);
+            s.z = (int16_t)((z + noise(0.01F)) / dev.alsb);
+            ++na;
+        } else {
+            const float d = event ? 0.2F : 0.0F;    // gauss
+            s.x = (int16_t)((0.2F + d + noise(0.002F)) * dev.mlsb_xy);
+            s.y = (int16_t)((0.05F + noise(0.002F)) * dev.mlsb_xy);
+            s.z = (int16_t)((-0.4F + noise(0.002F)) * dev.mlsb_z);
+            ++nm;
+        }
+        fwrite(&buf[0], 1U, lsm303_trace_encode(&t, la ? LSM303_LA : LSM303_MF, &s, &buf[0]), f);
+    }
+    fclose(f);
+    fprintf(stderr, "%ld accelerometer and %ld magnetometer samples written to %s\n", na, nm, path);
+    return 0;
+}
+
+// Trace file to samples
+static sample_t* load(const char* path, lsm303_trace_hdr_t* hdr, long* cnt)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == 0) {
+        perror(path);
+        return 0;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* data = malloc(size > 0 ? (size_t)size : 1U);
+    sample_t* smpl = malloc(sizeof(sample_t) * (size_t)(size / 9 + 1));
+    if (data == 0 || smpl == 0 || fread(data, 1U, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read error\n", path);
+        fclose(f);
+        free(data);
+        free(smpl);
+        return 0;
+    }
+    fclose(f);
+    if (lsm303_trace_parse(data, size > 0xFFFF ? 0xFFFF : (uint16_t)size, hdr) != HAL_OK) {
+        fprintf(stderr, "%s: not a trace file\n", path);
+        free(data);
+        free(smpl);
+        return 0;
+    }
+    lsm303_trace_t t;
+    lsm303_trace_init(&t);
+    long pos = LSM303_TRACE_HDR_SIZE, n = 0;
+    while (pos < size) {
+        const long rest = size - pos;
+        const uint16_t sz = lsm303_trace_decode(&t, &data[pos], rest > LSM303_TRACE_REC_MAX ? LSM303_TRACE_REC_MAX : (uint16_t)rest, &smpl[n].sensor, &smpl[n].raw);
+        if (sz == 0U) break;
+        pos += sz;
+        ++n;
+    }
+    if (pos != size) fprintf(stderr, "%s: %ld bytes of incomplete record ignored\n", path, size - pos);
+    free(data);
+    *cnt = n;
+    return smpl;
+}
+
+static void event(const params_t* p, const uint32_t tick, const char* name, const double value)
+{
+    if (!p->quiet) printf("%lu,%s,%g\n", (unsigned long)tick, name, value);
+}
+
+// One pass through detectors, return events
+static long replay(const params_t* p, const lsm303_trace_hdr_t* hdr, const sample_t* smpl, const long n)
+{
+    lsm303_motion_lp_t mlp;
+    lsm303_motion_k_t mk;
+    lsm303_distortion_hp_t dhp;
+    lsm303_distortion_lp_t dlp;
+    lsm303_orient_lp_t olp;
+    lsm303_orient_k_t ok;
+    lsm303_incline_lp_t ilp;
+    lsm303_fall_t fall;
+    lsm303_motion_lp_q_t mlpq;
+    lsm303_motion_k_q_t mkq;
+    lsm303_distortion_hp_q_t dhpq;
+    lsm303_distortion_lp_q_t dlpq;
+    lsm303_fall_q_t fallq;
+    const float mlsb = 100.0F / hdr->mlsb_xy;
+    motionLP_init(&mlp, p->A, p->D, p->S);
+    motionK_init(&mk, p->Q, p->R, p->E, p->D, p->S);
+    distortionHP_init(&dhp, p->H, p->M);
+    distortionLP_init(&dlp, p->A, p->M);
+    orientLP_init(&olp, p->A);
+    orientK_init(&ok, p->Q, p->R, p->E);
+    inclineLP_init(&ilp, p->A, p->I);
+    detectFall_init(&fall, p->W, p->F);
+    motionLPq_init(&mlpq, p->A, p->D, hdr->alsb, p->S);
+    motionKq_init(&mkq, p->Q, p->R, p->E, p->D, hdr->alsb, p->S);
+    distortionHPq_init(&dhpq, p->H, p->M, mlsb);
+    distortionLPq_init(&dlpq, p->A, p->M, mlsb);
+    detectFallq_init(&fallq, p->W, p->F, hdr->alsb);
+    float a[3] = { 0.0F }, m[3] = { 0.0F };
+    uint8_t mready = 0U;
+    long cnt = 0;
+    for (long i = 0; i < n; ++i) {
+        const lsm303_raw_t* r = &smpl[i].raw;
+        if (smpl[i].sensor == LSM303_LA) {
+            a[0] = (float)r->x * hdr->alsb;
+            a[1] = (float)r->y * hdr->alsb;
+            a[2] = (float)r->z * hdr->alsb;
+            float v;
+            if (p->fixed) {
+                uint32_t q;
+                if ((q = motionLPq_step(&mlpq, r->x, r->y, r->z)) != 0U) { event(p, r->tick, "motionLPq", sqrt((double)q) * hdr->alsb); ++cnt; }
+                if ((q = motionKq_step(&mkq, r->x, r->y, r->z)) != 0U) { event(p, r->tick, "motionKq", sqrt((double)q) * hdr->alsb); ++cnt; }
+                if (fallq.stage != STAGE_FALL && detectFallq_step(&fallq, r->x, r->y, r->z) == STAGE_FALL) {
+                    event(p, r->tick, "detectFallq", 1.0);
+                    ++cnt;
+                    detectFallq_reset(&fallq);
+                }
+            } else {
+                if ((v = motionLP_step(&mlp, a[0], a[1], a[2])) != 0.0F) { event(p, r->tick, "motionLP", v); ++cnt; }
+                if ((v = motionK_step(&mk, a[0], a[1], a[2])) != 0.0F) { event(p, r->tick, "motionK", v); ++cnt; }
+                if (fall.stage != STAGE_FALL && detectFall_step(&fall, a[0], a[1], a[2]) == STAGE_FALL) {
+                    event(p, r->tick, "detectFall", 1.0);
+                    ++cnt;
+                    detectFall_reset(&fall);
+                }
+            }
+            if ((v = inclineLP_step(&ilp, a[0], a[1], a[2])) != 0.0F) { event(p, r->tick, "inclineLP", v); ++cnt; }
+            if (mready) {
+                float pitch, roll, yaw;
+                if (orientLP_step(&olp, a, m, &pitch, &roll, &yaw) == 0U && p->orient && !p->quiet)
+                    printf("%lu,orientLP,%.2f,%.2f,%.2f\n", (unsigned long)r->tick, pitch, roll, yaw);
+                if (orientK_step(&ok, a, m, &pitch, &roll, &yaw) == 0U && p->orient && !p->quiet)
+                    printf("%lu,orientK,%.2f,%.2f,%.2f\n", (unsigned long)r->tick, pitch, roll, yaw);
+            }
+        } else {
+            m[0] = (float)r->x / hdr->mlsb_xy * 100.0F;
+            m[1] = (float)r->y / hdr->mlsb_xy * 100.0F;
+            m[2] = (float)r->z / hdr->mlsb_z * 100.0F;
+            mready = 1U;
+            if (p->fixed) {
+                uint32_t q;
+                if ((q = distortionHPq_step(&dhpq, r->x, r->y, r->z)) != 0U) { event(p, r->tick, "distortionHPq", q * mlsb / 4.0); ++cnt; }
+                if ((q = distortionLPq_step(&dlpq, r->x, r->y, r->z)) != 0U) { event(p, r->tick, "distortionLPq", sqrt((double)q) * mlsb); ++cnt; }
+            } else {
+                float v;
+                if ((v = distortionHP_step(&dhp, m[0], m[1], m[2])) != 0.0F) { event(p, r->tick, "distortionHP", v); ++cnt; }
+                if ((v = distortionLP_step(&dlp, m[0], m[1], m[2])) != 0.0F) { event(p, r->tick, "distortionLP", v); ++cnt; }
+            }
+        }
+    }
+    return cnt;
+}
+
+int main(int argc, char* argv[])
+{
+    params_t p = {
+        .A = getAlpha(200.0F, 1.0F), .H = getAlpha(200.0F, 30.0F), .D = 0.1F, .M = 1.6F,
+        .Q = 0.2F, .R = 1.9F, .E = 1.0F, .S = 20U, .I = 5.0F, .W = 0.3F, .F = 2.0F,
+    };
+    long gen = 0, passes = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:n:a:h:d:m:Q:R:E:s:i:w:f:xoqv")) != -1) {
+        switch (opt) {
+        case 'g': gen = atol(optarg); break;
+        case 'n': passes = atol(optarg); break;
+        case 'a': p.A = strtof(optarg, 0); break;
+        case 'h': p.H = strtof(optarg, 0); break;
+        case 'd': p.D = strtof(optarg, 0); break;
+        case 'm': p.M = strtof(optarg, 0); break;
+        case 'Q': p.Q = strtof(optarg, 0); break;
+        case 'R': p.R = strtof(optarg, 0); break;
+        case 'E': p.E = strtof(optarg, 0); break;
+        case 's': p.S = (uint8_t)atoi(optarg); break;
+        case 'i': p.I = strtof(optarg, 0); break;
+        case 'w': p.W = strtof(optarg, 0); break;
+        case 'f': p.F = strtof(optarg, 0); break;
+        case 'x': p.fixed = 1U; break;
+        case 'o': p.orient = 1U; break;
+        case 'q': p.quiet = 1U; break;
+        case 'v': setlog(&huart); break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (gen > 0) return generate(argv[optind], gen);
+
+    lsm303_trace_hdr_t hdr;
+    long n = 0;
+    sample_t* smpl = load(argv[optind], &hdr, &n);
+    if (smpl == 0) return 1;
+    long events = 0;
+    const double t0 = now();
+    for (long i = 0; i < passes; ++i) events += replay(&p, &hdr, smpl, n);
+    const double dt = now() - t0;
+    fprintf(stderr, "samples: %ld, passes: %ld, events: %ld, time: %.3f s, %.0f samples/s\n",
+        n, passes, events, dt, dt > 0.0 ? (double)n * (double)passes / dt : 0.0);
+    free(smpl);
+    return 0;
+}
@@ -5,10 +5,115 @@
 ///	\date 2024
 #include "log.h"
 
+#include <stdarg.h>
+
+#define LOG_MASK (LOG_RING_SIZE - 1U)
+
 UART_HandleTypeDef* huart_ = 0;
-char printbuf[128] = { 0 };
+
+static uint8_t ring_[LOG_RING_SIZE] = { 0 };
+static volatile uint16_t head_ = 0U;    // free-running write index
+static volatile uint16_t tail_ = 0U;    // free-running read index
+static volatile uint16_t txlen_ = 0U;   // size of transmission in progress
+static volatile uint32_t dropped_ = 0U;
+static uint8_t seq_ = 0U;
+
+// Start transmission of contiguous part of ring buffer. Call with disabled interrupts
+static void log_start(void)
+{
+    const uint16_t len = (uint16_t)(head_ - tail_);
+    if (huart_ == 0 || txlen_ != 0U || len == 0U) return;
+    const uint16_t pos = tail_ & LOG_MASK;
+    const uint16_t sz = (len < LOG_RING_SIZE - pos) ? len : (uint16_t)(LOG_RING_SIZE - pos);
+    txlen_ = sz;
+    const HAL_StatusTypeDef status = (huart_->hdmatx != 0)
+        ? HAL_UART_Transmit_DMA(huart_, &ring_[pos], sz)
+        : HAL_UART_Transmit_IT(huart_, &ring_[pos], sz);
+    // retry by next write or transmission complete
+    if (status != HAL_OK) txlen_ = 0U;
+}
 
 void setlog(UART_HandleTypeDef *uart)
 {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
     huart_ = uart;
+    head_ = tail_ = 0U;
+    txlen_ = 0U;
+    __set_PRIMASK(primask);
+}
+
+uint16_t log_write(const uint8_t* data, const uint16_t size)
+{
+    if (size == 0U) return 0U;
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (size > LOG_RING_SIZE - (uint16_t)(head_ - tail_)) {
+        dropped_++;
+        __set_PRIMASK(primask);
+        return 0U;
+    }
+    const uint16_t pos = head_ & LOG_MASK;
+    const uint16_t first = (size < LOG_RING_SIZE - pos) ? size : (uint16_t)(LOG_RING_SIZE - pos);
+    memcpy(&ring_[pos], data, first);
+    memcpy(&ring_[0], &data[first], size - first);
+    head_ += size;
+    log_start();
+    __set_PRIMASK(primask);
+    return size;
+}
+
+void log_txcplt(UART_HandleTypeDef* uart)
+{
+    if (uart == 0 || uart != huart_) return;
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    tail_ += txlen_;
+    txlen_ = 0U;
+    log_start();
+    __set_PRIMASK(primask);
+}
+
+uint16_t log_pending(void)
+{
+    return (uint16_t)(head_ - tail_);
+}
+
+uint32_t log_dropped(void)
+{
+    return dropped_;
+}
+
+void log_text(const char* level, const char* func, const char* file, const unsigned line, const char* fmt, ...)
+{
+    char buf[LOG_LINE_SIZE];
+    int sz = 0;
+    if (level != 0) {
+        sz = snprintf(&buf[0], sizeof(buf), "[%s %s: %u] %s ", func, file, line, level);
+        if (sz < 0) return;
+        if (sz >= (int)sizeof(buf)) sz = sizeof(buf) - 1;
+    }
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(&buf[sz], sizeof(buf) - sz, fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    sz += n;
+    if (sz >= (int)sizeof(buf)) sz = sizeof(buf) - 1;
+    log_write((const uint8_t*)&buf[0], (uint16_t)sz);
+}
+
+void log_bin(const uint8_t level, const char* fmt, const uint32_t* args, const uint8_t n)
+{
+    uint32_t rec[3 + LOG_ARGS];
+    const uint8_t cnt = n < LOG_ARGS ? n : LOG_ARGS;
+    uint8_t* const hdr = (uint8_t*)&rec[0];
+    hdr[0] = LOG_SYNC;
+    hdr[1] = level;
+    hdr[2] = cnt;
+    hdr[3] = seq_++;
+    rec[1] = (uint32_t)(uintptr_t)fmt;
+    rec[2] = HAL_GetTick();
+    for (uint8_t i = 0; i < cnt; ++i) rec[3 + i] = args[i];
+    log_write((const uint8_t*)&rec[0], (uint16_t)((3U + cnt) * sizeof(uint32_t)));
 }
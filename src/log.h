@@ -3,6 +3,13 @@
 /// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
 ///	\author Oleksandr Ilushenko
 ///	\date 2024
+/// \details Non-blocking logger: messages are written into ring buffer and drained by UART DMA (or interrupt if UART has no DMA channel).
+/// \details Call \b log_txcplt from \c HAL_UART_TxCpltCallback. Messages which don't fit into ring buffer are dropped and counted.
+/// \details Define \c LOG_DEFERRED for binary records: format string address and raw arguments, formatted on the host by ELF file.
+/// \details Binary record (little-endian): \c 0xA5, level (\c 'T', \c 'D', \c 'W', \c 'E'), arguments count, sequence number,
+/// \c uint32 format string address, \c uint32 tick, arguments as \c uint32 (\c float as IEEE-754 bits, \c double is converted to \c float)
+/// \details \c LSM303_LOG_LEVEL (build flag) removes messages above the level at compile time; default is \c LOG_LEVEL_TRACE.
+/// \details Define \c LSM303_LOG_FILE_LEVEL before including headers of a source file to override the level for this file
 #ifndef __LOG_H__
 #define __LOG_H__
 
@@ -10,37 +17,154 @@
 #include <stdio.h>
 #include <string.h>
 
+#ifndef LOG_RING_SIZE
+# define LOG_RING_SIZE 1024U   ///< Ring buffer size, power of two
+#endif
+
+#ifndef LOG_LINE_SIZE
+# define LOG_LINE_SIZE 128U    ///< Max size of text message
+#endif
+
+#if (LOG_RING_SIZE & (LOG_RING_SIZE - 1U)) != 0U
+# error "LOG_RING_SIZE must be power of two"
+#endif
+
+#define LOG_LEVEL_NONE 0      ///< No messages
+#define LOG_LEVEL_ERROR 1     ///< Errors
+#define LOG_LEVEL_WARNING 2   ///< Errors and warnings
+#define LOG_LEVEL_DEBUG 3     ///< Errors, warnings and debug messages
+#define LOG_LEVEL_TRACE 4     ///< All messages
+
+#ifndef LSM303_LOG_LEVEL
+# define LSM303_LOG_LEVEL LOG_LEVEL_TRACE
+#endif
+
+#ifdef LSM303_LOG_FILE_LEVEL
+# define LOG_LEVEL_ LSM303_LOG_FILE_LEVEL
+#else
+# define LOG_LEVEL_ LSM303_LOG_LEVEL
+#endif
+
+#define LOG_SYNC 0xA5U         ///< Binary record sync byte
+#define LOG_ARGS 12U           ///< Max arguments of binary record
+
 extern UART_HandleTypeDef* huart_;
-extern char printbuf[128];
 
 void setlog(UART_HandleTypeDef* uart);
 
+/// \brief Write data into log ring buffer
+/// \details ISR-safe. Data are dropped if ring buffer has no room
+/// \param data Data pointer
+/// \param size Data size
+/// \return Written size: \c 0U if dropped
+uint16_t log_write(const uint8_t* data, const uint16_t size);
+
+/// \brief UART transmission complete
+/// \details Call from \c HAL_UART_TxCpltCallback
+/// \param uart UART handler
+void log_txcplt(UART_HandleTypeDef* uart);
+
+/// \brief Pending data
+/// \details Data in ring buffer not transmitted yet: wait for \c 0 before stop mode
+/// \return Pending size
+uint16_t log_pending(void);
+
+/// \brief Dropped messages
+/// \return Count of messages dropped because of full ring buffer
+uint32_t log_dropped(void);
+
+/// \brief Text message with header
+/// \param level Level name or \c 0 for message without header
+/// \param func Function name
+/// \param file File name
+/// \param line Line number
+/// \param fmt Format
+void log_text(const char* level, const char* func, const char* file, const unsigned line, const char* fmt, ...) __attribute__((format(printf, 5, 6)));
+
+/// \brief Binary message
+/// \param level Level: \c 'T', \c 'D', \c 'W' or \c 'E'
+/// \param fmt Format
+/// \param args Arguments
+/// \param n Arguments count
+void log_bin(const uint8_t level, const char* fmt, const uint32_t* args, const uint8_t n);
+
+static inline uint32_t log_argu(const uint32_t v) { return v; }
+static inline uint32_t log_argp(const void* v) { return (uint32_t)(uintptr_t)v; }
+static inline uint32_t log_argf(const float v) { union { float f; uint32_t u; } c = { .f = v }; return c.u; }
+static inline uint32_t log_argd(const double v) { return log_argf((float)v); }
+
+#define log_arg(a) _Generic((a), float: log_argf, double: log_argd, char*: log_argp, const char*: log_argp, void*: log_argp, const void*: log_argp, default: log_argu)(a)
+
+#define LOG_CAT_(a, b) a##b
+#define LOG_NARGS_(...) LOG_NARGS__(0, ##__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS__(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+#define LOG_MAP_(N, ...) LOG_CAT_(LOG_MAP_, N)(__VA_ARGS__)
+#define LOG_MAP_0()
+#define LOG_MAP_1(a) , log_arg(a)
+#define LOG_MAP_2(a, ...) , log_arg(a) LOG_MAP_1(__VA_ARGS__)
+#define LOG_MAP_3(a, ...) , log_arg(a) LOG_MAP_2(__VA_ARGS__)
+#define LOG_MAP_4(a, ...) , log_arg(a) LOG_MAP_3(__VA_ARGS__)
+#define LOG_MAP_5(a, ...) , log_arg(a) LOG_MAP_4(__VA_ARGS__)
+#define LOG_MAP_6(a, ...) , log_arg(a) LOG_MAP_5(__VA_ARGS__)
+#define LOG_MAP_7(a, ...) , log_arg(a) LOG_MAP_6(__VA_ARGS__)
+#define LOG_MAP_8(a, ...) , log_arg(a) LOG_MAP_7(__VA_ARGS__)
+#define LOG_MAP_9(a, ...) , log_arg(a) LOG_MAP_8(__VA_ARGS__)
+#define LOG_MAP_10(a, ...) , log_arg(a) LOG_MAP_9(__VA_ARGS__)
+#define LOG_MAP_11(a, ...) , log_arg(a) LOG_MAP_10(__VA_ARGS__)
+#define LOG_MAP_12(a, ...) , log_arg(a) LOG_MAP_11(__VA_ARGS__)
+
+#define xBin_(lvl, fmt, ...) if (huart_ != 0) {                                                             \
+        const uint32_t a_[] = { 0U LOG_MAP_(LOG_NARGS_(__VA_ARGS__), ##__VA_ARGS__) };                      \
+        log_bin(lvl, fmt, &a_[1], LOG_NARGS_(__VA_ARGS__));                                                 \
+    }
+
 #define __FILENAME__ (strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__)
 
+#ifdef LOG_DEFERRED
+
+#define xTrace(fmt, ...) xBin_('T', fmt, ##__VA_ARGS__)
+#define xDebug(fmt, ...) xBin_('D', fmt, ##__VA_ARGS__)
+#define xWarning(fmt, ...) xBin_('W', fmt, ##__VA_ARGS__)
+#define xError(fmt, ...) xBin_('E', fmt, ##__VA_ARGS__)
+
+#else
+
 #define xTrace(fmt, ...) if (huart_ != 0) {                                                                 \
-        const uint16_t sz = sprintf(&printbuf[0], fmt, ##__VA_ARGS__);                                      \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
+        log_text(0, 0, 0, 0U, fmt, ##__VA_ARGS__);                                                          \
     }
 
 #define xDebug(fmt, ...) if (huart_ != 0) {                                                                 \
-        uint16_t sz = sprintf(&printbuf[0], "[%s %s: %u] DEBUG ", __FUNCTION__, __FILENAME__, __LINE__);    \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
-        sz = sprintf(&printbuf[0], fmt, ##__VA_ARGS__);                                                     \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
+        log_text("DEBUG", __FUNCTION__, __FILENAME__, __LINE__, fmt, ##__VA_ARGS__);                        \
     }
 
 #define xWarning(fmt, ...) if (huart_ != 0) {                                                               \
-        uint16_t sz = sprintf(&printbuf[0], "[%s %s: %u] WARNING ", __FUNCTION__, __FILENAME__, __LINE__);  \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
-        sz = sprintf(&printbuf[0], fmt, ##__VA_ARGS__);                                                     \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
+        log_text("WARNING", __FUNCTION__, __FILENAME__, __LINE__, fmt, ##__VA_ARGS__);                      \
     }
 
 #define xError(fmt, ...) if (huart_ != 0) {                                                                 \
-        uint16_t sz = sprintf(&printbuf[0], "[%s %s: %u] ERROR ", __FUNCTION__, __FILENAME__, __LINE__);    \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
-        sz = sprintf(&printbuf[0], fmt, ##__VA_ARGS__);                                                     \
-        HAL_UART_Transmit(huart_, (uint8_t*)&printbuf[0], sz, 1000);                                        \
+        log_text("ERROR", __FUNCTION__, __FILENAME__, __LINE__, fmt, ##__VA_ARGS__);                        \
     }
 
-#endif // __LOG_H__
\ No newline at end of file
+#endif // LOG_DEFERRED
+
+#if LOG_LEVEL_ < LOG_LEVEL_TRACE
+# undef xTrace
+# define xTrace(fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL_ < LOG_LEVEL_DEBUG
+# undef xDebug
+# define xDebug(fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL_ < LOG_LEVEL_WARNING
+# undef xWarning
+# define xWarning(fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL_ < LOG_LEVEL_ERROR
+# undef xError
+# define xError(fmt, ...) ((void)0)
+#endif
+
+#endif // __LOG_H__
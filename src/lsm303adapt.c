@@ -0,0 +1,46 @@
+/// \file lsm303adapt.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303adapt.h"
+#include "log.h"
+
+// Switch accelerometer mode of the state
+static uint8_t lsm303_adapt_set(lsm303_adapt_t* a, const lsm303_adapt_state_t state)
+{
+    const uint8_t ret = state == LSM303_ADAPT_IDLE
+        ? lsm303_la_mode(a->dev, a->idle, 1U, 0U)
+        : lsm303_la_mode(a->dev, a->active, 0U, a->hr);
+    if (ret != HAL_OK) return ret;
+    if (a->state != state) a->switches++;
+    a->state = state;
+    xDebug("Accelerometer %s\n", state == LSM303_ADAPT_IDLE ? "idle" : "active");
+    return HAL_OK;
+}
+
+uint8_t lsm303_adapt_init(lsm303_adapt_t* a, lsm303_dev_t* dev, const lsm303_la_datarate_t idle, const lsm303_la_datarate_t active, const uint8_t hr, const uint32_t hold, const uint32_t tick)
+{
+    if (0 == a || 0 == dev) return HAL_ERROR;
+    a->dev = dev;
+    a->idle = idle;
+    a->active = active;
+    a->hr = hr == 0U ? 0U : 1U;
+    a->hold = hold;
+    a->last = tick;
+    a->state = LSM303_ADAPT_ACTIVE;
+    a->switches = 0U;
+    return lsm303_adapt_set(a, LSM303_ADAPT_ACTIVE);
+}
+
+uint8_t lsm303_adapt_step(lsm303_adapt_t* a, const uint32_t activity, const uint32_t tick)
+{
+    if (0 == a || 0 == a->dev) return HAL_ERROR;
+    if (activity != 0U) {
+        a->last = tick;
+        if (a->state == LSM303_ADAPT_IDLE) return lsm303_adapt_set(a, LSM303_ADAPT_ACTIVE);
+        return HAL_OK;
+    }
+    if (a->state == LSM303_ADAPT_ACTIVE && tick - a->last >= a->hold) return lsm303_adapt_set(a, LSM303_ADAPT_IDLE);
+    return HAL_OK;
+}
@@ -0,0 +1,62 @@
+/// \file lsm303adapt.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_ADAPT_H__
+#define __LSM303_ADAPT_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303adapt 8. LSM303 Adaptive Data Rate
+/// \brief Activity-adaptive accelerometer data rate
+/// \details Accelerometer runs at low data rate in low-power mode while there is no activity, and at high data rate
+/// after activity (\b motionLP_step trigger, \c INT1 interrupt or any other source) is reported.
+/// Mode is changed by \b lsm303_la_mode: one burst write of changed registers, sensitivity is updated.
+/// \details Detectors depending on data rate (filter coefficients by \b getAlpha, \c INT1 duration) see the new rate after
+/// switch: \c INT1, free-fall and click durations are data rate ticks, reprogram them when lsm303_adapt_t::switches
+/// changes. Fixed-point detectors must be initialized for new lsm303_dev_t::alsb
+
+/// \brief Adaptive data rate state
+/// \ingroup lsm303adapt
+typedef enum {
+    LSM303_ADAPT_ACTIVE    = 0, ///< High data rate
+    LSM303_ADAPT_IDLE      = 1  ///< Low data rate, low-power mode
+} lsm303_adapt_state_t;
+
+/// \brief Adaptive data rate policy
+/// \ingroup lsm303adapt
+typedef struct {
+    lsm303_dev_t* dev;              ///< Device handler
+    lsm303_la_datarate_t idle;      ///< Data rate of idle state, e.g. \c LSM303_ADATARATE_10
+    lsm303_la_datarate_t active;    ///< Data rate of active state, e.g. \c LSM303_ADATARATE_400 or \c LSM303_ADATARATE_SPEC
+    uint8_t hr;                     ///< High-resolution mode of active state
+    uint32_t hold;                  ///< Time without activity before idle state, ticks of \c tick argument
+    uint32_t last;                  ///< Tick of the last activity
+    lsm303_adapt_state_t state;     ///< Current state
+    uint32_t switches;              ///< Number of state changes
+} lsm303_adapt_t;
+
+/// \brief Adaptive data rate initialization
+/// \details Start in active state
+/// \param a Policy pointer
+/// \param dev Device handler. Configured by \b lsm303_la_setup
+/// \param idle Data rate of idle state
+/// \param active Data rate of active state
+/// \param hr High-resolution mode of active state: \c 0 - disable, \c 1 - enable
+/// \param hold Time without activity before idle state
+/// \param tick Current time
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303adapt
+uint8_t lsm303_adapt_init(lsm303_adapt_t* a, lsm303_dev_t* dev, const lsm303_la_datarate_t idle, const lsm303_la_datarate_t active, const uint8_t hr, const uint32_t hold, const uint32_t tick);
+
+/// \brief Adaptive data rate update
+/// \details Call it for every sample or event. Failed mode change is retried by the next call
+/// \param a Policy pointer
+/// \param activity Activity is detected: \c 0 - no, other - yes
+/// \param tick Current time
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303adapt
+uint8_t lsm303_adapt_step(lsm303_adapt_t* a, const uint32_t activity, const uint32_t tick);
+
+#endif // __LSM303_ADAPT_H__
@@ -20,390 +20,949 @@
 # define RAD2DEG 57.295779513082320876798154814105F
 #endif
 
-float motionLP(const float x, const float y, const float z, const float alpha, const float delta, const uint8_t sample)
+enum { X, Y, Z };
+
+#ifdef LSM303_FAST_MATH
+
+// Square root by FPU instruction
+static inline float lsm303_sqrtf(const float v)
+{
+#if defined(__ARM_FP) && (__ARM_FP & 4)
+    float r;
+    __asm volatile ("vsqrt.f32 %0, %1" : "=t"(r) : "t"(v));
+    return r;
+#else
+    return sqrtf(v);
+#endif
+}
+
+// Fast inverse square root and one Newton step
+static inline float lsm303_invsqrtf(const float v)
 {
-    static uint8_t setup = 0;
-    static uint8_t smpl = 0;
-    // preview data
-    static float pX = 0.0;
-    static float pY = 0.0;
-    static float pZ = 0.0;
-    // filtered data
-    static float fX = 0.0;
-    static float fY = 0.0;
-    static float fZ = 0.0;
+    union { float f; uint32_t i; } u = { .f = v };
+    u.i = 0x5F3759DFUL - (u.i >> 1);
+    return u.f * (1.5F - 0.5F * v * u.f * u.f);
+}
+
+// Fast inverse square root and two Newton steps: orthonormal rotation matrix
+static inline float lsm303_invsqrtf2(const float v)
+{
+    const float r = lsm303_invsqrtf(v);
+    return r * (1.5F - 0.5F * v * r * r);
+}
+
+// Arctangent of 2 arguments: 9th order polynomial
+static inline float lsm303_atan2f(const float y, const float x)
+{
+    const float ax = fabsf(x);
+    const float ay = fabsf(y);
+    if (ax == 0.0F && ay == 0.0F) return 0.0F;
+    const float t = (ax > ay) ? ay / ax : ax / ay;
+    const float t2 = t * t;
+    float r = t * (0.9998660F + t2 * (-0.3302995F + t2 * (0.1801410F + t2 * (-0.0851330F + t2 * 0.0208351F))));
+    if (ay > ax) r = (float)(0.5 * M_PI) - r;
+    if (x < 0.0F) r = (float)M_PI - r;
+    return (y < 0.0F) ? -r : r;
+}
+
+// Arccosine: 3rd order polynomial
+static inline float lsm303_acosf(const float v)
+{
+    const float x = fabsf(v) < 1.0F ? fabsf(v) : 1.0F;
+    const float r = lsm303_sqrtf(1.0F - x) * (1.5707288F + x * (-0.2121144F + x * (0.0742610F - 0.0187293F * x)));
+    return (v < 0.0F) ? (float)M_PI - r : r;
+}
+
+#else
+
+# define lsm303_sqrtf sqrtf
+# define lsm303_invsqrtf(v) (1.0F / sqrtf(v))
+# define lsm303_invsqrtf2(v) (1.0F / sqrtf(v))
+# define lsm303_atan2f atan2f
+# define lsm303_acosf acosf
+
+#endif // LSM303_FAST_MATH
+
+// Signed square of threshold for comparison with squared magnitude
+static inline float lsm303_sq(const float v)
+{
+    return v * fabsf(v);
+}
+
+void motionLP_init(lsm303_motion_lp_t* s, const float alpha, const float delta, const uint8_t sample)
+{
+    s->alpha = alpha;
+    s->delta = delta;
+    s->sample = sample;
+    motionLP_reset(s);
+}
+
+void motionLP_reset(lsm303_motion_lp_t* s)
+{
+    s->setup = 0U;
+    s->smpl = 0U;
+}
+
+float motionLP_step(lsm303_motion_lp_t* s, const float x, const float y, const float z)
+{
+    const float alpha = s->alpha;
     // first iteration
-    if (setup == 0) {
-        fX = x;
-        fY = y;
-        fZ = z;
-        setup++;
+    if (s->setup == 0) {
+        s->f[X] = x;
+        s->f[Y] = y;
+        s->f[Z] = z;
+        s->setup++;
         return 0.0F;
     }
     // Low-pass filter
-    fX = alpha * x + (1.0F - alpha) * fX;
-    fY = alpha * y + (1.0F - alpha) * fY;
-    fZ = alpha * z + (1.0F - alpha) * fZ;
+    s->f[X] = alpha * x + (1.0F - alpha) * s->f[X];
+    s->f[Y] = alpha * y + (1.0F - alpha) * s->f[Y];
+    s->f[Z] = alpha * z + (1.0F - alpha) * s->f[Z];
     // Accumulation
-    if (setup < CNTSETUP) {
-        pX = fX;
-        pY = fY;
-        pZ = fZ;
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->p[X] = s->f[X];
+        s->p[Y] = s->f[Y];
+        s->p[Z] = s->f[Z];
+        s->setup++;
         return 0.0F;
     }
     // Samples
-    if (smpl++ < sample) return 0.0;
-    smpl = 0;
+    if (s->smpl++ < s->sample) return 0.0;
+    s->smpl = 0;
     // Delta
-    const float dX = fabsf(fX - pX);
-    const float dY = fabsf(fY - pY);
-    const float dZ = fabsf(fZ - pZ);
-    // Magnitude
-    const float m = sqrtf(dX * dX + dY * dY + dZ * dZ);
-    if (m > delta) {
-        setup = 0;
+    const float dX = fabsf(s->f[X] - s->p[X]);
+    const float dY = fabsf(s->f[Y] - s->p[Y]);
+    const float dZ = fabsf(s->f[Z] - s->p[Z]);
+    // Squared magnitude
+    const float m2 = dX * dX + dY * dY + dZ * dZ;
+    if (m2 > lsm303_sq(s->delta)) {
+        const float m = lsm303_sqrtf(m2);
+        s->setup = 0;
         xDebug("%f, %f, %f\tD: %f\n", x, y, z, m);
         return m;
     }
     return 0.0F;
 }
 
-float motionK(const float x, const float y, const float z, const float Q, const float R, const float E, const float delta, const uint8_t sample)
+float motionLP_block(lsm303_motion_lp_t* s, const lsm303_block_t* a, const uint16_t n)
+{
+    float ret = 0.0F;
+    uint16_t i = 0;
+    while (i < n) {
+        // Accumulation and check samples
+        if (s->setup < CNTSETUP || s->smpl >= s->sample) {
+            const float m = motionLP_step(s, a->x[i], a->y[i], a->z[i]);
+            if (m > ret) ret = m;
+            ++i;
+            continue;
+        }
+        // Filter only till the next check sample
+        uint16_t k = s->sample - s->smpl;
+        if (k > n - i) k = n - i;
+        const float alpha = s->alpha;
+        const float beta = 1.0F - alpha;
+        float fX = s->f[X];
+        float fY = s->f[Y];
+        float fZ = s->f[Z];
+        const float* const x = &a->x[i];
+        const float* const y = &a->y[i];
+        const float* const z = &a->z[i];
+        for (uint16_t j = 0; j < k; ++j) {
+            fX = alpha * x[j] + beta * fX;
+            fY = alpha * y[j] + beta * fY;
+            fZ = alpha * z[j] + beta * fZ;
+        }
+        s->f[X] = fX;
+        s->f[Y] = fY;
+        s->f[Z] = fZ;
+        s->smpl += k;
+        i += k;
+    }
+    return ret;
+}
+
+float motionLP(const float x, const float y, const float z, const float alpha, const float delta, const uint8_t sample)
+{
+    static lsm303_motion_lp_t s = { 0 };
+    s.alpha = alpha;
+    s.delta = delta;
+    s.sample = sample;
+    return motionLP_step(&s, x, y, z);
+}
+
+void motionK_init(lsm303_motion_k_t* s, const float Q, const float R, const float E, const float delta, const uint8_t sample)
+{
+    s->Q = Q;
+    s->R = R;
+    s->E = E;
+    s->delta = delta;
+    s->sample = sample;
+    motionK_reset(s);
+}
+
+void motionK_reset(lsm303_motion_k_t* s)
 {
-    static uint8_t setup = 0;
-    static uint8_t smpl = 0;
-    // Prediction estimate (filtered data)
-    static float fX = 0.0;
-    static float fY = 0.0;
-    static float fZ = 0.0;
-    // Prediction error
-    static float eX = 0.0;
-    static float eY = 0.0;
-    static float eZ = 0.0;
-    // preview data
-    static float pX = 0.0;
-    static float pY = 0.0;
-    static float pZ = 0.0;
+    s->setup = 0U;
+    s->smpl = 0U;
+}
+
+float motionK_step(lsm303_motion_k_t* s, const float x, const float y, const float z)
+{
+    const float in[3] = { x, y, z };
     // first iteration
-    if (setup == 0) {
-        // Prediction estimate
-        fX = x;
-        fY = y;
-        fZ = z;
-        // Prediction error
-        eX = eY = eZ = E;
-        setup++;
+    if (s->setup == 0) {
+        for (uint8_t i = 0; i < 3; ++i) {
+            s->f[i] = in[i];    // Prediction estimate
+            s->e[i] = s->E;     // Prediction error
+        }
+        s->setup++;
         return 0.0F;
     }
-    // Kalman filter X
-    eX += Q;                // Prediction of a new error
-    float K = eX / (eX + R);// Calculation of the Kalman coefficient
-    fX += K * (x - fX);     // Estimate update
-    eX *= (1.0 - K);        // Error update
-    // Kalman filter Y
-    eY += Q;                // Prediction of a new error
-    K = eY / (eY + R);      // Calculation of the Kalman coefficient
-    fY += K * (y - fY);     // Estimate update
-    eY *= (1.0 - K);        // Error update
-    // Kalman filter Z
-    eZ += Q;                // Prediction of a new error
-    K = eZ / (eZ + R);      // Calculation of the Kalman coefficient
-    fZ += K * (z - fZ);     // Estimate update
-    eZ *= (1.0 - K);        // Error update
-    //xTrace("%f, %f, %f, %f, %f, %f\n", x, y, z, fX + 10.0, fY + 10.0, fZ + 10.0);
+    // Kalman filter
+    for (uint8_t i = 0; i < 3; ++i) {
+        s->e[i] += s->Q;                    // Prediction of a new error
+        const float K = s->e[i] / (s->e[i] + s->R); // Calculation of the Kalman coefficient
+        s->f[i] += K * (in[i] - s->f[i]);   // Estimate update
+        s->e[i] *= (1.0F - K);              // Error update
+    }
     // Accumulation
-    if (setup < CNTSETUP) {
-        pX = fX;
-        pY = fY;
-        pZ = fZ;
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->p[X] = s->f[X];
+        s->p[Y] = s->f[Y];
+        s->p[Z] = s->f[Z];
+        s->setup++;
         return 0.0F;
     }
     // Samples
-    if (smpl++ < sample) return 0.0;
-    smpl = 0;
+    if (s->smpl++ < s->sample) return 0.0;
+    s->smpl = 0;
     // Delta
-    const float dX = fabsf(fX - pX);
-    const float dY = fabsf(fY - pY);
-    const float dZ = fabsf(fZ - pZ);
-    // Magnitude
-    const float m = sqrtf(dX * dX + dY * dY + dZ * dZ);
-    if (m > delta && m < 1.0) {
-        setup = 0;
+    const float dX = fabsf(s->f[X] - s->p[X]);
+    const float dY = fabsf(s->f[Y] - s->p[Y]);
+    const float dZ = fabsf(s->f[Z] - s->p[Z]);
+    // Squared magnitude
+    const float m2 = dX * dX + dY * dY + dZ * dZ;
+    if (m2 > lsm303_sq(s->delta) && m2 < 1.0F) {
+        const float m = lsm303_sqrtf(m2);
+        s->setup = 0;
         xDebug("%f, %f, %f\tD: %f\n", x, y, z, m);
         return m;
     }
     return 0.0F;
 }
 
-float distortionHP(const float x, const float y, const float z, const float alpha, const float delta)
+float motionK_block(lsm303_motion_k_t* s, const lsm303_block_t* a, const uint16_t n)
 {
-    static uint8_t setup = 0;
-    // prev input
-    static float iX = 0.0F;
-    static float iY = 0.0F;
-    static float iZ = 0.0F;
-    // prev output
-    static float oX = 0.0F;
-    static float oY = 0.0F;
-    static float oZ = 0.0F;
-    // prev magnitude
-    static float M = 0.0F;
+    float ret = 0.0F;
+    uint16_t i = 0;
+    while (i < n) {
+        // Accumulation and check samples
+        if (s->setup < CNTSETUP || s->smpl >= s->sample) {
+            const float m = motionK_step(s, a->x[i], a->y[i], a->z[i]);
+            if (m > ret) ret = m;
+            ++i;
+            continue;
+        }
+        // Filter only till the next check sample
+        uint16_t k = s->sample - s->smpl;
+        if (k > n - i) k = n - i;
+        const float Q = s->Q;
+        const float R = s->R;
+        const float* const in[3] = { &a->x[i], &a->y[i], &a->z[i] };
+        for (uint8_t c = 0; c < 3; ++c) {
+            float f = s->f[c];
+            float e = s->e[c];
+            const float* const v = in[c];
+            for (uint16_t j = 0; j < k; ++j) {
+                e += Q;                     // Prediction of a new error
+                const float K = e / (e + R);// Calculation of the Kalman coefficient
+                f += K * (v[j] - f);        // Estimate update
+                e *= (1.0F - K);            // Error update
+            }
+            s->f[c] = f;
+            s->e[c] = e;
+        }
+        s->smpl += k;
+        i += k;
+    }
+    return ret;
+}
+
+float motionK(const float x, const float y, const float z, const float Q, const float R, const float E, const float delta, const uint8_t sample)
+{
+    static lsm303_motion_k_t s = { 0 };
+    s.Q = Q;
+    s.R = R;
+    s.E = E;
+    s.delta = delta;
+    s.sample = sample;
+    return motionK_step(&s, x, y, z);
+}
+
+void distortionHP_init(lsm303_distortion_hp_t* s, const float alpha, const float delta)
+{
+    s->alpha = alpha;
+    s->delta = delta;
+    distortionHP_reset(s);
+}
+
+void distortionHP_reset(lsm303_distortion_hp_t* s)
+{
+    // high-pass filter history is read from the first sample
+    for (uint8_t i = 0; i < 3; ++i) {
+        s->i[i] = 0.0F;
+        s->o[i] = 0.0F;
+    }
+    s->M = 0.0F;
+    s->setup = 0U;
+}
+
+float distortionHP_step(lsm303_distortion_hp_t* s, const float x, const float y, const float z)
+{
+    const float alpha = s->alpha;
     // high-pass filter
-    oX = alpha * (oX + x - iX);
-    oY = alpha * (oY + y - iY);
-    oZ = alpha * (oZ + z - iZ);
-    iX = x;
-    iY = y;
-    iZ = z;
+    s->o[X] = alpha * (s->o[X] + x - s->i[X]);
+    s->o[Y] = alpha * (s->o[Y] + y - s->i[Y]);
+    s->o[Z] = alpha * (s->o[Z] + z - s->i[Z]);
+    s->i[X] = x;
+    s->i[Y] = y;
+    s->i[Z] = z;
     // difference
-    const float dX = iX - oX;
-    const float dY = iY - oY;
-    const float dZ = iZ - oZ;
+    const float dX = s->i[X] - s->o[X];
+    const float dY = s->i[Y] - s->o[Y];
+    const float dZ = s->i[Z] - s->o[Z];
     // magnitude
-    const float m = sqrtf(dX * dX + dY * dY + dZ * dZ);
+    const float m = lsm303_sqrtf(dX * dX + dY * dY + dZ * dZ);
     // average magnitude
-    if (setup == 0U) {
-        M = m;
-        setup++;
-		return 0.0F;
+    if (s->setup == 0U) {
+        s->M = m;
+        s->setup++;
+        return 0.0F;
     }
     // magnitude low-pass filter
-    if (setup < CNTSETUP) {
-        M = alpha * m + (1.0F - alpha) * M;
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->M = alpha * m + (1.0F - alpha) * s->M;
+        s->setup++;
         return 0.0F;
     }
     // check
-    const float d = fabsf(M - m);
-    if (d > delta) {
-        xDebug("%f, %f, %f\tM: %f m: %f D: %f\n", x, y, z, M, m, d);
-        setup = 0;
+    const float d = fabsf(s->M - m);
+    if (d > s->delta) {
+        xDebug("%f, %f, %f\tM: %f m: %f D: %f\n", x, y, z, s->M, m, d);
+        s->setup = 0;
         return d;
     }
     return 0.0F;
 }
 
-float distortionLP(const float x, const float y, const float z, const float alpha, const float delta)
+float distortionHP(const float x, const float y, const float z, const float alpha, const float delta)
+{
+    static lsm303_distortion_hp_t s = { 0 };
+    s.alpha = alpha;
+    s.delta = delta;
+    return distortionHP_step(&s, x, y, z);
+}
+
+void distortionLP_init(lsm303_distortion_lp_t* s, const float alpha, const float delta)
+{
+    s->alpha = alpha;
+    s->delta = delta;
+    distortionLP_reset(s);
+}
+
+void distortionLP_reset(lsm303_distortion_lp_t* s)
 {
-    static uint8_t setup = 0;
-    // average
-    static float aX = 0.0F;
-    static float aY = 0.0F;
-    static float aZ = 0.0F;
+    s->setup = 0U;
+}
+
+float distortionLP_step(lsm303_distortion_lp_t* s, const float x, const float y, const float z)
+{
+    const float alpha = s->alpha;
     // first iteration
-    if (setup == 0) {
-        aX = x;
-        aY = y;
-        aZ = z;
-        setup++;
+    if (s->setup == 0) {
+        s->a[X] = x;
+        s->a[Y] = y;
+        s->a[Z] = z;
+        s->setup++;
         return 0.0F;
     }
     // difference
-    const float dX = x - aX;
-    const float dY = y - aY;
-    const float dZ = z - aZ;
+    const float dX = x - s->a[X];
+    const float dY = y - s->a[Y];
+    const float dZ = z - s->a[Z];
     // low-pass
-    aX = alpha * x + (1.0F - alpha) * aX;
-    aY = alpha * y + (1.0F - alpha) * aY;
-    aZ = alpha * z + (1.0F - alpha) * aZ;
+    s->a[X] = alpha * x + (1.0F - alpha) * s->a[X];
+    s->a[Y] = alpha * y + (1.0F - alpha) * s->a[Y];
+    s->a[Z] = alpha * z + (1.0F - alpha) * s->a[Z];
     // accumulate
-    if (setup < CNTSETUP) {
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->setup++;
         return 0.0F;
     }
-    // magnitude
-    const float m = sqrtf(dX * dX + dY * dY + dZ * dZ);
-    if (m > delta) {
+    // squared magnitude
+    const float m2 = dX * dX + dY * dY + dZ * dZ;
+    if (m2 > lsm303_sq(s->delta)) {
+        const float m = lsm303_sqrtf(m2);
         xDebug("%f, %f, %f\tD: %f\n", x, y, z, m);
-        setup = 0;
+        s->setup = 0;
         return m;
     }
     return 0.0F;
 }
 
-uint8_t orientLP(const float a[3], const float m[3], const float alpha, float* pitch, float* roll, float* yaw)
+float distortionLP(const float x, const float y, const float z, const float alpha, const float delta)
+{
+    static lsm303_distortion_lp_t s = { 0 };
+    s.alpha = alpha;
+    s.delta = delta;
+    return distortionLP_step(&s, x, y, z);
+}
+
+void orientLP_init(lsm303_orient_lp_t* s, const float alpha)
+{
+    s->alpha = alpha;
+    orientLP_reset(s);
+}
+
+void orientLP_reset(lsm303_orient_lp_t* s)
 {
-    enum { X, Y, Z };
-    static uint8_t setup = 0U;
-    // filtered data
-    static float aX = 0.0;
-    static float aY = 0.0;
-    static float aZ = 0.0;
-    static float mX = 0.0;
-    static float mY = 0.0;
-    static float mZ = 0.0;
+    s->setup = 0U;
+}
+
+// Orientation low-pass filter: 1U while data is accumulated
+static inline uint8_t orientLP_filter(lsm303_orient_lp_t* s, const float a[3], const float m[3])
+{
+    const float alpha = s->alpha;
     // first iteration
-    if (setup == 0U) {
-        aX = a[X];
-        aY = a[Y];
-        aZ = a[Z];
-        mX = m[X];
-        mY = m[Y];
-        mZ = m[Z];
-        setup++;
+    if (s->setup == 0U) {
+        for (uint8_t i = 0; i < 3; ++i) {
+            s->a[i] = a[i];
+            s->m[i] = m[i];
+        }
+        s->setup++;
         return 1U;
     }
     // Low-pass filter
-    aX = alpha * a[X] + (1.0F - alpha) * aX;
-    aY = alpha * a[Y] + (1.0F - alpha) * aY;
-    aZ = alpha * a[Z] + (1.0F - alpha) * aZ;
-    mX = alpha * m[X] + (1.0F - alpha) * mX;
-    mY = alpha * m[Y] + (1.0F - alpha) * mY;
-    mZ = alpha * m[Z] + (1.0F - alpha) * mZ;
+    for (uint8_t i = 0; i < 3; ++i) {
+        s->a[i] = alpha * a[i] + (1.0F - alpha) * s->a[i];
+        s->m[i] = alpha * m[i] + (1.0F - alpha) * s->m[i];
+    }
     // accumulate
-    if (setup < CNTSETUP) {
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->setup++;
         return 1U;
     }
+    return 0U;
+}
+
+// Pitch, roll and yaw by filtered accelerometer and magnetometer data. Filter state is not modified
+static void orient(const float fA[3], const float fM[3], float* pitch, float* roll, float* yaw)
+{
     // pitch & roll
-    *pitch = atan2f(aX, sqrtf(aY * aY + aZ * aZ)) * RAD2DEG;
-    *roll = atan2f(aY, sqrtf(aX * aX + aZ * aZ)) * RAD2DEG;
+    *pitch = lsm303_atan2f(fA[X], lsm303_sqrtf(fA[Y] * fA[Y] + fA[Z] * fA[Z])) * RAD2DEG;
+    *roll = lsm303_atan2f(fA[Y], lsm303_sqrtf(fA[X] * fA[X] + fA[Z] * fA[Z])) * RAD2DEG;
     // normalize accelerometer
-    float N = sqrtf(aX * aX + aY * aY + aZ * aZ);
-    aX /= N;
-    aY /= N;
-    aZ /= N;
+    float N = lsm303_invsqrtf(fA[X] * fA[X] + fA[Y] * fA[Y] + fA[Z] * fA[Z]);
+    const float nA[3] = { fA[X] * N, fA[Y] * N, fA[Z] * N };
     // normalize magnetometer
-    N = sqrtf(mX * mX + mY * mY + mZ * mZ);
-    mX /= N;
-    mY /= N;
-    mZ /= N;
+    N = lsm303_invsqrtf(fM[X] * fM[X] + fM[Y] * fM[Y] + fM[Z] * fM[Z]);
+    const float nM[3] = { fM[X] * N, fM[Y] * N, fM[Z] * N };
     // magnetic field horizontal projection
-    const float Mx = mX * aZ - mZ * aX;
-    const float My = mY * aZ - mZ * aY;
+    const float Mx = nM[X] * nA[Z] - nM[Z] * nA[X];
+    const float My = nM[Y] * nA[Z] - nM[Z] * nA[Y];
     // yaw
-    *yaw = atan2f(My, Mx) * RAD2DEG;
+    *yaw = lsm303_atan2f(My, Mx) * RAD2DEG;
     xDebug("Pitch: %.02f°, Roll: %.02f°, Yaw: %.02f°\n", *pitch, *roll, *yaw);
+}
+
+// Cross product
+static inline void lsm303_cross(const float u[3], const float v[3], float w[3])
+{
+    w[X] = u[Y] * v[Z] - u[Z] * v[Y];
+    w[Y] = u[Z] * v[X] - u[X] * v[Z];
+    w[Z] = u[X] * v[Y] - u[Y] * v[X];
+}
+
+uint8_t lsm303_triad(const float a[3], const float m[3], float R[3][3])
+{
+    // Down: accelerometer measures reaction to gravity
+    const float a2 = a[X] * a[X] + a[Y] * a[Y] + a[Z] * a[Z];
+    if (!(a2 > 0.0F)) return 1U;
+    const float N = -lsm303_invsqrtf2(a2);
+    const float d[3] = { a[X] * N, a[Y] * N, a[Z] * N };
+    // East: perpendicular to down and magnetic field
+    float e[3];
+    lsm303_cross(d, m, e);
+    const float e2 = e[X] * e[X] + e[Y] * e[Y] + e[Z] * e[Z];
+    if (!(e2 > 0.0F)) return 1U;
+    const float E = lsm303_invsqrtf2(e2);
+    e[X] *= E;
+    e[Y] *= E;
+    e[Z] *= E;
+    // North: unit vector without normalization
+    float n[3];
+    lsm303_cross(e, d, n);
+    for (uint8_t i = 0; i < 3; ++i) {
+        R[0][i] = n[i];
+        R[1][i] = e[i];
+        R[2][i] = d[i];
+    }
     return 0U;
 }
 
-uint8_t orientK(const float a[3], const float m[3], const float Q, const float R, const float E, float *pitch, float *roll, float *yaw)
+void lsm303_dcm2quat(const float R[3][3], float q[4])
+{
+    // Shepperd's method: the largest component avoids division by small value
+    const float t = R[0][0] + R[1][1] + R[2][2];
+    if (t > 0.0F) {
+        const float s = 0.5F * lsm303_invsqrtf2(t + 1.0F);
+        q[0] = 0.25F / s;
+        q[1] = (R[2][1] - R[1][2]) * s;
+        q[2] = (R[0][2] - R[2][0]) * s;
+        q[3] = (R[1][0] - R[0][1]) * s;
+    } else if (R[0][0] > R[1][1] && R[0][0] > R[2][2]) {
+        const float s = 0.5F * lsm303_invsqrtf2(1.0F + R[0][0] - R[1][1] - R[2][2]);
+        q[0] = (R[2][1] - R[1][2]) * s;
+        q[1] = 0.25F / s;
+        q[2] = (R[0][1] + R[1][0]) * s;
+        q[3] = (R[0][2] + R[2][0]) * s;
+    } else if (R[1][1] > R[2][2]) {
+        const float s = 0.5F * lsm303_invsqrtf2(1.0F + R[1][1] - R[0][0] - R[2][2]);
+        q[0] = (R[0][2] - R[2][0]) * s;
+        q[1] = (R[0][1] + R[1][0]) * s;
+        q[2] = 0.25F / s;
+        q[3] = (R[1][2] + R[2][1]) * s;
+    } else {
+        const float s = 0.5F * lsm303_invsqrtf2(1.0F + R[2][2] - R[0][0] - R[1][1]);
+        q[0] = (R[1][0] - R[0][1]) * s;
+        q[1] = (R[0][2] + R[2][0]) * s;
+        q[2] = (R[1][2] + R[2][1]) * s;
+        q[3] = 0.25F / s;
+    }
+    // Sign of quaternion is not unique: keep scalar part positive
+    if (q[0] < 0.0F) {
+        for (uint8_t i = 0; i < 4; ++i) q[i] = -q[i];
+    }
+}
+
+void lsm303_dcm2euler(const float R[3][3], float* pitch, float* roll, float* yaw)
+{
+    *pitch = lsm303_atan2f(-R[2][0], lsm303_sqrtf(R[2][1] * R[2][1] + R[2][2] * R[2][2])) * RAD2DEG;
+    *roll = lsm303_atan2f(R[2][1], R[2][2]) * RAD2DEG;
+    *yaw = lsm303_atan2f(R[1][0], R[0][0]) * RAD2DEG;
+}
+
+uint8_t orientLP_step(lsm303_orient_lp_t* s, const float a[3], const float m[3], float* pitch, float* roll, float* yaw)
+{
+    if (orientLP_filter(s, a, m) != 0U) return 1U;
+    orient(s->a, s->m, pitch, roll, yaw);
+    return 0U;
+}
+
+uint8_t orientLP_block(lsm303_orient_lp_t* s, const lsm303_block_t* a, const lsm303_block_t* m, const uint16_t n, float* pitch, float* roll, float* yaw)
+{
+    uint8_t ret = 1U;
+    for (uint16_t i = 0; i < n; ++i) {
+        const float va[3] = { a->x[i], a->y[i], a->z[i] };
+        const float vm[3] = { m->x[i], m->y[i], m->z[i] };
+        ret = orientLP_filter(s, va, vm);
+    }
+    if (ret != 0U) return 1U;
+    orient(s->a, s->m, pitch, roll, yaw);
+    return 0U;
+}
+
+uint8_t orientLP(const float a[3], const float m[3], const float alpha, float* pitch, float* roll, float* yaw)
+{
+    static lsm303_orient_lp_t s = { 0 };
+    s.alpha = alpha;
+    return orientLP_step(&s, a, m, pitch, roll, yaw);
+}
+
+uint8_t orientLP_dcm(lsm303_orient_lp_t* s, const float a[3], const float m[3], float R[3][3])
+{
+    if (orientLP_filter(s, a, m) != 0U) return 1U;
+    return lsm303_triad(s->a, s->m, R);
+}
+
+void orientK_init(lsm303_orient_k_t* s, const float Q, const float R, const float E)
+{
+    s->Q = Q;
+    s->R = R;
+    s->E = E;
+    orientK_reset(s);
+}
+
+void orientK_reset(lsm303_orient_k_t* s)
+{
+    s->setup = 0U;
+}
+
+// Orientation Kalman filter: 1U while data is accumulated
+static inline uint8_t orientK_filter(lsm303_orient_k_t* s, const float a[3], const float m[3])
 {
-    enum { X, Y, Z };
-    static uint8_t setup = 0U;
-    // Prediction estimate (filtered data)
-    static float fA[3] = { 0 };
-    static float fM[3] = { 0 };
-    // Prediction error
-    static float eA[3] = { 0 };
-    static float eM[3] = { 0 };
     // First iteration
-    if (setup == 0U) {
-        // Prediction estimate
-        fA[X] = a[X];
-        fA[Y] = a[Y];
-        fA[Z] = a[Z];
-        fM[X] = m[X];
-        fM[Y] = m[Y];
-        fM[Z] = m[Z];
-        // Prediction error
-        eA[X] = eA[Y] = eA[Z] = E;
-        eM[X] = eM[Y] = eM[Z] = E;
-        setup++;
+    if (s->setup == 0U) {
+        for (uint8_t i = 0; i < 3; ++i) {
+            // Prediction estimate
+            s->fA[i] = a[i];
+            s->fM[i] = m[i];
+            // Prediction error
+            s->eA[i] = s->E;
+            s->eM[i] = s->E;
+        }
+        s->setup++;
         return 1U;
     }
     // Kalman filter
     float N = 0.0F;
     for (uint8_t i = 0; i < 3; ++i) {
         // accelerometer
-        eA[i] += Q;                     // Prediction of a new error
-        N = eA[i] / (eA[i] + R);        // Calculation of the Kalman coefficient
-        fA[i] += N * (a[i] - fA[i]);    // Estimate update
-        eA[i] *= (1.0 - N);             // Error update
+        s->eA[i] += s->Q;                       // Prediction of a new error
+        N = s->eA[i] / (s->eA[i] + s->R);       // Calculation of the Kalman coefficient
+        s->fA[i] += N * (a[i] - s->fA[i]);      // Estimate update
+        s->eA[i] *= (1.0F - N);                 // Error update
         // magnetometer
-        eM[i] += Q;                     // Prediction of a new error
-        N = eM[i] / (eM[i] + R);        // Calculation of the Kalman coefficient
-        fM[i] += N * (m[i] - fM[i]);    // Estimate update
-        eM[i] *= (1.0 - N);             // Error update
+        s->eM[i] += s->Q;                       // Prediction of a new error
+        N = s->eM[i] / (s->eM[i] + s->R);       // Calculation of the Kalman coefficient
+        s->fM[i] += N * (m[i] - s->fM[i]);      // Estimate update
+        s->eM[i] *= (1.0F - N);                 // Error update
     }
     // accumulate
-    if (setup < CNTSETUP) {
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->setup++;
         return 1U;
     }
-    // pitch & roll
-    *pitch = atan2f(fA[X], sqrtf(fA[Y] * fA[Y] + fA[Z] * fA[Z])) * RAD2DEG;
-    *roll = atan2f(fA[Y], sqrtf(fA[X] * fA[X] + fA[Z] * fA[Z])) * RAD2DEG;
-    // normalize accelerometer
-    N = sqrtf(fA[X] * fA[X] + fA[Y] * fA[Y] + fA[Z] * fA[Z]);
-    fA[X] /= N;
-    fA[Y] /= N;
-    fA[Z] /= N;
-    // normalize magnetometer
-    N = sqrtf(fM[X] * fM[X] + fM[Y] * fM[Y] + fM[Z] * fM[Z]);
-    fM[X] /= N;
-    fM[Y] /= N;
-    fM[Z] /= N;
-    // magnetic field horizontal projection
-    const float Mx = fM[X] * fA[Z] - fM[Z] * fA[X];
-    const float My = fM[Y] * fA[Z] - fM[Z] * fA[Y];
-    // yaw
-    *yaw = atan2f(My, Mx) * RAD2DEG;
-    xDebug("Pitch: %.02f°, Roll: %.02f°, Yaw: %.02f°\n", *pitch, *roll, *yaw);
     return 0U;
 }
 
-float inclineLP(const float x, const float y, const float z, const float alpha, const float delta)
+uint8_t orientK_step(lsm303_orient_k_t* s, const float a[3], const float m[3], float* pitch, float* roll, float* yaw)
+{
+    if (orientK_filter(s, a, m) != 0U) return 1U;
+    orient(s->fA, s->fM, pitch, roll, yaw);
+    return 0U;
+}
+
+uint8_t orientK_block(lsm303_orient_k_t* s, const lsm303_block_t* a, const lsm303_block_t* m, const uint16_t n, float* pitch, float* roll, float* yaw)
+{
+    uint8_t ret = 1U;
+    for (uint16_t i = 0; i < n; ++i) {
+        const float va[3] = { a->x[i], a->y[i], a->z[i] };
+        const float vm[3] = { m->x[i], m->y[i], m->z[i] };
+        ret = orientK_filter(s, va, vm);
+    }
+    if (ret != 0U) return 1U;
+    orient(s->fA, s->fM, pitch, roll, yaw);
+    return 0U;
+}
+
+uint8_t orientK(const float a[3], const float m[3], const float Q, const float R, const float E, float *pitch, float *roll, float *yaw)
+{
+    static lsm303_orient_k_t s = { 0 };
+    s.Q = Q;
+    s.R = R;
+    s.E = E;
+    return orientK_step(&s, a, m, pitch, roll, yaw);
+}
+
+uint8_t orientK_dcm(lsm303_orient_k_t* s, const float a[3], const float m[3], float R[3][3])
+{
+    if (orientK_filter(s, a, m) != 0U) return 1U;
+    return lsm303_triad(s->fA, s->fM, R);
+}
+
+void inclineLP_init(lsm303_incline_lp_t* s, const float alpha, const float delta)
 {
-    static uint8_t setup = 0U;
-    // filtered data
-    static float aX = 0.0;
-    static float aY = 0.0;
-    static float aZ = 0.0;
+    s->alpha = alpha;
+    s->delta = delta;
+    inclineLP_reset(s);
+}
+
+void inclineLP_reset(lsm303_incline_lp_t* s)
+{
+    s->setup = 0U;
+}
+
+float inclineLP_step(lsm303_incline_lp_t* s, const float x, const float y, const float z)
+{
+    const float alpha = s->alpha;
     // first iteration
-    if (setup == 0U) {
-        aX = x;
-        aY = y;
-        aZ = z;
-        setup++;
+    if (s->setup == 0U) {
+        s->a[X] = x;
+        s->a[Y] = y;
+        s->a[Z] = z;
+        s->setup++;
         return 0.0F;
     }
     // Low-pass filter
-    aX = alpha * x + (1.0F - alpha) * aX;
-    aY = alpha * y + (1.0F - alpha) * aY;
-    aZ = alpha * z + (1.0F - alpha) * aZ;
+    s->a[X] = alpha * x + (1.0F - alpha) * s->a[X];
+    s->a[Y] = alpha * y + (1.0F - alpha) * s->a[Y];
+    s->a[Z] = alpha * z + (1.0F - alpha) * s->a[Z];
     // accumulate
-    if (setup < CNTSETUP) {
-        setup++;
+    if (s->setup < CNTSETUP) {
+        s->setup++;
         return 0.0;
     }
     // angle
-    const float theta = acosf(aZ / sqrtf(aX * aX + aY *aY + aZ * aZ)) * RAD2DEG;
-    if (theta > fabsf(delta)) {
+    const float* const a = &s->a[0];
+    const float theta = lsm303_acosf(a[Z] / lsm303_sqrtf(a[X] * a[X] + a[Y] * a[Y] + a[Z] * a[Z])) * RAD2DEG;
+    if (theta > fabsf(s->delta)) {
         xDebug("%f, %f, %f\tA: %.02f°\n", x, y, z, theta);
-        setup = 0;
+        s->setup = 0;
         return theta;
     }
     return 0.0F;
 }
 
-stage_t detectFall(const float x, const float y, const float z, const float wThs, const float iThs)
+float inclineLP(const float x, const float y, const float z, const float alpha, const float delta)
+{
+    static lsm303_incline_lp_t s = { 0 };
+    s.alpha = alpha;
+    s.delta = delta;
+    return inclineLP_step(&s, x, y, z);
+}
+
+void detectFall_init(lsm303_fall_t* s, const float wThs, const float iThs)
+{
+    s->wThs = wThs;
+    s->iThs = iThs;
+    detectFall_reset(s);
+}
+
+void detectFall_reset(lsm303_fall_t* s)
 {
-    static stage_t stage = STAGE_INIT;
-    static uint8_t smpl = 0;
-    const float M = sqrtf(x * x + y * y + z * z);
-    switch (stage) {
+    s->stage = STAGE_INIT;
+}
+
+stage_t detectFall_step(lsm303_fall_t* s, const float x, const float y, const float z)
+{
+    const float M2 = x * x + y * y + z * z;
+    switch (s->stage) {
     case STAGE_INIT:
-        if (M < wThs) {
-            stage = STAGE_WEIGHLESSNESS;
-            xDebug("WEIGHLESSNESS: %f\n", M);
+        if (M2 < lsm303_sq(s->wThs)) {
+            s->stage = STAGE_WEIGHLESSNESS;
+            xDebug("WEIGHLESSNESS: %f\n", lsm303_sqrtf(M2));
         }
         break;
     case STAGE_WEIGHLESSNESS:
-        if (M > iThs) {
-            stage = STAGE_FALL;
-            xDebug("FALL: %f\n", M);
+        if (M2 > lsm303_sq(s->iThs)) {
+            s->stage = STAGE_FALL;
+            xDebug("FALL: %f\n", lsm303_sqrtf(M2));
         }
         break;
     case STAGE_FALL:
-        if (wThs + iThs == 0.0) {
-            stage = STAGE_INIT;
+        if (s->wThs + s->iThs == 0.0) {
+            s->stage = STAGE_INIT;
             xDebug("Reset Stage to INIT\n");
         }
     }
-    return stage;
+    return s->stage;
+}
+
+stage_t detectFall(const float x, const float y, const float z, const float wThs, const float iThs)
+{
+    static lsm303_fall_t s = { .stage = STAGE_INIT };
+    s.wThs = wThs;
+    s.iThs = iThs;
+    return detectFall_step(&s, x, y, z);
+}
+
+// Shared values of pipeline stream
+enum {
+    PIPE_M2 = 0x01,     // Squared magnitude of sample
+    PIPE_F1 = 0x02,     // Magnitude of filtered data
+    PIPE_D2 = 0x04      // Squared magnitude of sample deviation from filtered data
+};
+
+void lsm303_pipe_init(lsm303_pipe_t* p)
+{
+    for (uint8_t i = 0; i < LSM303_PIPE_STREAMS; ++i) {
+        lsm303_pipe_stream_t* const s = &p->s[i];
+        s->filter = LSM303_PIPE_LP;
+        s->alpha = 0.1F;
+        s->Q = s->R = s->E = 0.0F;
+        s->need = 0U;
+        s->mask = 0U;
+    }
+    p->n = 0U;
+    lsm303_pipe_reset(p);
+}
+
+uint8_t lsm303_pipe_lp(lsm303_pipe_t* p, const uint8_t stream, const float alpha)
+{
+    if (stream >= LSM303_PIPE_STREAMS) return HAL_ERROR;
+    p->s[stream].filter = LSM303_PIPE_LP;
+    p->s[stream].alpha = alpha;
+    p->s[stream].setup = 0U;
+    return HAL_OK;
+}
+
+uint8_t lsm303_pipe_kalman(lsm303_pipe_t* p, const uint8_t stream, const float Q, const float R, const float E)
+{
+    if (stream >= LSM303_PIPE_STREAMS) return HAL_ERROR;
+    p->s[stream].filter = LSM303_PIPE_KALMAN;
+    p->s[stream].Q = Q;
+    p->s[stream].R = R;
+    p->s[stream].E = E;
+    p->s[stream].setup = 0U;
+    return HAL_OK;
+}
+
+uint8_t lsm303_pipe_add(lsm303_pipe_t* p, const uint8_t stream, const lsm303_pipe_kind_t kind, const float delta, const float limit, const uint8_t sample, uint8_t* id)
+{
+    if (stream >= LSM303_PIPE_STREAMS || p->n >= LSM303_PIPE_DETECTORS) return HAL_ERROR;
+    lsm303_pipe_det_t* const d = &p->d[p->n];
+    d->kind = kind;
+    d->stream = stream;
+    d->delta = delta;
+    d->limit = limit;
+    d->sample = sample;
+    d->smpl = 0U;
+    d->hold = 0U;
+    d->stage = 0U;
+    d->value = 0.0F;
+    lsm303_pipe_stream_t* const s = &p->s[stream];
+    switch (kind) {
+    case LSM303_PIPE_INCLINE:
+        s->need |= PIPE_F1;
+        break;
+    case LSM303_PIPE_DISTORTION:
+        s->need |= PIPE_D2;
+        break;
+    case LSM303_PIPE_FALL:
+        s->need |= PIPE_M2;
+        break;
+    default:
+        break;
+    }
+    s->mask |= 1UL << p->n;
+    if (0 != id) *id = p->n;
+    p->n++;
+    return HAL_OK;
+}
+
+void lsm303_pipe_reset(lsm303_pipe_t* p)
+{
+    for (uint8_t i = 0; i < LSM303_PIPE_STREAMS; ++i) p->s[i].setup = 0U;
+    for (uint8_t i = 0; i < p->n; ++i) {
+        p->d[i].smpl = 0U;
+        p->d[i].hold = 0U;
+        p->d[i].stage = 0U;
+        p->d[i].value = 0.0F;
+    }
+}
+
+uint32_t lsm303_pipe_step(lsm303_pipe_t* p, const uint8_t stream, const float x, const float y, const float z)
+{
+    if (stream >= LSM303_PIPE_STREAMS) return 0U;
+    lsm303_pipe_stream_t* const s = &p->s[stream];
+    if (s->mask == 0U) return 0U;
+    const float in[3] = { x, y, z };
+    float* const f = &s->f[0];
+    uint8_t ready = 0U;
+    // Shared filter stage
+    if (s->setup == 0U) {
+        for (uint8_t i = 0; i < 3; ++i) {
+            f[i] = in[i];
+            s->e[i] = s->E;
+        }
+        s->setup++;
+    }
+    else {
+        if (s->need & PIPE_D2) {
+            const float dX = x - f[X];
+            const float dY = y - f[Y];
+            const float dZ = z - f[Z];
+            s->d2 = dX * dX + dY * dY + dZ * dZ;
+        }
+        if (s->filter == LSM303_PIPE_KALMAN) {
+            for (uint8_t i = 0; i < 3; ++i) {
+                s->e[i] += s->Q;
+                const float K = s->e[i] / (s->e[i] + s->R);
+                f[i] += K * (in[i] - f[i]);
+                s->e[i] *= (1.0F - K);
+            }
+        }
+        else {
+            const float alpha = s->alpha;
+            const float beta = 1.0F - alpha;
+            f[X] = alpha * x + beta * f[X];
+            f[Y] = alpha * y + beta * f[Y];
+            f[Z] = alpha * z + beta * f[Z];
+        }
+        if (s->setup < CNTSETUP) s->setup++;
+        else ready = 1U;
+    }
+    // Shared magnitude stage
+    if (s->need & PIPE_M2) s->m2 = x * x + y * y + z * z;
+    if ((s->need & PIPE_F1) && ready) s->f1 = lsm303_sqrtf(f[X] * f[X] + f[Y] * f[Y] + f[Z] * f[Z]);
+    // Threshold stages
+    uint32_t ev = 0U;
+    for (uint8_t k = 0; k < p->n; ++k) {
+        if ((s->mask & (1UL << k)) == 0U) continue;
+        lsm303_pipe_det_t* const d = &p->d[k];
+        if (d->kind == LSM303_PIPE_FALL) {
+            if (d->stage == 0U) {
+                if (s->m2 < lsm303_sq(d->delta)) d->stage = 1U;
+            }
+            else if (s->m2 > lsm303_sq(d->limit)) {
+                d->stage = 0U;
+                d->value = lsm303_sqrtf(s->m2);
+                ev |= 1UL << k;
+            }
+            continue;
+        }
+        // Reference accumulation and hold after trigger
+        if (ready == 0U || d->hold != 0U) {
+            d->p[X] = f[X];
+            d->p[Y] = f[Y];
+            d->p[Z] = f[Z];
+            if (ready != 0U) d->hold--;
+            continue;
+        }
+        switch (d->kind) {
+        case LSM303_PIPE_MOTION: {
+            if (d->smpl++ < d->sample) break;
+            d->smpl = 0U;
+            const float dX = f[X] - d->p[X];
+            const float dY = f[Y] - d->p[Y];
+            const float dZ = f[Z] - d->p[Z];
+            const float m2 = dX * dX + dY * dY + dZ * dZ;
+            // Kalman stream: deviation of 1 and more is ignored as by motionK_step
+            if (m2 > lsm303_sq(d->delta) && (s->filter != LSM303_PIPE_KALMAN || m2 < 1.0F)) {
+                d->value = lsm303_sqrtf(m2);
+                ev |= 1UL << k;
+            }
+            break;
+        }
+        case LSM303_PIPE_INCLINE:
+            if (s->f1 > 0.0F) {
+                const float theta = lsm303_acosf(f[Z] / s->f1) * RAD2DEG;
+                if (theta > fabsf(d->delta)) {
+                    d->value = theta;
+                    ev |= 1UL << k;
+                }
+            }
+            break;
+        case LSM303_PIPE_DISTORTION:
+            if (s->d2 > lsm303_sq(d->delta)) {
+                d->value = lsm303_sqrtf(s->d2);
+                ev |= 1UL << k;
+            }
+            break;
+        default:
+            break;
+        }
+        if (ev & (1UL << k)) d->hold = CNTSETUP;
+    }
+    return ev;
+}
+
+uint32_t lsm303_pipe_block(lsm303_pipe_t* p, const uint8_t stream, const lsm303_block_t* a, const uint16_t n)
+{
+    uint32_t ev = 0U;
+    for (uint16_t i = 0; i < n; ++i) ev |= lsm303_pipe_step(p, stream, a->x[i], a->y[i], a->z[i]);
+    return ev;
 }
 
 float getAlpha(const float rate, const float cutoff)
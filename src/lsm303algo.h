@@ -12,6 +12,73 @@
 
 /// \defgroup lsm303algo 3. LSM303 Algorithmes
 /// \brief LSM303 Algorithmes functions
+/// \details Every algorithm has caller-owned state (\c *_init, \c *_reset and \c *_step functions) for several instances.
+/// \details The functions without state use one internal instance per algorithm
+/// \details Detectors compare squared magnitude with squared threshold: square root is taken only for the returned trigger value.
+/// \details Define \c LSM303_FAST_MATH for approximated math functions (typical Cortex-M4F cycles, newlib):
+/// | Function            | Default                    | \c LSM303_FAST_MATH                           | Max error        |
+/// |---------------------|----------------------------|-----------------------------------------------|------------------|
+/// | \c sqrtf            | library, ~30 cycles        | \c vsqrt.f32, 14 cycles                       | exact            |
+/// | normalization \c 1/N| \c sqrtf and division, ~45 | fast inverse square root + 1 Newton step, ~10 | 0.18 % relative  |
+/// | TRIAD \c 1/N        | \c sqrtf and division, ~45 | fast inverse square root + 2 Newton steps, ~14| 5e-6 relative    |
+/// | \c atan2f           | library, ~150..250 cycles  | 9th order polynomial, ~35 cycles              | 1.2e-5 rad       |
+/// | \c acosf            | library, ~150..250 cycles  | 3rd order polynomial and \c sqrt, ~30 cycles  | 7e-5 rad         |
+/// \note Fast inverse square root is used only for orientation normalization, where its scale error cancels in yaw, and for rotation matrix with extra Newton step. Incline uses \c sqrt and division: \c acos is sensitive to the argument error near \c 1
+
+/// \brief Block of samples
+/// \details Structure of arrays: \c n items of every axis
+/// \ingroup lsm303algo
+typedef struct {
+    float* x;   ///< X axis array
+    float* y;   ///< Y axis array
+    float* z;   ///< Z axis array
+} lsm303_block_t;
+
+/// \brief Motion detection by low-pass filter state
+/// \details Caller-owned state of \b motionLP_step. Initialize it by \b motionLP_init
+/// \ingroup lsm303algo
+typedef struct {
+    float alpha;    ///< Coefficient of the low-pass filter. (1 > a > 0)
+    float delta;    ///< Trigger threshold
+    uint8_t sample; ///< Samples for checks (duration of measurement)
+    uint8_t setup;  ///< Accumulated samples
+    uint8_t smpl;   ///< Samples counter
+    float p[3];     ///< Reference (accumulated) data
+    float f[3];     ///< Filtered data
+} lsm303_motion_lp_t;
+
+/// \brief Motion detection by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. (1 > a > 0)
+/// \param delta Trigger threshold
+/// \param sample Samples for checks (duration of measurement)
+/// \ingroup lsm303algo
+void motionLP_init(lsm303_motion_lp_t* s, const float alpha, const float delta, const uint8_t sample);
+
+/// \brief Motion detection by low-pass filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void motionLP_reset(lsm303_motion_lp_t* s);
+
+/// \brief Motion detection by linear accelerometer
+/// \details Using \b low_pass \b filter for exclude reaction on shocks
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return \c 0.0F if motion don't detected or value of the trigger
+/// \ingroup lsm303algo
+float motionLP_step(lsm303_motion_lp_t* s, const float x, const float y, const float z);
+
+/// \brief Motion detection by linear accelerometer for block of samples
+/// \details Same as \b motionLP_step for every sample. Samples between the checks are filtered by one tight loop
+/// \param s State pointer
+/// \param a Block of samples (for example FIFO data)
+/// \param n Number of samples
+/// \return \c 0.0F if motion don't detected or maximum value of the triggers in block
+/// \ingroup lsm303algo
+float motionLP_block(lsm303_motion_lp_t* s, const lsm303_block_t* a, const uint16_t n);
 
 /// \brief Motion detection by linear accelerometer
 /// \details Using \b low_pass \b filter for exclude reaction on shocks
@@ -25,6 +92,57 @@
 /// \ingroup lsm303algo
 float motionLP(const float x, const float y, const float z, const float alpha, const float delta, const uint8_t sample);
 
+/// \brief Motion detection by Kalman filter state
+/// \details Caller-owned state of \b motionK_step. Initialize it by \b motionK_init
+/// \ingroup lsm303algo
+typedef struct {
+    float Q;        ///< Process covariance
+    float R;        ///< Measurement covariance
+    float E;        ///< Error prediction
+    float delta;    ///< Trigger threshold
+    uint8_t sample; ///< Samples for checks (duration of measurement)
+    uint8_t setup;  ///< Accumulated samples
+    uint8_t smpl;   ///< Samples counter
+    float f[3];     ///< Prediction estimate (filtered data)
+    float e[3];     ///< Prediction error
+    float p[3];     ///< Reference (accumulated) data
+} lsm303_motion_k_t;
+
+/// \brief Motion detection by Kalman filter initialization
+/// \param s State pointer
+/// \param Q Process covariance
+/// \param R Measurement covariance
+/// \param E Error prediction
+/// \param delta Trigger threshold
+/// \param sample Samples for checks (duration of measurement)
+/// \ingroup lsm303algo
+void motionK_init(lsm303_motion_k_t* s, const float Q, const float R, const float E, const float delta, const uint8_t sample);
+
+/// \brief Motion detection by Kalman filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void motionK_reset(lsm303_motion_k_t* s);
+
+/// \brief Motion detection by linear accelerometer
+/// \details Using \b Kalman \b filter for exclude reaction on shocks
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return \c 0.0F if motion don't detected or value of the trigger
+/// \ingroup lsm303algo
+float motionK_step(lsm303_motion_k_t* s, const float x, const float y, const float z);
+
+/// \brief Motion detection by linear accelerometer for block of samples
+/// \details Same as \b motionK_step for every sample. Samples between the checks are filtered by one tight loop per axis
+/// \param s State pointer
+/// \param a Block of samples (for example FIFO data)
+/// \param n Number of samples
+/// \return \c 0.0F if motion don't detected or maximum value of the triggers in block
+/// \ingroup lsm303algo
+float motionK_block(lsm303_motion_k_t* s, const lsm303_block_t* a, const uint16_t n);
+
 /// \brief Motion detection by linear accelerometer
 /// \details Using \b Kalman \b filter for exclude reaction on shocks
 /// \param x X axis
@@ -39,6 +157,41 @@ float motionLP(const float x, const float y, const float z, const float alpha, c
 /// \ingroup lsm303algo
 float motionK(const float x, const float y, const float z, const float Q, const float R, const float E, const float delta, const uint8_t sample);
 
+/// \brief Detection of magnetic field distortion by high-pass filter state
+/// \details Caller-owned state of \b distortionHP_step. Initialize it by \b distortionHP_init
+/// \ingroup lsm303algo
+typedef struct {
+    float alpha;    ///< Coefficient of the high-pass filter. (1 > a > 0)
+    float delta;    ///< Trigger threshold
+    uint8_t setup;  ///< Accumulated samples
+    float i[3];     ///< Previous input
+    float o[3];     ///< Previous output
+    float M;        ///< Average magnitude
+} lsm303_distortion_hp_t;
+
+/// \brief Detection of magnetic field distortion by high-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the high-pass filter. (1 > a > 0)
+/// \param delta Trigger threshold
+/// \ingroup lsm303algo
+void distortionHP_init(lsm303_distortion_hp_t* s, const float alpha, const float delta);
+
+/// \brief Detection of magnetic field distortion by high-pass filter reset
+/// \details Restart data accumulation and clear filter history, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void distortionHP_reset(lsm303_distortion_hp_t* s);
+
+/// \brief Detection of magnetic field distortion
+/// \details Using \b high-pass \b filter for detection
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return \c 0.0F if distortion don't detected or value of the trigger
+/// \ingroup lsm303algo
+float distortionHP_step(lsm303_distortion_hp_t* s, const float x, const float y, const float z);
+
 /// \brief Detection of magnetic field distortion
 /// \details Using \b high-pass \b filter for detection
 /// \param x X axis
@@ -50,6 +203,39 @@ float motionK(const float x, const float y, const float z, const float Q, const
 /// \ingroup lsm303algo
 float distortionHP(const float x, const float y, const float z, const float alpha, const float delta);
 
+/// \brief Detection of magnetic field distortion by low-pass filter state
+/// \details Caller-owned state of \b distortionLP_step. Initialize it by \b distortionLP_init
+/// \ingroup lsm303algo
+typedef struct {
+    float alpha;    ///< Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+    float delta;    ///< Trigger threshold
+    uint8_t setup;  ///< Accumulated samples
+    float a[3];     ///< Average
+} lsm303_distortion_lp_t;
+
+/// \brief Detection of magnetic field distortion by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+/// \param delta Trigger threshold
+/// \ingroup lsm303algo
+void distortionLP_init(lsm303_distortion_lp_t* s, const float alpha, const float delta);
+
+/// \brief Detection of magnetic field distortion by low-pass filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void distortionLP_reset(lsm303_distortion_lp_t* s);
+
+/// \brief Detection of magnetic field distortion
+/// \details Using \b low-pass \b filter for detection
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return \c 0.0F if distortion don't detected or value of the trigger
+/// \ingroup lsm303algo
+float distortionLP_step(lsm303_distortion_lp_t* s, const float x, const float y, const float z);
+
 /// \brief Detection of magnetic field distortion
 /// \details Using \b low-pass \b filter for detection
 /// \param x X axis
@@ -61,6 +247,53 @@ float distortionHP(const float x, const float y, const float z, const float alph
 /// \ingroup lsm303algo
 float distortionLP(const float x, const float y, const float z, const float alpha, const float delta);
 
+/// \brief Orientation by low-pass filter state
+/// \details Caller-owned state of \b orientLP_step. Initialize it by \b orientLP_init
+/// \ingroup lsm303algo
+typedef struct {
+    float alpha;    ///< Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+    uint8_t setup;  ///< Accumulated samples
+    float a[3];     ///< Filtered accelerometer data
+    float m[3];     ///< Filtered magnetometer data
+} lsm303_orient_lp_t;
+
+/// \brief Orientation by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+/// \ingroup lsm303algo
+void orientLP_init(lsm303_orient_lp_t* s, const float alpha);
+
+/// \brief Orientation by low-pass filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void orientLP_reset(lsm303_orient_lp_t* s);
+
+/// \brief Orientation by linear accelerometer and magnetometer
+/// \details Using \b low-pass \b filter
+/// \param s State pointer
+/// \param a Array of linear accelerometer axis
+/// \param m Array of magnetic field axis
+/// \param pitch Pitch pointer
+/// \param roll Roll pointer
+/// \param yaw Yaw pointer
+/// \return \c 0U if \b pitch, \b roll and \b yaw haz calculated or \c 1U is not calculated (no accumulated data for calculation)
+/// \ingroup lsm303algo
+uint8_t orientLP_step(lsm303_orient_lp_t* s, const float a[3], const float m[3], float* pitch, float* roll, float* yaw);
+
+/// \brief Orientation by linear accelerometer and magnetometer for block of samples
+/// \details Filter all samples of block and calculate \b pitch, \b roll and \b yaw once by the last filtered data
+/// \param s State pointer
+/// \param a Block of linear accelerometer samples
+/// \param m Block of magnetic field samples (time-aligned with \c a)
+/// \param n Number of samples
+/// \param pitch Pitch pointer
+/// \param roll Roll pointer
+/// \param yaw Yaw pointer
+/// \return \c 0U if \b pitch, \b roll and \b yaw haz calculated or \c 1U is not calculated (no accumulated data for calculation)
+/// \ingroup lsm303algo
+uint8_t orientLP_block(lsm303_orient_lp_t* s, const lsm303_block_t* a, const lsm303_block_t* m, const uint16_t n, float* pitch, float* roll, float* yaw);
+
 /// \brief Orientation by linear accelerometer and magnetometer
 /// \details Using \b low-pass \b filter
 /// \param a Array of linear accelerometer axis
@@ -73,6 +306,69 @@ float distortionLP(const float x, const float y, const float z, const float alph
 /// \ingroup lsm303algo
 uint8_t orientLP(const float a[3], const float m[3], const float alpha, float* pitch, float* roll, float* yaw);
 
+/// \brief Rotation matrix by low-pass filter
+/// \details Filter samples like \b orientLP_step and build the attitude by \b lsm303_triad: no trigonometric functions
+/// \param s State pointer
+/// \param a Array of linear accelerometer axis
+/// \param m Array of magnetic field axis
+/// \param R Rotation matrix from sensor to \b NED frame
+/// \return \c 0U if \b R haz calculated or \c 1U is not calculated (no accumulated data or degenerated vectors)
+/// \ingroup lsm303algo
+uint8_t orientLP_dcm(lsm303_orient_lp_t* s, const float a[3], const float m[3], float R[3][3]);
+
+/// \brief Orientation by Kalman filter state
+/// \details Caller-owned state of \b orientK_step. Initialize it by \b orientK_init
+/// \ingroup lsm303algo
+typedef struct {
+    float Q;        ///< Process covariance
+    float R;        ///< Measurement covariance
+    float E;        ///< Error prediction
+    uint8_t setup;  ///< Accumulated samples
+    float fA[3];    ///< Prediction estimate of accelerometer
+    float fM[3];    ///< Prediction estimate of magnetometer
+    float eA[3];    ///< Prediction error of accelerometer
+    float eM[3];    ///< Prediction error of magnetometer
+} lsm303_orient_k_t;
+
+/// \brief Orientation by Kalman filter initialization
+/// \param s State pointer
+/// \param Q Process covariance
+/// \param R Measurement covariance
+/// \param E Error prediction
+/// \ingroup lsm303algo
+void orientK_init(lsm303_orient_k_t* s, const float Q, const float R, const float E);
+
+/// \brief Orientation by Kalman filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void orientK_reset(lsm303_orient_k_t* s);
+
+/// \brief Orientation by linear accelerometer and magnetometer
+/// \details Using \b Kalman \b filter
+/// \param s State pointer
+/// \param a Array of linear accelerometer axis
+/// \param m Array of magnetic field axis
+/// \param pitch Pitch pointer
+/// \param roll Roll pointer
+/// \param yaw Yaw pointer
+/// \return \c 0U if \b pitch, \b roll and \b yaw haz calculated or \c 1U is not calculated (no accumulated data for calculation)
+/// \ingroup lsm303algo
+uint8_t orientK_step(lsm303_orient_k_t* s, const float a[3], const float m[3], float* pitch, float* roll, float* yaw);
+
+/// \brief Orientation by linear accelerometer and magnetometer for block of samples
+/// \details Filter all samples of block and calculate \b pitch, \b roll and \b yaw once by the last filtered data
+/// \param s State pointer
+/// \param a Block of linear accelerometer samples
+/// \param m Block of magnetic field samples (time-aligned with \c a)
+/// \param n Number of samples
+/// \param pitch Pitch pointer
+/// \param roll Roll pointer
+/// \param yaw Yaw pointer
+/// \return \c 0U if \b pitch, \b roll and \b yaw haz calculated or \c 1U is not calculated (no accumulated data for calculation)
+/// \ingroup lsm303algo
+uint8_t orientK_block(lsm303_orient_k_t* s, const lsm303_block_t* a, const lsm303_block_t* m, const uint16_t n, float* pitch, float* roll, float* yaw);
+
 /// \brief Orientation by linear accelerometer and magnetometer
 /// \details Using \b Kalman \b filter
 /// \param a Array of linear accelerometer axis
@@ -87,6 +383,75 @@ uint8_t orientLP(const float a[3], const float m[3], const float alpha, float* p
 /// \ingroup lsm303algo
 uint8_t orientK(const float a[3], const float m[3], const float Q, const float R, const float E, float* pitch, float* roll, float* yaw);
 
+/// \brief Rotation matrix by Kalman filter
+/// \details Filter samples like \b orientK_step and build the attitude by \b lsm303_triad: no trigonometric functions
+/// \param s State pointer
+/// \param a Array of linear accelerometer axis
+/// \param m Array of magnetic field axis
+/// \param R Rotation matrix from sensor to \b NED frame
+/// \return \c 0U if \b R haz calculated or \c 1U is not calculated (no accumulated data or degenerated vectors)
+/// \ingroup lsm303algo
+uint8_t orientK_dcm(lsm303_orient_k_t* s, const float a[3], const float m[3], float R[3][3]);
+
+/// \brief Rotation matrix by TRIAD
+/// \details Cross products and normalization only: \b down is opposite to acceleration, \b east is perpendicular
+/// to down and magnetic field, \b north completes right-handed frame. Rows of \b R are north, east and down in sensor frame
+/// \param a Array of linear accelerometer axis
+/// \param m Array of magnetic field axis
+/// \param R Rotation matrix from sensor to \b NED frame: \c v_ned = R * v_sensor
+/// \return \c 0U if success or \c 1U if acceleration is zero or parallel to magnetic field
+/// \ingroup lsm303algo
+uint8_t lsm303_triad(const float a[3], const float m[3], float R[3][3]);
+
+/// \brief Quaternion of rotation matrix
+/// \details One inverse square root, scalar part is not negative
+/// \param R Rotation matrix
+/// \param q Quaternion \c w, \c x, \c y, \c z
+/// \ingroup lsm303algo
+void lsm303_dcm2quat(const float R[3][3], float q[4]);
+
+/// \brief Euler angles of rotation matrix
+/// \details Yaw-pitch-roll (\c Z-Y-X) sequence in degrees. Call it only when angles are needed
+/// \param R Rotation matrix
+/// \param pitch Pitch pointer
+/// \param roll Roll pointer
+/// \param yaw Yaw pointer: heading from magnetic north
+/// \ingroup lsm303algo
+void lsm303_dcm2euler(const float R[3][3], float* pitch, float* roll, float* yaw);
+
+/// \brief Incline angle by low-pass filter state
+/// \details Caller-owned state of \b inclineLP_step. Initialize it by \b inclineLP_init
+/// \ingroup lsm303algo
+typedef struct {
+    float alpha;    ///< Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+    float delta;    ///< Trigger threshold: angle limit in degrees for triggering (used absolute value)
+    uint8_t setup;  ///< Accumulated samples
+    float a[3];     ///< Filtered data
+} lsm303_incline_lp_t;
+
+/// \brief Incline angle by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+/// \param delta Trigger threshold: angle limit in degrees for triggering (used absolute value)
+/// \ingroup lsm303algo
+void inclineLP_init(lsm303_incline_lp_t* s, const float alpha, const float delta);
+
+/// \brief Incline angle by low-pass filter reset
+/// \details Restart data accumulation, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void inclineLP_reset(lsm303_incline_lp_t* s);
+
+/// \brief Incline angle by linear accelerometer
+/// \details Using \b low-pass \b filter
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return \c 0.0F if angle less then \c delta or angle in degrees
+/// \ingroup lsm303algo
+float inclineLP_step(lsm303_incline_lp_t* s, const float x, const float y, const float z);
+
 /// \brief Incline angle by linear accelerometer
 /// \details Using \b low-pass \b filter
 /// \param x X axis
@@ -106,6 +471,38 @@ typedef enum {
     STAGE_FALL              ///< Fall stage: impact after weighlessness
 } stage_t;
 
+/// \brief Fall detection state
+/// \details Caller-owned state of \b detectFall_step. Initialize it by \b detectFall_init
+/// \ingroup lsm303algo
+typedef struct {
+    float wThs;     ///< Weighlessness threshould
+    float iThs;     ///< Impact threshould
+    stage_t stage;  ///< Current stage
+} lsm303_fall_t;
+
+/// \brief Fall detection initialization
+/// \param s State pointer
+/// \param wThs Weighlessness threshould
+/// \param iThs Impact threshould
+/// \ingroup lsm303algo
+void detectFall_init(lsm303_fall_t* s, const float wThs, const float iThs);
+
+/// \brief Fall detection reset
+/// \details Reset stage to \c STAGE_INIT after fall detection, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303algo
+void detectFall_reset(lsm303_fall_t* s);
+
+/// \brief Fall detection
+/// \details Fall detection by accelerometer.
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return Stage
+/// \ingroup lsm303algo
+stage_t detectFall_step(lsm303_fall_t* s, const float x, const float y, const float z);
+
 /// \brief Fall detection
 /// \details Fall detection by accelerometer.
 /// \param x X axis
@@ -118,6 +515,144 @@ typedef enum {
 /// \ingroup lsm303algo
 stage_t detectFall(const float x, const float y, const float z, const float wThs, const float iThs);
 
+/// \brief Streams of detector pipeline
+/// \details One stream per sensor, e.g. index \c LSM303_LA and \c LSM303_MF. Define it in build flags to override,
+/// e.g. for low-pass and Kalman filters of the same sensor
+/// \ingroup lsm303algo
+#ifndef LSM303_PIPE_STREAMS
+# define LSM303_PIPE_STREAMS 2U
+#endif
+
+/// \brief Detectors of detector pipeline
+/// \details Define it in build flags to override, up to \c 32 (bits of event mask)
+/// \ingroup lsm303algo
+#ifndef LSM303_PIPE_DETECTORS
+# define LSM303_PIPE_DETECTORS 8U
+#endif
+
+/// \brief Stream filter of detector pipeline
+/// \ingroup lsm303algo
+typedef enum {
+    LSM303_PIPE_LP      = 0,    ///< Low-pass filter
+    LSM303_PIPE_KALMAN  = 1     ///< Kalman filter
+} lsm303_pipe_filter_t;
+
+/// \brief Detector of detector pipeline
+/// \ingroup lsm303algo
+typedef enum {
+    LSM303_PIPE_MOTION      = 0,    ///< Filtered data deviation from reference every \c sample + 1 samples (\b motionLP_step, \b motionK_step: below \c 1 for Kalman stream)
+    LSM303_PIPE_INCLINE     = 1,    ///< Angle of filtered data to Z axis, degrees (\b inclineLP_step)
+    LSM303_PIPE_DISTORTION  = 2,    ///< Sample deviation from filtered data (\b distortionLP_step)
+    LSM303_PIPE_FALL        = 3     ///< Magnitude below \c delta, then above \c limit (\b detectFall_step)
+} lsm303_pipe_kind_t;
+
+/// \brief Stream of detector pipeline
+/// \details Filter state and shared values of the current sample
+/// \ingroup lsm303algo
+typedef struct {
+    lsm303_pipe_filter_t filter;    ///< Filter
+    float alpha;                    ///< Coefficient of the low-pass filter. (1 > a > 0)
+    float Q;                        ///< Kalman filter process covariance
+    float R;                        ///< Kalman filter measurement covariance
+    float E;                        ///< Kalman filter error prediction
+    uint8_t setup;                  ///< Accumulated samples
+    uint8_t need;                   ///< Shared values used by detectors
+    uint32_t mask;                  ///< Detectors of stream
+    float f[3];                     ///< Filtered data
+    float e[3];                     ///< Kalman filter prediction error
+    float m2;                       ///< Squared magnitude of sample
+    float f1;                       ///< Magnitude of filtered data
+    float d2;                       ///< Squared magnitude of sample deviation from filtered data before update
+} lsm303_pipe_stream_t;
+
+/// \brief Detector state of detector pipeline
+/// \ingroup lsm303algo
+typedef struct {
+    lsm303_pipe_kind_t kind;        ///< Detector
+    uint8_t stream;                 ///< Stream index
+    float delta;                    ///< Trigger threshold
+    float limit;                    ///< Second threshold: impact of \c LSM303_PIPE_FALL
+    uint8_t sample;                 ///< Samples for checks of \c LSM303_PIPE_MOTION
+    uint8_t smpl;                   ///< Samples counter
+    uint8_t hold;                   ///< Samples before checks: reference accumulation after start and trigger
+    uint8_t stage;                  ///< Stage of \c LSM303_PIPE_FALL: \c 1 - weighlessness
+    float p[3];                     ///< Reference (accumulated) data of \c LSM303_PIPE_MOTION
+    float value;                    ///< Value of the last trigger
+} lsm303_pipe_det_t;
+
+/// \brief Detector pipeline
+/// \details Detectors share filter state and magnitudes of the stream: one filter pass and one computation of every used
+/// magnitude for every sample, squared threshold checks per detector. Caller-owned, initialize it by \b lsm303_pipe_init
+/// \ingroup lsm303algo
+typedef struct {
+    lsm303_pipe_stream_t s[LSM303_PIPE_STREAMS];    ///< Streams
+    lsm303_pipe_det_t d[LSM303_PIPE_DETECTORS];     ///< Detectors
+    uint8_t n;                                      ///< Number of detectors
+} lsm303_pipe_t;
+
+/// \brief Detector pipeline initialization
+/// \details Streams use low-pass filter with \c alpha = \c 0.1, no detectors
+/// \param p Pipeline pointer
+/// \ingroup lsm303algo
+void lsm303_pipe_init(lsm303_pipe_t* p);
+
+/// \brief Stream low-pass filter
+/// \param p Pipeline pointer
+/// \param stream Stream index
+/// \param alpha Coefficient of the low-pass filter. (1 > a > 0)
+/// \return \c HAL_OK or \c HAL_ERROR for wrong stream
+/// \ingroup lsm303algo
+uint8_t lsm303_pipe_lp(lsm303_pipe_t* p, const uint8_t stream, const float alpha);
+
+/// \brief Stream Kalman filter
+/// \param p Pipeline pointer
+/// \param stream Stream index
+/// \param Q Process covariance
+/// \param R Measurement covariance
+/// \param E Error prediction
+/// \return \c HAL_OK or \c HAL_ERROR for wrong stream
+/// \ingroup lsm303algo
+uint8_t lsm303_pipe_kalman(lsm303_pipe_t* p, const uint8_t stream, const float Q, const float R, const float E);
+
+/// \brief Add detector
+/// \details Detector triggers bit <tt>1 << id</tt> of event mask
+/// \param p Pipeline pointer
+/// \param stream Stream index
+/// \param kind Detector
+/// \param delta Trigger threshold: magnitude, degrees for \c LSM303_PIPE_INCLINE (used absolute value), weighlessness of \c LSM303_PIPE_FALL
+/// \param limit Impact threshold of \c LSM303_PIPE_FALL, not used by other detectors
+/// \param sample Samples for checks of \c LSM303_PIPE_MOTION, not used by other detectors
+/// \param id Detector index or \c 0
+/// \return \c HAL_OK or \c HAL_ERROR if there is no room or wrong stream
+/// \ingroup lsm303algo
+uint8_t lsm303_pipe_add(lsm303_pipe_t* p, const uint8_t stream, const lsm303_pipe_kind_t kind, const float delta, const float limit, const uint8_t sample, uint8_t* id);
+
+/// \brief Detector pipeline reset
+/// \details Restart filters and accumulation, detectors and parameters are kept
+/// \param p Pipeline pointer
+/// \ingroup lsm303algo
+void lsm303_pipe_reset(lsm303_pipe_t* p);
+
+/// \brief Detector pipeline step
+/// \details Filter of the stream is not restarted by trigger: detector accumulates new reference for \c CNTSETUP samples
+/// \param p Pipeline pointer
+/// \param stream Stream index
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \return Event mask of triggered detectors, values in lsm303_pipe_det_t::value
+/// \ingroup lsm303algo
+uint32_t lsm303_pipe_step(lsm303_pipe_t* p, const uint8_t stream, const float x, const float y, const float z);
+
+/// \brief Detector pipeline step for block of samples
+/// \param p Pipeline pointer
+/// \param stream Stream index
+/// \param a Block of samples (for example FIFO data)
+/// \param n Number of samples
+/// \return Event mask of detectors triggered in block, values of the last triggers in lsm303_pipe_det_t::value
+/// \ingroup lsm303algo
+uint32_t lsm303_pipe_block(lsm303_pipe_t* p, const uint8_t stream, const lsm303_block_t* a, const uint16_t n);
+
 /// \brief Calculate filter coefficient
 /// \param rate Sampling frequency
 /// \param cutoff Cutoff frequency
@@ -0,0 +1,125 @@
+/// \file lsm303cal.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303cal.h"
+#include "log.h"
+
+#include <string.h>
+
+// Flash record: size is multiple of double word
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;
+    lsm303_mcal_t cal;
+} lsm303_mcal_rec_t;
+
+_Static_assert(sizeof(lsm303_mcal_rec_t) % sizeof(uint64_t) == 0U, "Flash record must be multiple of double word");
+
+// CRC-32 (IEEE 802.3)
+static uint32_t lsm303_crc32(const uint8_t* data, uint32_t size)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+    while (size--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8U; ++i) crc = (crc >> 1) ^ (0xEDB88320UL & (0U - (crc & 1U)));
+    }
+    return ~crc;
+}
+
+void lsm303_mcal_fit_init(lsm303_mcal_fit_t* fit)
+{
+    for (uint8_t i = 0; i < 3; ++i) {
+        fit->min[i] = INT16_MAX;
+        fit->max[i] = INT16_MIN;
+    }
+    fit->n = 0U;
+}
+
+void lsm303_mcal_fit_step(lsm303_mcal_fit_t* fit, const int16_t x, const int16_t y, const int16_t z)
+{
+    const int16_t r[3] = { x, y, z };
+    for (uint8_t i = 0; i < 3; ++i) {
+        if (r[i] < fit->min[i]) fit->min[i] = r[i];
+        if (r[i] > fit->max[i]) fit->max[i] = r[i];
+    }
+    fit->n++;
+}
+
+uint8_t lsm303_mcal_fit_solve(const lsm303_mcal_fit_t* fit, const lsm303_dev_t* dev, lsm303_mcal_t* cal)
+{
+    if (0 == fit || 0 == dev || 0 == cal) return HAL_ERROR;
+    if (!(dev->mlsb_xy > 0.0F && dev->mlsb_z > 0.0F)) return HAL_ERROR;
+    if (fit->n < LSM303_MCAL_SAMPLES) return HAL_BUSY;
+    const float k[3] = { 100.0F / dev->mlsb_xy, 100.0F / dev->mlsb_xy, 100.0F / dev->mlsb_z };
+    float r[3];
+    float avg = 0.0F;
+    for (uint8_t i = 0; i < 3; ++i) {
+        r[i] = 0.5F * (float)(fit->max[i] - fit->min[i]) * k[i];
+        if (r[i] < LSM303_MCAL_RADIUS) return HAL_BUSY;
+        avg += r[i];
+    }
+    avg /= 3.0F;
+    memset(cal, 0, sizeof(lsm303_mcal_t));
+    for (uint8_t i = 0; i < 3; ++i) {
+        cal->b[i] = 0.5F * (float)(fit->max[i] + fit->min[i]) * k[i];
+        cal->S[i][i] = avg / r[i];
+    }
+    xDebug("Offset: %.02f, %.02f, %.02f uT\tScale: %.03f, %.03f, %.03f\n", cal->b[0], cal->b[1], cal->b[2], cal->S[0][0], cal->S[1][1], cal->S[2][2]);
+    return HAL_OK;
+}
+
+#ifdef HAL_FLASH_MODULE_ENABLED
+
+uint8_t lsm303_mcal_save(const uint32_t addr, const lsm303_mcal_t* cal)
+{
+    if (0 == cal || (addr - FLASH_BASE) % FLASH_PAGE_SIZE != 0U) return HAL_ERROR;
+    lsm303_mcal_rec_t rec = { .magic = LSM303_MCAL_MAGIC, .crc = 0U, .cal = *cal };
+    rec.crc = lsm303_crc32((const uint8_t*)&rec.cal, sizeof(rec.cal));
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks = FLASH_BANK_1,
+        .Page = (addr - FLASH_BASE) / FLASH_PAGE_SIZE,
+        .NbPages = 1U
+    };
+#if defined(FLASH_BANK_2)
+    if (erase.Page >= FLASH_PAGE_NB) {
+        erase.Banks = FLASH_BANK_2;
+        erase.Page -= FLASH_PAGE_NB;
+    }
+#endif
+    uint32_t error = 0U;
+    uint8_t ret = HAL_FLASH_Unlock();
+    if (ret != HAL_OK) return ret;
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+    ret = HAL_FLASHEx_Erase(&erase, &error);
+    for (uint32_t i = 0; ret == HAL_OK && i < sizeof(rec); i += sizeof(uint64_t)) {
+        uint64_t dw;
+        memcpy(&dw, (const uint8_t*)&rec + i, sizeof(dw));
+        ret = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, addr + i, dw);
+    }
+    HAL_FLASH_Lock();
+    if (ret != HAL_OK) xWarning("Calibration save error: %u\n", ret);
+    return ret;
+}
+
+#else
+
+uint8_t lsm303_mcal_save(const uint32_t addr, const lsm303_mcal_t* cal)
+{
+    return HAL_ERROR;
+}
+
+#endif // HAL_FLASH_MODULE_ENABLED
+
+uint8_t lsm303_mcal_load(const uint32_t addr, lsm303_mcal_t* cal)
+{
+    if (0 == cal) return HAL_ERROR;
+    lsm303_mcal_rec_t rec;
+    memcpy(&rec, (const void*)(uintptr_t)addr, sizeof(rec));
+    if (rec.magic != LSM303_MCAL_MAGIC) return HAL_ERROR;
+    if (rec.crc != lsm303_crc32((const uint8_t*)&rec.cal, sizeof(rec.cal))) return HAL_ERROR;
+    *cal = rec.cal;
+    return HAL_OK;
+}
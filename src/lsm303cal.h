@@ -0,0 +1,72 @@
+/// \file lsm303cal.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_CAL_H__
+#define __LSM303_CAL_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303cal 7. LSM303 Calibration
+/// \brief Magnetometer hard-iron and soft-iron calibration
+/// \details Online fit keeps per-axis minimum and maximum of raw data (constant memory): hard-iron offset is the center
+/// of the range, soft-iron matrix is diagonal and scales every axis to the mean radius. Rotate the board through all
+/// orientations while fitting. Any full matrix (e.g. of offline ellipsoid fit) can be set by \b lsm303_mf_calib as well.
+/// \details Calibration is stored in a flash page with magic and CRC-32 and loaded at startup
+
+#ifndef LSM303_MCAL_SAMPLES
+# define LSM303_MCAL_SAMPLES 64U       ///< Min samples of the fit
+#endif
+
+#ifndef LSM303_MCAL_RADIUS
+# define LSM303_MCAL_RADIUS 10.0F      ///< Min radius of the fit, \b uT
+#endif
+
+#define LSM303_MCAL_MAGIC 0x4C41434DUL  ///< \c "MCAL"
+
+/// \brief Online calibration fit state
+/// \ingroup lsm303cal
+typedef struct {
+    int16_t min[3];     ///< Minimum raw data
+    int16_t max[3];     ///< Maximum raw data
+    uint32_t n;         ///< Samples
+} lsm303_mcal_fit_t;
+
+/// \brief Online calibration fit initialization
+/// \param fit State pointer
+/// \ingroup lsm303cal
+void lsm303_mcal_fit_init(lsm303_mcal_fit_t* fit);
+
+/// \brief Online calibration fit update
+/// \param fit State pointer
+/// \param x X axis raw data (\b lsm303_mf_raw or \b lsm303_pop)
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \ingroup lsm303cal
+void lsm303_mcal_fit_step(lsm303_mcal_fit_t* fit, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Online calibration fit result
+/// \param fit State pointer
+/// \param dev Device handler: current gain
+/// \param cal Calibration for \b lsm303_mf_calib
+/// \return \c HAL_OK, \c HAL_BUSY if samples don't cover all orientations or \c HAL_ERROR
+/// \ingroup lsm303cal
+uint8_t lsm303_mcal_fit_solve(const lsm303_mcal_fit_t* fit, const lsm303_dev_t* dev, lsm303_mcal_t* cal);
+
+/// \brief Save calibration into flash
+/// \details Erase the flash page and program the record by double words. Available if \c HAL_FLASH_MODULE_ENABLED
+/// \param addr Flash page address, e.g. the last page of flash reserved in linker script
+/// \param cal Calibration
+/// \return \c HAL_OK or error code
+/// \ingroup lsm303cal
+uint8_t lsm303_mcal_save(const uint32_t addr, const lsm303_mcal_t* cal);
+
+/// \brief Load calibration from flash
+/// \param addr Flash page address
+/// \param cal Calibration
+/// \return \c HAL_OK or \c HAL_ERROR if the page has no valid record
+/// \ingroup lsm303cal
+uint8_t lsm303_mcal_load(const uint32_t addr, lsm303_mcal_t* cal);
+
+#endif // __LSM303_CAL_H__
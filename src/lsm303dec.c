@@ -0,0 +1,103 @@
+/// \file lsm303dec.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303dec.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+# define M_PI 3.14159265358979323846F
+#endif
+
+uint8_t lsm303_dec_design(float* h, const uint16_t ntaps, const float rate, const float cutoff)
+{
+    if (0 == h || ntaps == 0U || rate <= 0.0F || cutoff <= 0.0F || cutoff >= 0.5F * rate) return HAL_ERROR;
+    if (ntaps == 1U) {
+        h[0] = 1.0F;
+        return HAL_OK;
+    }
+    // Normalized cutoff: 1 is Nyquist frequency
+    const float wc = 2.0F * cutoff / rate;
+    const float c = 0.5F * (float)(ntaps - 1U);
+    float sum = 0.0F;
+    for (uint16_t i = 0; i < ntaps; ++i) {
+        const float t = (float)i - c;
+        const float sinc = t == 0.0F ? wc : sinf((float)M_PI * wc * t) / ((float)M_PI * t);
+        const float k = 2.0F * (float)M_PI * (float)i / (float)(ntaps - 1U);
+        const float w = 0.42F - 0.5F * cosf(k) + 0.08F * cosf(2.0F * k);
+        h[i] = sinc * w;
+        sum += h[i];
+    }
+    // Unity gain at 0 Hz
+    for (uint16_t i = 0; i < ntaps; ++i) h[i] /= sum;
+    return HAL_OK;
+}
+
+uint8_t lsm303_dec_init(lsm303_dec_t* d, const float* h, const uint16_t ntaps, const uint16_t M, float* buf)
+{
+    if (0 == d || 0 == h || 0 == buf || ntaps == 0U || M == 0U) return HAL_ERROR;
+    d->h = h;
+    d->buf = buf;
+    d->ntaps = ntaps;
+    d->M = M;
+    lsm303_dec_reset(d);
+    return HAL_OK;
+}
+
+void lsm303_dec_reset(lsm303_dec_t* d)
+{
+    memset(d->buf, 0, LSM303_DEC_BUF(d->ntaps) * sizeof(float));
+    d->pos = 0U;
+    d->phase = 0U;
+    d->sr = 0U;
+}
+
+// Dot product of coefficients and contiguous history window
+static inline float lsm303_dec_dot(const float* h, const float* v, const uint16_t n)
+{
+    float acc = 0.0F;
+    for (uint16_t i = 0; i < n; ++i) acc += h[i] * v[i];
+    return acc;
+}
+
+uint8_t lsm303_dec_step(lsm303_dec_t* d, const float x, const float y, const float z, float out[3])
+{
+    const uint16_t N = d->ntaps;
+    float* const rx = &d->buf[0];
+    float* const ry = &d->buf[2U * N];
+    float* const rz = &d->buf[4U * N];
+    // Duplicated write: window of the last N samples is contiguous from the oldest one
+    const uint16_t p = d->pos;
+    rx[p] = rx[p + N] = x;
+    ry[p] = ry[p + N] = y;
+    rz[p] = rz[p + N] = z;
+    d->pos = p + 1U == N ? 0U : p + 1U;
+    if (++d->phase < d->M) return 0U;
+    d->phase = 0U;
+    const uint16_t w = d->pos;
+    out[0] = lsm303_dec_dot(d->h, &rx[w], N);
+    out[1] = lsm303_dec_dot(d->h, &ry[w], N);
+    out[2] = lsm303_dec_dot(d->h, &rz[w], N);
+    return 1U;
+}
+
+uint16_t lsm303_dec_samples(lsm303_dec_t* d, const lsm303_sample_t* in, const uint16_t n, lsm303_sample_t* out)
+{
+    uint16_t k = 0U;
+    float v[3];
+    for (uint16_t i = 0; i < n; ++i) {
+        d->sr |= in[i].sr;
+        if (lsm303_dec_step(d, in[i].x, in[i].y, in[i].z, v) == 0U) continue;
+        // Input sample i is read: in-place output k <= i
+        out[k].x = v[0];
+        out[k].y = v[1];
+        out[k].z = v[2];
+        out[k].sr = d->sr;
+        d->sr = 0U;
+        ++k;
+    }
+    return k;
+}
@@ -0,0 +1,85 @@
+/// \file lsm303dec.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_DEC_H__
+#define __LSM303_DEC_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303dec 11. LSM303 Decimation
+/// \brief Anti-alias FIR decimator for high data rate streams
+/// \details Accelerometer runs at high data rate (\c LSM303_ADATARATE_SPEC, \c LSM303_ADATARATE_LOW) and is read by FIFO
+/// blocks, decimator filters and down-samples them by factor \c M: orientation and detectors run at \c 1/M rate.
+/// \details Polyphase evaluation: every input sample costs 3 history writes, every output sample one dot product of
+/// \c N taps per axis, i.e. \c N/M multiply-accumulate per input sample and axis. History is duplicated (ring buffer
+/// written at \c i and \c i + N) so dot product runs over contiguous memory without wrap checks.
+/// \details Filter length and factor are set at configuration time by caller-owned coefficient and history arrays.
+/// Typical: <tt>M = 16</tt>, <tt>N = 4 * M</tt> taps, cutoff \c 0.4 of output rate
+
+/// \brief History buffer size for \c ntaps taps, \c float items
+/// \ingroup lsm303dec
+#define LSM303_DEC_BUF(ntaps) (6U * (ntaps))
+
+/// \brief Decimator state
+/// \details Caller-owned state of \b lsm303_dec_step. Initialize it by \b lsm303_dec_init
+/// \ingroup lsm303dec
+typedef struct {
+    const float* h;     ///< Coefficients, \c ntaps items
+    float* buf;         ///< History, \c LSM303_DEC_BUF(ntaps) items: X, Y and Z rings of \c 2 * \c ntaps
+    uint16_t ntaps;     ///< Filter length
+    uint16_t M;         ///< Decimation factor
+    uint16_t pos;       ///< Position of the oldest sample in rings
+    uint16_t phase;     ///< Input samples since the last output
+    uint8_t sr;         ///< Status registers OR since the last output
+} lsm303_dec_t;
+
+/// \brief Low-pass FIR design
+/// \details Windowed sinc (Blackman window), linear phase, unity gain at 0 Hz
+/// \param h Coefficients, \c ntaps items
+/// \param ntaps Filter length
+/// \param rate Input sampling frequency
+/// \param cutoff Cutoff frequency, less than half of output rate for anti-aliasing
+/// \return \c HAL_OK or \c HAL_ERROR for wrong parameters
+/// \ingroup lsm303dec
+uint8_t lsm303_dec_design(float* h, const uint16_t ntaps, const float rate, const float cutoff);
+
+/// \brief Decimator initialization
+/// \param d State pointer
+/// \param h Coefficients, \c ntaps items, e.g. by \b lsm303_dec_design. Valid while decimator is used
+/// \param ntaps Filter length
+/// \param M Decimation factor
+/// \param buf History, \c LSM303_DEC_BUF(ntaps) items. Valid while decimator is used
+/// \return \c HAL_OK or \c HAL_ERROR for wrong parameters
+/// \ingroup lsm303dec
+uint8_t lsm303_dec_init(lsm303_dec_t* d, const float* h, const uint16_t ntaps, const uint16_t M, float* buf);
+
+/// \brief Decimator reset
+/// \details Clear history, parameters are kept
+/// \param d State pointer
+/// \ingroup lsm303dec
+void lsm303_dec_reset(lsm303_dec_t* d);
+
+/// \brief Decimator step
+/// \param d State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \param out Decimated sample: X, Y and Z
+/// \return \c 1 if \c out is written every \c M samples or \c 0
+/// \ingroup lsm303dec
+uint8_t lsm303_dec_step(lsm303_dec_t* d, const float x, const float y, const float z, float out[3]);
+
+/// \brief Decimator for block of samples
+/// \details Output may be the same array as input (in-place): output sample \c k is written after input sample \c k * M
+/// is read. Status register of decimated sample is OR of input status registers since the previous output
+/// \param d State pointer
+/// \param in Samples, e.g. by \b lsm303_la_fifo_samples
+/// \param n Number of samples
+/// \param out Decimated samples, up to <tt>n / M + 1</tt> items
+/// \return Number of decimated samples
+/// \ingroup lsm303dec
+uint16_t lsm303_dec_samples(lsm303_dec_t* d, const lsm303_sample_t* in, const uint16_t n, lsm303_sample_t* out);
+
+#endif // __LSM303_DEC_H__
@@ -6,6 +6,8 @@
 #include "lsm303dlhc.h"
 #include "log.h"
 
+#include <string.h>
+
 enum {
     LSM303_LA_SAD = 0b00110010,  // Linear accelerometer address SAD+W
     LSM303_MF_SAD = 0b00111100   // Magnetic field address SAD+W
@@ -60,6 +62,8 @@ enum {
     LSM303_IRA_REG_M   = 0x0A,
     LSM303_IRB_REG_M   = 0x0B,
     LSM303_IRC_REG_M   = 0x0C,
+    LSM303_TEMP_OUT_H_M = 0x31,
+    LSM303_TEMP_OUT_L_M = 0x32,
 };
 
 // CTRL_REG1_A
@@ -115,6 +119,21 @@ typedef union {
     uint8_t reg;
 } lsm303_reg_ctrl_a4_t;
 
+// CTRL_REG5_A
+typedef union {
+    struct __attribute__((__packed__)) {
+        uint8_t d4d_int2    : 1; // 4D enable: 4D detection is enabled on INT2 when 6D bit on INT2_CFG_A is set to 1
+        uint8_t lir_int2    : 1; // Latch interrupt request on INT2_SRC_A register (0: interrupt request not latched, 1: interrupt request latched)
+        uint8_t d4d_int1    : 1; // 4D enable: 4D detection is enabled on INT1 when 6D bit on INT1_CFG_A is set to 1
+        uint8_t lir_int1    : 1; // Latch interrupt request on INT1_SRC_A register (0: interrupt request not latched, 1: interrupt request latched)
+        uint8_t reserved    : 2;
+        uint8_t fifo_en     : 1; // FIFO enable. Default value: 0 (0: FIFO disable, 1: FIFO enable)
+        uint8_t boot        : 1; // Reboot memory content. Default value: 0 (0: normal mode, 1: reboot memory content)
+    };
+    uint8_t reg;
+} lsm303_reg_ctrl_a5_t;
+
+// CTRL_REG6_A
 typedef union {
     struct __attribute__((__packed__)) {
         uint8_t reserved1   : 1;
@@ -129,6 +148,16 @@ typedef union {
     uint8_t reg;    
 } lsm303_reg_ctrl_a6_t;
 
+// FIFO_CTRL_REG_A
+typedef union {
+    struct __attribute__((__packed__)) {
+        uint8_t fth         : 5; // FIFO watermark level
+        uint8_t tr          : 1; // Trigger selection (0: trigger event linked to interrupt generator 1, 1: to interrupt generator 2)
+        uint8_t fm          : 2; // lsm303_la_fifo_t. FIFO mode selection
+    };
+    uint8_t reg;
+} lsm303_reg_fifo_ctrl_a_t;
+
 // CRA_REG_M
 typedef union {
     struct __attribute__((__packed__)) {
@@ -158,105 +187,634 @@ typedef union {
     uint8_t reg;
 } lsm303_reg_mr_t;
 
-uint8_t lsm303_buf[6] = { 0 };  // buffer for read lsm303 data
-uint8_t lsm303_ashift = 0;      // accelerometer bit shift amount
-float lsm303_alsb = 0.0F;       // accelerometer sensitivity mg/LSB
-float lsm303_mlsb_xy = 0.0F;    // magnetometer LSB/Gauss for X, Y
-float lsm303_mlsb_z = 0.0F;     // magnetometer LSB/Gauss for Z
+// Accelerometer data registers to raw data
+static inline void lsm303_la_conv(const uint8_t* buf, const uint8_t shift, int16_t* x, int16_t* y, int16_t* z)
+{
+    *x = (int16_t)(buf[1] << 8 | buf[0]) >> shift;
+    *y = (int16_t)(buf[3] << 8 | buf[2]) >> shift;
+    *z = (int16_t)(buf[5] << 8 | buf[4]) >> shift;
+}
 
-uint8_t lsm303_la_setup(I2C_HandleTypeDef *i2c, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr, const lsm303_la_fs_t fs)
+// Magnetometer data registers (X, Z, Y order) to raw data
+static inline void lsm303_mf_conv(const uint8_t* buf, int16_t* x, int16_t* y, int16_t* z)
 {
-    if (0 == i2c) return HAL_ERROR;
+    *x = (int16_t)(buf[0] << 8 | buf[1]);
+    *y = (int16_t)(buf[4] << 8 | buf[5]);
+    *z = (int16_t)(buf[2] << 8 | buf[3]);
+}
 
-    uint8_t data[2] = { 0 };
-    lsm303_reg_ctrl_a1_t a1 = { 0 };
-    lsm303_reg_ctrl_a4_t a4 = { 0 };
+// Offset of FIFO data received into the tail of n samples
+static inline uint16_t lsm303_fifo_offset(const uint8_t n)
+{
+    return (uint16_t)(n * (sizeof(lsm303_sample_t) - 6U));
+}
 
-    a1.dataRate = odr;
-    a1.lowPower = lpe == 0U ? 0U : 1U;
-    a1.x = 1U;
-    a1.y = 1U;
-    a1.z = 1U;
+static inline uint32_t lsm303_now(const lsm303_dev_t *dev)
+{
+    return dev->clock != 0 ? dev->clock() : HAL_GetTick();
+}
 
-    a4.hr = hr == 0U ? 0U : 1U;
-    a4.fs = fs;
-   
-    data[0] = LSM303_CTRL_REG1_A;
-    data[1] = a1.reg;
-    uint8_t ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("CTRL_REG1_A: 0x%02x %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    data[0] = LSM303_CTRL_REG4_A;
-    data[1] = a4.reg;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
+// Start tick of instrumented I2C read
+static inline uint32_t lsm303_instr_start(const lsm303_dev_t *dev)
+{
+#if LSM303_INSTR != 0
+    return lsm303_now(dev);
+#else
+    (void)dev;
+    return 0U;
+#endif
+}
+
+// I2C time of read started at tick, returns the end tick
+static inline uint32_t lsm303_instr_bus(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const uint32_t start)
+{
+#if LSM303_INSTR != 0
+    lsm303_instr_t* const in = &dev->instr[sensor];
+    const uint32_t now = lsm303_now(dev);
+    const uint32_t d = now - start;
+    in->reads++;
+    in->bus += d;
+    if (d > in->bus_max) in->bus_max = d;
+    return now;
+#else
+    (void)dev;
+    (void)sensor;
+    return start;
+#endif
+}
+
+// Delivered samples: interval of single sample with tick
+static void lsm303_instr_deliver(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const uint8_t n, const uint32_t tick)
+{
+#if LSM303_INSTR != 0
+    lsm303_instr_t* const in = &dev->instr[sensor];
+    in->samples += n;
+    if (n != 1U) {
+        in->valid = 0U;
+        return;
+    }
+    if (in->valid != 0U) {
+        const uint32_t d = tick - in->last;
+        in->intervals++;
+        if (d < in->imin) in->imin = d;
+        if (d > in->imax) in->imax = d;
+        if (in->period != 0U) {
+            // Quarters of period, rounded
+            const uint32_t q = (4U * d + in->period / 2U) / in->period;
+            in->hist[q < LSM303_INSTR_BINS ? q : LSM303_INSTR_BINS - 1U]++;
+        }
+    }
+    in->last = tick;
+    in->valid = 1U;
+#else
+    (void)dev;
+    (void)sensor;
+    (void)n;
+    (void)tick;
+#endif
+}
+
+// Convert accelerometer status and data received into the sample memory in place
+static uint8_t lsm303_la_unpack(lsm303_dev_t *dev, lsm303_sample_t *s)
+{
+    const uint8_t* buf = (const uint8_t*)s;
+    const lsm303_reg_status_a_t status = { .reg = buf[0] };
+    int16_t r[3] = { 0 };
+    lsm303_la_conv(&buf[1], LSM303_ASHIFT(dev), &r[0], &r[1], &r[2]);
+    s->x = (float)r[0] * LSM303_ALSB(dev);
+    s->y = (float)r[1] * LSM303_ALSB(dev);
+    s->z = (float)r[2] * LSM303_ALSB(dev);
+    s->sr = status.reg;
+    if (status.zyxovr != 0U) {
+        dev->stats.overrun++;
+        dev->instr[LSM303_LA].overrun++;
+    }
+    if (status.zyxda == 0U) {
+        dev->stats.notready++;
+        dev->instr[LSM303_LA].notready++;
+        return HAL_BUSY;
+    }
+    return HAL_OK;
+}
+
+// Count FIFO overrun of FIFO_SRC_REG_A
+static inline void lsm303_la_fifo_ovrn(lsm303_dev_t *dev, const uint8_t src)
+{
+    const lsm303_reg_fifo_src_a_t f = { .reg = src };
+    if (f.ovrn) {
+        dev->stats.overrun++;
+        dev->instr[LSM303_LA].overrun++;
+    }
+}
+
+// Convert accelerometer FIFO data received into the tail of samples forward in place:
+// sample i ends below data of sample i + 1, so no unread data is overwritten
+static void lsm303_la_unpack_fifo(lsm303_dev_t *dev, lsm303_sample_t *s, const uint8_t n, const uint8_t sr)
+{
+    const uint8_t* raw = (const uint8_t*)s + lsm303_fifo_offset(n);
+    for (uint8_t i = 0; i < n; ++i) {
+        int16_t r[3] = { 0 };
+        lsm303_la_conv(&raw[6U * i], LSM303_ASHIFT(dev), &r[0], &r[1], &r[2]);
+        s[i].x = (float)r[0] * LSM303_ALSB(dev);
+        s[i].y = (float)r[1] * LSM303_ALSB(dev);
+        s[i].z = (float)r[2] * LSM303_ALSB(dev);
+        s[i].sr = sr;
+    }
+}
+
+// Convert magnetometer data and status received into the sample memory in place
+static uint8_t lsm303_mf_unpack(lsm303_dev_t *dev, lsm303_sample_t *s)
+{
+    const uint8_t* buf = (const uint8_t*)s;
+    const lsm303_reg_sr_m_t status = { .reg = buf[6] };
+    int16_t r[3] = { 0 };
+    lsm303_mf_conv(&buf[0], &r[0], &r[1], &r[2]);
+    const float f[3] = { (float)r[0], (float)r[1], (float)r[2] };
+    float m[3];
+    lsm303_mf_apply(dev, f, m);
+    s->x = m[0];
+    s->y = m[1];
+    s->z = m[2];
+    s->sr = status.reg;
+    if (status.drdy == 0U) {
+        dev->stats.notready++;
+        dev->instr[LSM303_MF].notready++;
+        return HAL_BUSY;
+    }
+    return HAL_OK;
+}
+
+// Busy loop of bus recovery clock
+static void lsm303_recover_delay(void)
+{
+    for (volatile uint32_t i = 0; i < LSM303_RECOVER_DELAY; ++i) { }
+}
+
+// Bus recovery of locked bus
+static uint8_t lsm303_recover_bus(lsm303_dev_t *dev)
+{
+    dev->stats.recover++;
+    HAL_I2C_DeInit(dev->i2c);
+    if (dev->bus.scl_port != 0 && dev->bus.sda_port != 0) {
+        GPIO_InitTypeDef gpio = { 0 };
+        gpio.Mode = GPIO_MODE_OUTPUT_OD;
+        gpio.Pull = GPIO_NOPULL;
+        gpio.Speed = GPIO_SPEED_FREQ_LOW;
+        HAL_GPIO_WritePin(dev->bus.scl_port, dev->bus.scl_pin, GPIO_PIN_SET);
+        HAL_GPIO_WritePin(dev->bus.sda_port, dev->bus.sda_pin, GPIO_PIN_SET);
+        gpio.Pin = dev->bus.scl_pin;
+        HAL_GPIO_Init(dev->bus.scl_port, &gpio);
+        gpio.Pin = dev->bus.sda_pin;
+        HAL_GPIO_Init(dev->bus.sda_port, &gpio);
+        lsm303_recover_delay();
+        // Clock out the byte a sensor is sending until it releases SDA
+        for (uint8_t i = 0; i < 9U && HAL_GPIO_ReadPin(dev->bus.sda_port, dev->bus.sda_pin) == GPIO_PIN_RESET; ++i) {
+            HAL_GPIO_WritePin(dev->bus.scl_port, dev->bus.scl_pin, GPIO_PIN_RESET);
+            lsm303_recover_delay();
+            HAL_GPIO_WritePin(dev->bus.scl_port, dev->bus.scl_pin, GPIO_PIN_SET);
+            lsm303_recover_delay();
+        }
+        // STOP: SDA rises while SCL is high
+        HAL_GPIO_WritePin(dev->bus.scl_port, dev->bus.scl_pin, GPIO_PIN_RESET);
+        lsm303_recover_delay();
+        HAL_GPIO_WritePin(dev->bus.sda_port, dev->bus.sda_pin, GPIO_PIN_RESET);
+        lsm303_recover_delay();
+        HAL_GPIO_WritePin(dev->bus.scl_port, dev->bus.scl_pin, GPIO_PIN_SET);
+        lsm303_recover_delay();
+        HAL_GPIO_WritePin(dev->bus.sda_port, dev->bus.sda_pin, GPIO_PIN_SET);
+        lsm303_recover_delay();
+        HAL_GPIO_DeInit(dev->bus.scl_port, dev->bus.scl_pin);
+        HAL_GPIO_DeInit(dev->bus.sda_port, dev->bus.sda_pin);
+    }
+    const uint8_t ret = HAL_I2C_Init(dev->i2c);
+    xWarning("I2C bus recovery: %u\n", ret);
+    return ret;
+}
+
+uint8_t lsm303_recover(lsm303_dev_t *dev)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    if (dev->async.busy != 0U) return HAL_BUSY;
+    if (0 == dev->port) return lsm303_recover_bus(dev);
+    if (dev->port->lock(dev->port->ctx) != HAL_OK) return HAL_BUSY;
+    const uint8_t ret = lsm303_recover_bus(dev);
+    dev->port->unlock(dev->port->ctx);
+    return ret;
+}
+
+// Timeout of whole transfer: HAL measures it from one tickstart
+static inline uint32_t lsm303_xfer_timeout(const lsm303_dev_t *dev, const uint16_t size)
+{
+    return dev->timeout + (size + LSM303_TIMEOUT_RATE - 1U) / LSM303_TIMEOUT_RATE;
+}
+
+// One blocking transfer: polling or interrupt transfer waiting for completion of bus port
+static uint8_t lsm303_xfer_once(lsm303_dev_t *dev, const uint8_t write, const uint8_t sad, const uint8_t reg, uint8_t *data, const uint16_t size)
+{
+    const uint32_t timeout = lsm303_xfer_timeout(dev, size);
+    if (0 == dev->port) {
+        return write != 0U
+            ? HAL_I2C_Mem_Write(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, data, size, timeout)
+            : HAL_I2C_Mem_Read(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, data, size, timeout);
+    }
+    // Started transfer has one owner: asynchronous transfer or this one, claimed and started with interrupts disabled
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (dev->async.busy != 0U) {
+        __set_PRIMASK(primask);
+        return HAL_BUSY;
+    }
+    dev->xfer.status = HAL_ERROR;
+    dev->xfer.wait = 1U;
+    const uint8_t ret = write != 0U
+        ? HAL_I2C_Mem_Write_IT(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, data, size)
+        : HAL_I2C_Mem_Read_IT(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, data, size);
+    if (ret != HAL_OK) dev->xfer.wait = 0U;
+    __set_PRIMASK(primask);
     if (ret != HAL_OK) return ret;
-    xDebug("CTRL_REG4_A: 0x%02x %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    if (hr == 0U) {
+    if (dev->port->wait(dev->port->ctx, timeout) != HAL_OK) {
+        // Late completion is ignored, the transfer is aborted by bus recovery
+        primask = __get_PRIMASK();
+        __disable_irq();
+        dev->xfer.wait = 0U;
+        __set_PRIMASK(primask);
+        return HAL_TIMEOUT;
+    }
+    return dev->xfer.status;
+}
+
+// Interrupt context: tick doesn't advance in handler preempting SysTick
+static inline uint8_t lsm303_isr(void)
+{
+    return __get_IPSR() != 0U ? 1U : 0U;
+}
+
+// Blocking register transfer with timeout, retries with backoff and bus recovery.
+// Interrupt context: immediate retries, no bus recovery under transfer of preempted code
+static uint8_t lsm303_xfer_retry(lsm303_dev_t *dev, const uint8_t write, const uint8_t sad, const uint8_t reg, uint8_t *data, const uint16_t size)
+{
+    const uint8_t isr = lsm303_isr();
+    uint8_t ret = HAL_ERROR;
+    for (uint8_t i = 0; i <= dev->retries; ++i) {
+        if (i > 0U) {
+            dev->stats.retry++;
+            // No backoff in interrupt context: bus port is never used there
+            if (0 != dev->port) dev->port->delay(dev->port->ctx, 1UL << (i - 1U));
+            else if (isr == 0U) HAL_Delay(1UL << (i - 1U));
+        }
+        ret = lsm303_xfer_once(dev, write, sad, reg, data, size);
+        if (ret == HAL_OK) return HAL_OK;
+        const uint32_t err = HAL_I2C_GetError(dev->i2c);
+        if (ret == HAL_BUSY) {
+            dev->stats.busy++;
+            // Own asynchronous transfer or transfer of preempted code: no retries
+            if (dev->async.busy != 0U || isr != 0U) return ret;
+            continue;
+        }
+        if (ret == HAL_TIMEOUT || (err & HAL_I2C_ERROR_TIMEOUT) != 0U) dev->stats.timeout++;
+        else if ((err & HAL_I2C_ERROR_AF) != 0U) {
+            // Sensor is not responding: bus is released by STOP
+            dev->stats.nack++;
+            continue;
+        }
+        else dev->stats.error++;
+        // Stuck bus
+        if (dev->async.busy == 0U && isr == 0U) lsm303_recover_bus(dev);
+    }
+    return ret;
+}
+
+// Blocking register transfer, bus is locked by bus port
+static uint8_t lsm303_xfer(lsm303_dev_t *dev, const uint8_t write, const uint8_t sad, const uint8_t reg, uint8_t *data, const uint16_t size)
+{
+    if (0 == dev->port) return lsm303_xfer_retry(dev, write, sad, reg, data, size);
+    // Bus port can't lock and wait in interrupt context
+    if (lsm303_isr() != 0U) {
+        dev->stats.busy++;
+        return HAL_BUSY;
+    }
+    if (dev->port->lock(dev->port->ctx) != HAL_OK) {
+        dev->stats.busy++;
+        return HAL_BUSY;
+    }
+    const uint8_t ret = lsm303_xfer_retry(dev, write, sad, reg, data, size);
+    dev->port->unlock(dev->port->ctx);
+    return ret;
+}
+
+static inline uint8_t lsm303_read(lsm303_dev_t *dev, const uint8_t sad, const uint8_t reg, uint8_t *data, const uint16_t size)
+{
+    return lsm303_xfer(dev, 0U, sad, reg, data, size);
+}
+
+static inline uint8_t lsm303_write(lsm303_dev_t *dev, const uint8_t sad, const uint8_t reg, uint8_t *data, const uint16_t size)
+{
+    return lsm303_xfer(dev, 1U, sad, reg, data, size);
+}
+
+// Writable accelerometer registers from CTRL_REG1_A: CTRL_REG1_A..REFERENCE_A, FIFO_CTRL_REG_A, INT1_CFG_A,
+// INT1_THS_A..INT2_CFG_A, INT2_THS_A..CLICK_CFG_A, CLICK_THS_A..TIME_WINDOW_A
+#define LSM303_LA_WRITABLE 0x3DDD407FUL
+// Writable magnetometer registers from CRA_REG_M: CRA_REG_M..MR_REG_M
+#define LSM303_MF_WRITABLE 0x07U
+
+// Update bits of shadow register selected by mask, mark the register dirty if changed
+static void lsm303_set(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const uint8_t reg, const uint8_t mask, const uint8_t value)
+{
+    uint8_t* r = sensor == LSM303_LA ? &dev->shadow.la[reg - LSM303_CTRL_REG1_A] : &dev->shadow.mf[reg - LSM303_CRA_REG_M];
+    const uint8_t v = (*r & ~mask) | (value & mask);
+    if (v == *r) return;
+    *r = v;
+    if (sensor == LSM303_LA) dev->shadow.la_dirty |= 1UL << (reg - LSM303_CTRL_REG1_A);
+    else dev->shadow.mf_dirty |= 1U << (reg - LSM303_CRA_REG_M);
+}
+
+// Write dirty shadow registers: one auto-increment burst from the first to the last dirty register of every writable block
+static uint8_t lsm303_flush(lsm303_dev_t *dev, const lsm303_sensor_t sensor)
+{
+    const uint8_t la = sensor == LSM303_LA ? 1U : 0U;
+    const uint32_t writable = la ? LSM303_LA_WRITABLE : LSM303_MF_WRITABLE;
+    const uint8_t n = la ? LSM303_LA_REGS : LSM303_MF_REGS;
+    const uint8_t base = la ? LSM303_CTRL_REG1_A : LSM303_CRA_REG_M;
+    uint8_t* const regs = la ? &dev->shadow.la[0] : &dev->shadow.mf[0];
+    uint32_t dirty = la ? dev->shadow.la_dirty : dev->shadow.mf_dirty;
+    uint8_t i = 0U;
+    while (dirty != 0U) {
+        // First dirty register
+        while ((dirty & (1UL << i)) == 0U) ++i;
+        // Last dirty register of the writable block
+        uint8_t last = i;
+        for (uint8_t j = i; j < n && (writable & (1UL << j)) != 0U; ++j) {
+            if ((dirty & (1UL << j)) != 0U) last = j;
+        }
+        const uint8_t size = last - i + 1U;
+        // Accelerometer sub-address MSB enables auto-increment, magnetometer increments address itself
+        const uint8_t sub = la ? ((base + i) | 0x80U) : (base + i);
+        const uint8_t ret = lsm303_write(dev, la ? LSM303_LA_SAD : LSM303_MF_SAD, sub, &regs[i], size);
+        if (ret != HAL_OK) return ret;
+        for (uint8_t j = i; j <= last; ++j) {
+            xDebug("0x%02X: 0x%02X %u%u%u%u%u%u%u%u\n",
+                base + j,
+                regs[j],
+                regs[j] >> 7 & 1,
+                regs[j] >> 6 & 1,
+                regs[j] >> 5 & 1,
+                regs[j] >> 4 & 1,
+                regs[j] >> 3 & 1,
+                regs[j] >> 2 & 1,
+                regs[j] >> 1 & 1,
+                regs[j] & 1
+            );
+        }
+        const uint32_t done = ((1UL << size) - 1U) << i;
+        dirty &= ~done;
+        if (la) dev->shadow.la_dirty &= ~done;
+        else dev->shadow.mf_dirty &= ~done;
+        i = last + 1U;
+    }
+    return HAL_OK;
+}
+
+uint8_t lsm303_init(lsm303_dev_t *dev, I2C_HandleTypeDef *i2c)
+{
+    if (0 == dev || 0 == i2c) return HAL_ERROR;
+    memset(dev, 0, sizeof(lsm303_dev_t));
+    dev->i2c = i2c;
+    dev->clock = HAL_GetTick;
+    dev->timeout = LSM303_TIMEOUT;
+    dev->retries = LSM303_RETRIES;
+    for (uint8_t i = 0; i < 3; ++i) dev->mcal.S[i][i] = 1.0F;
+    // Power-on defaults, all written by the first configuration: device state is unknown after MCU reset
+    dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] = 0x07U;
+    dev->shadow.mf[LSM303_CRA_REG_M - LSM303_CRA_REG_M] = 0x10U;
+    dev->shadow.mf[LSM303_CRB_REG_M - LSM303_CRA_REG_M] = 0x20U;
+    dev->shadow.mf[LSM303_MR_REG_M - LSM303_CRA_REG_M] = 0x03U;
+    dev->shadow.la_dirty = LSM303_LA_WRITABLE;
+    dev->shadow.mf_dirty = LSM303_MF_WRITABLE;
+    lsm303_instr_reset(dev, LSM303_LA);
+    lsm303_instr_reset(dev, LSM303_MF);
+    return HAL_OK;
+}
+
+uint8_t lsm303_clock(lsm303_dev_t *dev, lsm303_clock_t clock)
+{
+    if (0 == dev) return HAL_ERROR;
+    dev->clock = clock == 0 ? HAL_GetTick : clock;
+    return HAL_OK;
+}
+
+uint8_t lsm303_timeout(lsm303_dev_t *dev, const uint32_t timeout, const uint8_t retries)
+{
+    if (0 == dev) return HAL_ERROR;
+    dev->timeout = timeout;
+    dev->retries = retries;
+    return HAL_OK;
+}
+
+uint8_t lsm303_bus(lsm303_dev_t *dev, GPIO_TypeDef *scl_port, const uint16_t scl_pin, GPIO_TypeDef *sda_port, const uint16_t sda_pin)
+{
+    if (0 == dev) return HAL_ERROR;
+    dev->bus.scl_port = scl_port;
+    dev->bus.scl_pin = scl_pin;
+    dev->bus.sda_port = sda_port;
+    dev->bus.sda_pin = sda_pin;
+    return HAL_OK;
+}
+
+uint8_t lsm303_port(lsm303_dev_t *dev, const lsm303_port_t *port)
+{
+    if (0 == dev) return HAL_ERROR;
+    if (0 != port && (0 == port->lock || 0 == port->unlock || 0 == port->wait || 0 == port->signal || 0 == port->delay)) return HAL_ERROR;
+    dev->port = port;
+    return HAL_OK;
+}
+
+const lsm303_stats_t* lsm303_stats(const lsm303_dev_t *dev)
+{
+    return &dev->stats;
+}
+
+const lsm303_instr_t* lsm303_instr(const lsm303_dev_t *dev, const lsm303_sensor_t sensor)
+{
+    return &dev->instr[sensor];
+}
+
+void lsm303_instr_reset(lsm303_dev_t *dev, const lsm303_sensor_t sensor)
+{
+    lsm303_instr_t* const in = &dev->instr[sensor];
+    const uint32_t period = in->period;
+    memset(in, 0, sizeof(lsm303_instr_t));
+    in->period = period;
+    in->imin = 0xFFFFFFFFUL;
+}
+
+void lsm303_instr_period(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const uint32_t period)
+{
+    dev->instr[sensor].period = period;
+}
+
+void lsm303_instr_latency(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const uint32_t tick)
+{
+#if LSM303_INSTR != 0
+    lsm303_instr_t* const in = &dev->instr[sensor];
+    const uint32_t d = lsm303_now(dev) - tick;
+    in->lat_n++;
+    in->lat += d;
+    if (d > in->lat_max) in->lat_max = d;
+#else
+    (void)dev;
+    (void)sensor;
+    (void)tick;
+#endif
+}
+
+// Sensitivity and data bit shift of accelerometer by shadow registers
+static void lsm303_la_scale(lsm303_dev_t *dev)
+{
+    const lsm303_reg_ctrl_a1_t a1 = { .reg = dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] };
+    const lsm303_reg_ctrl_a4_t a4 = { .reg = dev->shadow.la[LSM303_CTRL_REG4_A - LSM303_CTRL_REG1_A] };
+    if (a4.hr == 0U) {
         // Normal : Low-power mode
-        lsm303_ashift = lpe == 0U ? 6U : 8U;
-        switch (fs) {
+        dev->ashift = a1.lowPower == 0U ? 6U : 8U;
+        switch (a4.fs) {
         case LSM303_AFS_2G:
-            lsm303_alsb = lpe == 0U ? 0.0039 : 0.01563;
+            dev->alsb = a1.lowPower == 0U ? 0.0039 : 0.01563;
             break;
         case LSM303_AFS_4G:
-            lsm303_alsb = lpe == 0U ? 0.00782 : 0.03126;
+            dev->alsb = a1.lowPower == 0U ? 0.00782 : 0.03126;
             break;
         case LSM303_AFS_8G:
-            lsm303_alsb = lpe == 0U ? 0.01563 : 0.06252;
+            dev->alsb = a1.lowPower == 0U ? 0.01563 : 0.06252;
             break;
         case LSM303_AFS_16G:
-            lsm303_alsb = lpe == 0U ? 0.0469 : 0.18758;
+            dev->alsb = a1.lowPower == 0U ? 0.0469 : 0.18758;
             break;
         }
     }
     else {
         // High-resolution
-        lsm303_ashift = 4U;
-        switch (fs) {
+        dev->ashift = 4U;
+        switch (a4.fs) {
         case LSM303_AFS_2G:
-            lsm303_alsb = 0.00098;
+            dev->alsb = 0.00098;
             break;
         case LSM303_AFS_4G:
-            lsm303_alsb = 0.00195;
+            dev->alsb = 0.00195;
             break;
         case LSM303_AFS_8G:
-            lsm303_alsb = 0.0039;
+            dev->alsb = 0.0039;
             break;
         case LSM303_AFS_16G:
-            lsm303_alsb = 0.01172;
+            dev->alsb = 0.01172;
             break;
         }
     }
+}
+
+// Static configuration refuses accelerometer resolution other than the static one
+static inline uint8_t lsm303_la_fixed(const uint8_t lpe, const uint8_t hr, const uint8_t fs)
+{
+#ifdef LSM303_STATIC
+    const uint8_t lp = (lpe != 0U && hr == 0U) ? 1U : 0U;
+    if ((hr != 0U) != ((LSM303_STATIC_AHR) != 0) || lp != LSM303_STATIC_ALPE || fs != (LSM303_STATIC_AFS)) {
+        xError("Accelerometer mode differs from static configuration!\n");
+        return HAL_ERROR;
+    }
+#else
+    (void)lpe;
+    (void)hr;
+    (void)fs;
+#endif
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_setup(lsm303_dev_t *dev, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr, const lsm303_la_fs_t fs)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+
+    lsm303_reg_ctrl_a1_t a1 = { 0 };
+    lsm303_reg_ctrl_a4_t a4 = { 0 };
+
+    a1.dataRate = odr;
+    a1.lowPower = lpe == 0U ? 0U : 1U;
+    a1.x = 1U;
+    a1.y = 1U;
+    a1.z = 1U;
+
+    a4.hr = hr == 0U ? 0U : 1U;
+    a4.fs = fs;
+    if (lsm303_la_fixed(lpe, hr, fs) != HAL_OK) return HAL_ERROR;
+   
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG1_A, 0xFF, a1.reg);
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG4_A, 0xFF, a4.reg);
+    const uint8_t ret = lsm303_flush(dev, LSM303_LA);
+    if (ret != HAL_OK) return ret;
+
+    lsm303_la_scale(dev);
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_mode(lsm303_dev_t *dev, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_ctrl_a4_t s4 = { .reg = dev->shadow.la[LSM303_CTRL_REG4_A - LSM303_CTRL_REG1_A] };
+    if (lsm303_la_fixed(lpe, hr, s4.fs) != HAL_OK) return HAL_ERROR;
+    // Low-power and high-resolution modes are exclusive: high-resolution wins as in lsm303_la_setup
+    const lsm303_reg_ctrl_a1_t a1 = { .dataRate = odr, .lowPower = (lpe != 0U && hr == 0U) ? 1U : 0U };
+    const lsm303_reg_ctrl_a1_t m1 = { .dataRate = 0x0F, .lowPower = 1U };
+    const lsm303_reg_ctrl_a4_t a4 = { .hr = hr == 0U ? 0U : 1U };
+    const lsm303_reg_ctrl_a4_t m4 = { .hr = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG1_A, m1.reg, a1.reg);
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG4_A, m4.reg, a4.reg);
+    const uint8_t ret = lsm303_flush(dev, LSM303_LA);
+    if (ret != HAL_OK) return ret;
+    lsm303_la_scale(dev);
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_odr(lsm303_dev_t *dev, const lsm303_la_datarate_t odr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_ctrl_a1_t a1 = { .dataRate = odr };
+    const lsm303_reg_ctrl_a1_t m1 = { .dataRate = 0x0F };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG1_A, m1.reg, a1.reg);
+    return lsm303_flush(dev, LSM303_LA);
+}
+
+uint8_t lsm303_la_fs(lsm303_dev_t *dev, const lsm303_la_fs_t fs)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_ctrl_a1_t s1 = { .reg = dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] };
+    const lsm303_reg_ctrl_a4_t s4 = { .reg = dev->shadow.la[LSM303_CTRL_REG4_A - LSM303_CTRL_REG1_A] };
+    if (lsm303_la_fixed(s1.lowPower, s4.hr, fs) != HAL_OK) return HAL_ERROR;
+    const lsm303_reg_ctrl_a4_t a4 = { .fs = fs };
+    const lsm303_reg_ctrl_a4_t m4 = { .fs = 0x03 };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG4_A, m4.reg, a4.reg);
+    const uint8_t ret = lsm303_flush(dev, LSM303_LA);
+    if (ret != HAL_OK) return ret;
+    lsm303_la_scale(dev);
     return HAL_OK;
 }
 
-uint8_t lsm303_la_int1(I2C_HandleTypeDef *i2c, const uint8_t cfg, uint8_t threshould, uint8_t duration)
+uint8_t lsm303_la_lp(lsm303_dev_t *dev, const uint8_t en)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_ctrl_a1_t a1 = { .reg = dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] };
+    const lsm303_reg_ctrl_a4_t a4 = { .reg = dev->shadow.la[LSM303_CTRL_REG4_A - LSM303_CTRL_REG1_A] };
+    return lsm303_la_mode(dev, (lsm303_la_datarate_t)a1.dataRate, en, en == 0U ? a4.hr : 0U);
+}
+
+uint8_t lsm303_la_hr(lsm303_dev_t *dev, const uint8_t en)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_ctrl_a1_t a1 = { .reg = dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] };
+    return lsm303_la_mode(dev, (lsm303_la_datarate_t)a1.dataRate, en == 0U ? a1.lowPower : 0U, en);
+}
+
+uint8_t lsm303_la_int1(lsm303_dev_t *dev, const uint8_t cfg, uint8_t threshould, uint8_t duration)
 {
-    if (0 == i2c) return HAL_ERROR;
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
 
-    uint8_t data[2] = { 0 };
     lsm303_reg_ctrl_a3_t r = { 0 };
 
     if (cfg == 0U) {
@@ -269,282 +827,915 @@ uint8_t lsm303_la_int1(I2C_HandleTypeDef *i2c, const uint8_t cfg, uint8_t thresh
         r.aoi1 = 1U;
     }
 
-    // Configure INT1
-    data[0] = LSM303_INT1_CFG_A;
-    data[1] = cfg;
-    uint8_t ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("INT1_CFG_A: 0x%02X %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    // Threshould
-    data[0] = LSM303_INT1_THS_A;
-    data[1] = threshould;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("INT1_THS_A: 0x%02X %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    // Duration
-    data[0] = LSM303_INT1_DURATION_A;
-    data[1] = duration;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("INT1_DURATION_A: 0x%02X %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    // Activate IRQ to INT1 output
-    data[0] = LSM303_CTRL_REG3_A;
-    data[1] = r.reg;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_LA_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("CTRL_REG3_A: 0x%02X %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-    return HAL_OK;
+    // Configure INT1, threshould and duration
+    lsm303_set(dev, LSM303_LA, LSM303_INT1_CFG_A, 0xFF, cfg);
+    lsm303_set(dev, LSM303_LA, LSM303_INT1_THS_A, 0xFF, threshould);
+    lsm303_set(dev, LSM303_LA, LSM303_INT1_DURATION_A, 0xFF, duration);
+
+    // Activate IRQ to INT1 output (keep other INT1 sources, for example FIFO watermark)
+    const lsm303_reg_ctrl_a3_t mask = { .aoi1 = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG3_A, mask.reg, r.reg);
+    return lsm303_flush(dev, LSM303_LA);
 }
 
-uint8_t lsm303_la_src1(I2C_HandleTypeDef *i2c, uint8_t *src)
+uint8_t lsm303_la_fifo(lsm303_dev_t *dev, const lsm303_la_fifo_t fm, uint8_t wtm, const uint8_t irq)
 {
-    return HAL_I2C_Mem_Read(i2c, LSM303_LA_SAD, LSM303_INT1_SRC_A, I2C_MEMADD_SIZE_8BIT, src, sizeof(uint8_t), HAL_MAX_DELAY);
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+
+    lsm303_reg_fifo_ctrl_a_t f = { 0 };
+    lsm303_reg_ctrl_a5_t a5 = { 0 };
+    lsm303_reg_ctrl_a3_t a3 = { 0 };
+
+    if (wtm > LSM303_FIFO_SIZE - 1U) wtm = LSM303_FIFO_SIZE - 1U;
+    f.fm = fm;
+    f.fth = wtm;
+    a5.fifo_en = fm == LSM303_AFIFO_BYPASS ? 0U : 1U;
+    a3.wtm = (irq == 0U || fm == LSM303_AFIFO_BYPASS) ? 0U : 1U;
+
+    // Enable FIFO
+    const lsm303_reg_ctrl_a5_t m5 = { .fifo_en = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG5_A, m5.reg, a5.reg);
+
+    // FIFO mode and watermark
+    lsm303_set(dev, LSM303_LA, LSM303_FIFO_CTRL_REG_A, 0xFF, f.reg);
+
+    // Watermark IRQ to INT1 output
+    const lsm303_reg_ctrl_a3_t m3 = { .wtm = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG3_A, m3.reg, a3.reg);
+    return lsm303_flush(dev, LSM303_LA);
 }
 
-uint8_t lsm303_la_raw(I2C_HandleTypeDef *i2c, int16_t *x, int16_t *y, int16_t *z)
+uint8_t lsm303_la_fifo_src(lsm303_dev_t *dev, uint8_t *src)
 {
-    if (0 == i2c) return HAL_ERROR;
-    // Read status
-    uint8_t ret = HAL_I2C_Mem_Read(i2c, LSM303_LA_SAD, LSM303_STATUS_REG_A, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(uint8_t), HAL_MAX_DELAY);
+    if (0 == dev || 0 == dev->i2c || 0 == src) return HAL_ERROR;
+    return lsm303_read(dev, LSM303_LA_SAD, LSM303_FIFO_SRC_REG_A, src, sizeof(uint8_t));
+}
+
+uint8_t lsm303_la_fifo_read(lsm303_dev_t *dev, int16_t *buf, const uint8_t max, uint8_t *cnt)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == buf || 0 == cnt) return HAL_ERROR;
+    *cnt = 0U;
+    // Read FIFO level
+    lsm303_reg_fifo_src_a_t src = { 0 };
+    uint8_t ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_FIFO_SRC_REG_A, &src.reg, sizeof(uint8_t));
     if (ret != HAL_OK) {
-        xWarning("STATUS_REG_A Read Error!\n");
+        xWarning("FIFO_SRC_REG_A Read Error!\n");
         return ret;
     }
     // Check data available
-    if ((lsm303_buf[0] >> 3 & 1) == 0U) {
-        xWarning("Accelerometer data unavailable!\n");
-        return HAL_BUSY;
-    }
-    // Read
-    ret = HAL_I2C_Mem_Read(i2c, LSM303_LA_SAD, LSM303_OUT_X_L_A | 0b10000000, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(lsm303_buf), HAL_MAX_DELAY);
+    lsm303_la_fifo_ovrn(dev, src.reg);
+    uint8_t n = src.ovrn ? LSM303_FIFO_SIZE : src.fss;
+    if (src.empty || n == 0U) return HAL_BUSY;
+    if (n > max) n = max;
+    if (n == 0U) return HAL_BUSY;
+    // Burst read: with enabled FIFO the address rolls back from OUT_Z_H_A to OUT_X_L_A
+    uint8_t* raw = (uint8_t*)buf;
+    const uint32_t t0 = lsm303_instr_start(dev);
+    ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_OUT_X_L_A | 0b10000000, raw, n * 6U);
+    lsm303_instr_bus(dev, LSM303_LA, t0);
     if (ret != HAL_OK) {
         xWarning("OUT_X_L_A Read Error!\n");
         return ret;
     }
-    // Conversion
-    *x = (int16_t)(lsm303_buf[1] << 8 | lsm303_buf[0]) >> lsm303_ashift;
-    *y = (int16_t)(lsm303_buf[3] << 8 | lsm303_buf[2]) >> lsm303_ashift;
-    *z = (int16_t)(lsm303_buf[5] << 8 | lsm303_buf[4]) >> lsm303_ashift;
+    // Conversion in place
+    for (uint16_t i = 0; i < n * 3U; ++i) {
+        buf[i] = (int16_t)(raw[2 * i + 1] << 8 | raw[2 * i]) >> LSM303_ASHIFT(dev);
+    }
+    lsm303_instr_deliver(dev, LSM303_LA, n, 0U);
+    *cnt = n;
     return HAL_OK;
 }
 
-uint8_t lsm303_la_read(I2C_HandleTypeDef *i2c, float* x, float* y, float* z)
+void lsm303_la_soa(lsm303_dev_t *dev, const int16_t *buf, const uint16_t n, float *x, float *y, float *z)
+{
+    const float lsb = LSM303_ALSB(dev);
+    for (uint16_t i = 0; i < n; ++i) {
+        x[i] = (float)buf[3 * i] * lsb;
+        y[i] = (float)buf[3 * i + 1] * lsb;
+        z[i] = (float)buf[3 * i + 2] * lsb;
+    }
+}
+
+uint8_t lsm303_la_src1(lsm303_dev_t *dev, uint8_t *src)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    return lsm303_read(dev, LSM303_LA_SAD, LSM303_INT1_SRC_A, src, sizeof(uint8_t));
+}
+
+uint8_t lsm303_la_int2(lsm303_dev_t *dev, const uint8_t cfg, uint8_t threshould, uint8_t duration)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+
+    lsm303_reg_ctrl_a6_t r = { 0 };
+
+    if (cfg == 0U) {
+        threshould = 0U;
+        duration = 0U;
+    }
+    else {
+        if (threshould > 0x7F) threshould = 0x7F;
+        if (duration > 0x7F) duration = 0x7F;
+        r.i2_int2 = 1U;
+    }
+
+    // Configure INT2, threshould and duration
+    lsm303_set(dev, LSM303_LA, LSM303_INT2_CFG_A, 0xFF, cfg);
+    lsm303_set(dev, LSM303_LA, LSM303_INT2_THS_A, 0xFF, threshould);
+    lsm303_set(dev, LSM303_LA, LSM303_INT2_DURATION_A, 0xFF, duration);
+
+    // Activate IRQ to INT2 output (keep other PAD2 sources, for example click)
+    const lsm303_reg_ctrl_a6_t mask = { .i2_int2 = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG6_A, mask.reg, r.reg);
+    return lsm303_flush(dev, LSM303_LA);
+}
+
+uint8_t lsm303_la_src2(lsm303_dev_t *dev, uint8_t *src)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    return lsm303_read(dev, LSM303_LA_SAD, LSM303_INT2_SRE_A, src, sizeof(uint8_t));
+}
+
+uint8_t lsm303_la_click(lsm303_dev_t *dev, const uint8_t cfg, uint8_t threshould, uint8_t limit, uint8_t latency, uint8_t window, const lsm303_la_pad_t pad)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+
+    lsm303_reg_ctrl_a3_t a3 = { 0 };
+    lsm303_reg_ctrl_a6_t a6 = { 0 };
+
+    if (cfg == 0U) {
+        threshould = 0U;
+        limit = 0U;
+        latency = 0U;
+        window = 0U;
+    }
+    else {
+        if (threshould > 0x7F) threshould = 0x7F;
+        if (limit > 0x7F) limit = 0x7F;
+        a3.click = pad == LSM303_APAD_INT1 ? 1U : 0U;
+        a6.i2_clicken = pad == LSM303_APAD_INT2 ? 1U : 0U;
+    }
+
+    // Configure click axes, threshould and time windows: one burst of CLICK_CFG_A .. TIME_WINDOW_A
+    lsm303_set(dev, LSM303_LA, LSM303_CLICK_CFG_A, 0xFF, cfg);
+    lsm303_set(dev, LSM303_LA, LSM303_CLICK_THS_A, 0xFF, threshould);
+    lsm303_set(dev, LSM303_LA, LSM303_TIME_LIMIT_A, 0xFF, limit);
+    lsm303_set(dev, LSM303_LA, LSM303_TIME_LATENCY_A, 0xFF, latency);
+    lsm303_set(dev, LSM303_LA, LSM303_TIME_WINDOW_A, 0xFF, window);
+
+    // Route IRQ to selected pad only
+    const lsm303_reg_ctrl_a3_t m3 = { .click = 1U };
+    const lsm303_reg_ctrl_a6_t m6 = { .i2_clicken = 1U };
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG3_A, m3.reg, a3.reg);
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG6_A, m6.reg, a6.reg);
+    return lsm303_flush(dev, LSM303_LA);
+}
+
+uint8_t lsm303_la_click_src(lsm303_dev_t *dev, uint8_t *src)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    return lsm303_read(dev, LSM303_LA_SAD, LSM303_CLICK_SRC_A, src, sizeof(uint8_t));
+}
+
+uint8_t lsm303_la_ths(const lsm303_dev_t *dev, const float g)
+{
+    // Threshold LSB by full-scale, g
+    static const float lsb[4] = { 0.016F, 0.032F, 0.062F, 0.186F };
+    const lsm303_reg_ctrl_a4_t a4 = { .reg = dev->shadow.la[LSM303_CTRL_REG4_A - LSM303_CTRL_REG1_A] };
+    if (g <= 0.0F) return 0U;
+    const float ths = g / lsb[a4.fs] + 0.5F;
+    return ths >= 127.0F ? 0x7F : (uint8_t)ths;
+}
+
+// Output data rate by shadow registers, Hz
+static float lsm303_la_hz(const lsm303_dev_t *dev)
+{
+    static const float hz[10] = { 0.0F, 1.0F, 10.0F, 25.0F, 50.0F, 100.0F, 200.0F, 400.0F, 1620.0F, 1344.0F };
+    const lsm303_reg_ctrl_a1_t a1 = { .reg = dev->shadow.la[LSM303_CTRL_REG1_A - LSM303_CTRL_REG1_A] };
+    if (a1.dataRate > LSM303_ADATARATE_SPEC) return 0.0F;
+    if (a1.dataRate == LSM303_ADATARATE_SPEC && a1.lowPower != 0U) return 5376.0F;
+    return hz[a1.dataRate];
+}
+
+uint8_t lsm303_la_ticks(const lsm303_dev_t *dev, const float ms)
+{
+    if (ms <= 0.0F) return 0U;
+    const float n = ms * lsm303_la_hz(dev) / 1000.0F + 0.5F;
+    return n >= 255.0F ? 0xFF : (uint8_t)n;
+}
+
+uint8_t lsm303_la_freefall(lsm303_dev_t *dev, const lsm303_la_pad_t pad, const float g, const float ms)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    if (lsm303_la_hz(dev) == 0.0F) {
+        xWarning("Free-fall: accelerometer is in power-down mode\n");
+        return HAL_ERROR;
+    }
+    // All axes are low: AND of XL, YL and ZL events
+    const lsm303_reg_int_cfg_a_t cfg = { .xle = 1U, .yle = 1U, .zle = 1U, .aoi6d = LSM303_AAND };
+    const uint8_t ths = lsm303_la_ths(dev, g);
+    const uint8_t dur = lsm303_la_ticks(dev, ms);
+    if (pad == LSM303_APAD_INT1) return lsm303_la_int1(dev, cfg.reg, ths, dur);
+    return lsm303_la_int2(dev, cfg.reg, ths, dur);
+}
+
+// Read accelerometer status and data by one auto-increment burst: STATUS_REG_A precedes OUT_X_L_A
+static uint8_t lsm303_la_burst(lsm303_dev_t *dev, uint8_t *sr)
 {
-    if (0 == i2c) return HAL_ERROR;
-    // Read status
-    uint8_t ret = HAL_I2C_Mem_Read(i2c, LSM303_LA_SAD, LSM303_STATUS_REG_A, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(uint8_t), HAL_MAX_DELAY);
+    const uint32_t t0 = lsm303_instr_start(dev);
+    uint8_t ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_STATUS_REG_A | 0b10000000, &dev->buf[0], sizeof(dev->buf));
+    const uint32_t t1 = lsm303_instr_bus(dev, LSM303_LA, t0);
     if (ret != HAL_OK) {
         xWarning("STATUS_REG_A Read Error!\n");
         return ret;
     }
+    const lsm303_reg_status_a_t status = { .reg = dev->buf[0] };
+    if (0 != sr) *sr = status.reg;
+    if (status.zyxovr != 0U) {
+        dev->stats.overrun++;
+        dev->instr[LSM303_LA].overrun++;
+    }
     // Check data available
-    if ((lsm303_buf[0] >> 3 & 1) == 0U) {
-        //xWarning("Accelerometer data unavailable!\n");
+    if (status.zyxda == 0U) {
+        dev->stats.notready++;
+        dev->instr[LSM303_LA].notready++;
         return HAL_BUSY;
     }
+    lsm303_instr_deliver(dev, LSM303_LA, 1U, t1);
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_rawsr(lsm303_dev_t *dev, int16_t *x, int16_t *y, int16_t *z, uint8_t *sr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
     // Read
-    ret = HAL_I2C_Mem_Read(i2c, LSM303_LA_SAD, LSM303_OUT_X_L_A | 0b10000000, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(lsm303_buf), HAL_MAX_DELAY);
+    const uint8_t ret = lsm303_la_burst(dev, sr);
+    if (ret == HAL_BUSY) xWarning("Accelerometer data unavailable!\n");
+    if (ret != HAL_OK) return ret;
+    // Conversion
+    lsm303_la_conv(&dev->buf[1], LSM303_ASHIFT(dev), x, y, z);
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_raw(lsm303_dev_t *dev, int16_t *x, int16_t *y, int16_t *z)
+{
+    return lsm303_la_rawsr(dev, x, y, z, 0);
+}
+
+uint8_t lsm303_la_readsr(lsm303_dev_t *dev, float* x, float* y, float* z, uint8_t *sr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    // Read
+    const uint8_t ret = lsm303_la_burst(dev, sr);
+    if (ret != HAL_OK) return ret;
+    // Conversion
+    int16_t r[3] = { 0 };
+    lsm303_la_conv(&dev->buf[1], LSM303_ASHIFT(dev), &r[0], &r[1], &r[2]);
+    *x = (float)r[0] * LSM303_ALSB(dev);
+    *y = (float)r[1] * LSM303_ALSB(dev);
+    *z = (float)r[2] * LSM303_ALSB(dev);
+    return HAL_OK;
+}
+
+uint8_t lsm303_la_read(lsm303_dev_t *dev, float* x, float* y, float* z)
+{
+    return lsm303_la_readsr(dev, x, y, z, 0);
+}
+
+uint8_t lsm303_la_sample(lsm303_dev_t *dev, lsm303_sample_t *s)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == s) return HAL_ERROR;
+    const uint32_t t0 = lsm303_instr_start(dev);
+    uint8_t ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_STATUS_REG_A | 0b10000000, (uint8_t*)s, 7U);
+    const uint32_t t1 = lsm303_instr_bus(dev, LSM303_LA, t0);
+    if (ret != HAL_OK) {
+        xWarning("STATUS_REG_A Read Error!\n");
+        return ret;
+    }
+    ret = lsm303_la_unpack(dev, s);
+    if (ret == HAL_OK) lsm303_instr_deliver(dev, LSM303_LA, 1U, t1);
+    return ret;
+}
+
+uint8_t lsm303_la_fifo_samples(lsm303_dev_t *dev, lsm303_sample_t *s, const uint8_t max, uint8_t *cnt)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == s || 0 == cnt) return HAL_ERROR;
+    *cnt = 0U;
+    // Read FIFO level
+    lsm303_reg_fifo_src_a_t src = { 0 };
+    uint8_t ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_FIFO_SRC_REG_A, &src.reg, sizeof(uint8_t));
+    if (ret != HAL_OK) {
+        xWarning("FIFO_SRC_REG_A Read Error!\n");
+        return ret;
+    }
+    // Check data available
+    lsm303_la_fifo_ovrn(dev, src.reg);
+    uint8_t n = src.ovrn ? LSM303_FIFO_SIZE : src.fss;
+    if (src.empty || n == 0U) return HAL_BUSY;
+    if (n > max) n = max;
+    if (n == 0U) return HAL_BUSY;
+    // Burst read into the tail of samples
+    const uint32_t t0 = lsm303_instr_start(dev);
+    ret = lsm303_read(dev, LSM303_LA_SAD, LSM303_OUT_X_L_A | 0b10000000, (uint8_t*)s + lsm303_fifo_offset(n), n * 6U);
+    lsm303_instr_bus(dev, LSM303_LA, t0);
     if (ret != HAL_OK) {
         xWarning("OUT_X_L_A Read Error!\n");
         return ret;
     }
-    // Conversion
-    *x = (float)((int16_t)(lsm303_buf[1] << 8 | lsm303_buf[0]) >> lsm303_ashift) * lsm303_alsb;
-    *y = (float)((int16_t)(lsm303_buf[3] << 8 | lsm303_buf[2]) >> lsm303_ashift) * lsm303_alsb;
-    *z = (float)((int16_t)(lsm303_buf[5] << 8 | lsm303_buf[4]) >> lsm303_ashift) * lsm303_alsb;
+    lsm303_la_unpack_fifo(dev, s, n, src.reg);
+    lsm303_instr_deliver(dev, LSM303_LA, n, 0U);
+    *cnt = n;
     return HAL_OK;
 }
 
-uint8_t lsm303_mf_setup(I2C_HandleTypeDef *i2c, const uint8_t ten, const lsm303_mf_do_t odr, const lsm303_mf_gain_t gn, const lsm303_mf_md_t md)
+// Fold sensitivity, calibration and temperature offset into affine transform: W = S * diag(100 / lsb), c = -S * b - off(T)
+static void lsm303_mf_affine(lsm303_dev_t *dev)
 {
-    if (0 == i2c) return HAL_ERROR;
-
-    uint8_t data[2] = { 0 };
-    lsm303_reg_cra_t a = { 0 };
-    lsm303_reg_crb_t b = { 0 };
-    lsm303_reg_mr_t r = { 0 };
-
-    a.temperature = ten == 0U ? 0U : 1U;
-    a.dataRate = odr;
-    b.gain = gn;
-    r.mode = md;
+    const float k[3] = {
+        dev->mlsb_xy > 0.0F ? 100.0F / dev->mlsb_xy : 0.0F,
+        dev->mlsb_xy > 0.0F ? 100.0F / dev->mlsb_xy : 0.0F,
+        dev->mlsb_z > 0.0F ? 100.0F / dev->mlsb_z : 0.0F
+    };
+    for (uint8_t i = 0; i < 3; ++i) {
+        dev->mc[i] = 0.0F;
+        for (uint8_t j = 0; j < 3; ++j) {
+            dev->mW[i][j] = dev->mcal.S[i][j] * k[j];
+            dev->mc[i] -= dev->mcal.S[i][j] * dev->mcal.b[j];
+        }
+        dev->mc[i] -= dev->mtc.cur[i];
+    }
+}
 
-    data[0] = LSM303_CRA_REG_M;
-    data[1] = a.reg;
-    uint8_t ret = HAL_I2C_Master_Transmit(i2c, LSM303_MF_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("CRA_REG_M: 0x%02x %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    data[0] = LSM303_CRB_REG_M;
-    data[1] = b.reg;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_MF_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("CRB_REG_M: 0x%02x %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    data[0] = LSM303_MR_REG_M;
-    data[1] = r.reg;
-    ret = HAL_I2C_Master_Transmit(i2c, LSM303_MF_SAD, &data[0], sizeof(data), HAL_MAX_DELAY);
-    if (ret != HAL_OK) return ret;
-    xDebug("MR_REG_M: 0x%02x %u%u%u%u%u%u%u%u\n",
-        data[1],
-        data[1] >> 7 & 1,
-        data[1] >> 6 & 1,
-        data[1] >> 5 & 1,
-        data[1] >> 4 & 1,
-        data[1] >> 3 & 1,
-        data[1] >> 2 & 1,
-        data[1] >> 1 & 1,
-        data[1] & 1
-    );
-
-    switch (gn) {
+// Sensitivity of magnetometer by shadow registers and calibration transform
+static void lsm303_mf_scale(lsm303_dev_t *dev)
+{
+    const lsm303_reg_crb_t b = { .reg = dev->shadow.mf[LSM303_CRB_REG_M - LSM303_CRA_REG_M] };
+    switch (b.gain) {
     case LSM303_MGAIN_1_3:
-        lsm303_mlsb_xy = 1100.0F;
-        lsm303_mlsb_z = 980.0F;
+        dev->mlsb_xy = 1100.0F;
+        dev->mlsb_z = 980.0F;
         break;
     case LSM303_MGAIN_1_9:
-        lsm303_mlsb_xy = 855.0F;
-        lsm303_mlsb_z = 760.0F;
+        dev->mlsb_xy = 855.0F;
+        dev->mlsb_z = 760.0F;
         break;
     case LSM303_MGAIN_2_5:
-        lsm303_mlsb_xy = 670.0F;
-        lsm303_mlsb_z = 600.0F;
+        dev->mlsb_xy = 670.0F;
+        dev->mlsb_z = 600.0F;
         break;
     case LSM303_MGAIN_4_0:
-        lsm303_mlsb_xy = 450.0F;
-        lsm303_mlsb_z = 400.0F;
+        dev->mlsb_xy = 450.0F;
+        dev->mlsb_z = 400.0F;
         break;
     case LSM303_MGAIN_4_7:
-        lsm303_mlsb_xy = 400.0F;
-        lsm303_mlsb_z = 355.0F;
+        dev->mlsb_xy = 400.0F;
+        dev->mlsb_z = 355.0F;
         break;
     case LSM303_MGAIN_5_6:
-        lsm303_mlsb_xy = 330.0F;
-        lsm303_mlsb_z = 295.0F;
+        dev->mlsb_xy = 330.0F;
+        dev->mlsb_z = 295.0F;
         break;
     case LSM303_MGAIN_8_1:
-        lsm303_mlsb_xy = 230.0F;
-        lsm303_mlsb_z = 205.0F;
+        dev->mlsb_xy = 230.0F;
+        dev->mlsb_z = 205.0F;
         break;
     }
+    lsm303_mf_affine(dev);
+}
+
+// Static configuration refuses magnetometer gain other than the static one
+static inline uint8_t lsm303_mf_fixed(const uint8_t gn)
+{
+#ifdef LSM303_STATIC
+    if (gn != (LSM303_STATIC_MGAIN)) {
+        xError("Magnetometer gain differs from static configuration!\n");
+        return HAL_ERROR;
+    }
+#else
+    (void)gn;
+#endif
+    return HAL_OK;
+}
+
+uint8_t lsm303_mf_setup(lsm303_dev_t *dev, const uint8_t ten, const lsm303_mf_do_t odr, const lsm303_mf_gain_t gn, const lsm303_mf_md_t md)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+
+    if (lsm303_mf_fixed(gn) != HAL_OK) return HAL_ERROR;
+
+    lsm303_reg_cra_t a = { 0 };
+    lsm303_reg_crb_t b = { 0 };
+    lsm303_reg_mr_t r = { 0 };
+
+    a.temperature = ten == 0U ? 0U : 1U;
+    a.dataRate = odr;
+    b.gain = gn;
+    r.mode = md;
+
+    lsm303_set(dev, LSM303_MF, LSM303_CRA_REG_M, 0xFF, a.reg);
+    lsm303_set(dev, LSM303_MF, LSM303_CRB_REG_M, 0xFF, b.reg);
+    lsm303_set(dev, LSM303_MF, LSM303_MR_REG_M, 0xFF, r.reg);
+    const uint8_t ret = lsm303_flush(dev, LSM303_MF);
+    if (ret != HAL_OK) return ret;
+
+    lsm303_mf_scale(dev);
+    return HAL_OK;
+}
+
+#ifdef LSM303_STATIC
+uint8_t lsm303_static_setup(lsm303_dev_t *dev)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    // CTRL_REG1_A .. CTRL_REG4_A burst
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG1_A, 0xFF, LSM303_STATIC_CTRL_REG1_A);
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG4_A, 0xFF, LSM303_STATIC_CTRL_REG4_A);
+    uint8_t ret = lsm303_flush(dev, LSM303_LA);
+    if (ret != HAL_OK) return ret;
+    lsm303_la_scale(dev);
+    // CRA_REG_M .. MR_REG_M burst
+    lsm303_set(dev, LSM303_MF, LSM303_CRA_REG_M, 0xFF, LSM303_STATIC_CRA_REG_M);
+    lsm303_set(dev, LSM303_MF, LSM303_CRB_REG_M, 0xFF, LSM303_STATIC_CRB_REG_M);
+    lsm303_set(dev, LSM303_MF, LSM303_MR_REG_M, 0xFF, LSM303_STATIC_MR_REG_M);
+    ret = lsm303_flush(dev, LSM303_MF);
+    if (ret != HAL_OK) return ret;
+    lsm303_mf_scale(dev);
+    return HAL_OK;
+}
+#endif
+
+uint8_t lsm303_mf_odr(lsm303_dev_t *dev, const lsm303_mf_do_t odr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_cra_t a = { .dataRate = odr };
+    const lsm303_reg_cra_t m = { .dataRate = 0x07 };
+    lsm303_set(dev, LSM303_MF, LSM303_CRA_REG_M, m.reg, a.reg);
+    return lsm303_flush(dev, LSM303_MF);
+}
+
+uint8_t lsm303_mf_gain(lsm303_dev_t *dev, const lsm303_mf_gain_t gn)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    if (lsm303_mf_fixed(gn) != HAL_OK) return HAL_ERROR;
+    const lsm303_reg_crb_t b = { .gain = gn };
+    lsm303_set(dev, LSM303_MF, LSM303_CRB_REG_M, 0xFF, b.reg);
+    const uint8_t ret = lsm303_flush(dev, LSM303_MF);
+    if (ret != HAL_OK) return ret;
+    lsm303_mf_scale(dev);
+    return HAL_OK;
+}
+
+uint8_t lsm303_mf_calib(lsm303_dev_t *dev, const lsm303_mcal_t *cal)
+{
+    if (0 == dev) return HAL_ERROR;
+    if (0 == cal) {
+        memset(&dev->mcal, 0, sizeof(lsm303_mcal_t));
+        for (uint8_t i = 0; i < 3; ++i) dev->mcal.S[i][i] = 1.0F;
+    }
+    else dev->mcal = *cal;
+    lsm303_mf_affine(dev);
     return HAL_OK;
 }
 
-uint8_t lsm303_mf_raw(I2C_HandleTypeDef* i2c, int16_t* x, int16_t* y, int16_t* z)
+void lsm303_mf_apply(const lsm303_dev_t *dev, const float r[3], float m[3])
+{
+    for (uint8_t i = 0; i < 3; ++i) {
+        m[i] = dev->mc[i] + dev->mW[i][0] * r[0] + dev->mW[i][1] * r[1] + dev->mW[i][2] * r[2];
+    }
+}
+
+uint8_t lsm303_mf_tcomp(lsm303_dev_t *dev, const float (*off)[3], const uint8_t n, const float t0, const float step, const uint16_t every)
 {
-    if (0 == i2c) return HAL_ERROR;
-    // Read status
-    uint8_t ret = HAL_I2C_Mem_Read(i2c, LSM303_MF_SAD, LSM303_SR_REG_M, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(uint8_t), HAL_MAX_DELAY);
+    if (0 == dev || (0 != off && (n == 0U || (n > 1U && step <= 0.0F)))) return HAL_ERROR;
+    dev->mtc.off = off;
+    dev->mtc.n = 0 != off ? n : 0U;
+    dev->mtc.t0 = t0;
+    dev->mtc.step = step;
+    dev->mtc.every = 0 != off ? every : 0U;
+    dev->mtc.cnt = 0U;
+    for (uint8_t i = 0; i < 3; ++i) dev->mtc.cur[i] = 0.0F;
+    // Offset of the first entry until the first temperature read
+    if (0 != off) {
+        for (uint8_t i = 0; i < 3; ++i) dev->mtc.cur[i] = off[0][i];
+    }
+    lsm303_mf_affine(dev);
+    return HAL_OK;
+}
+
+// Offset of temperature by table, linear interpolation
+static void lsm303_mf_toff(lsm303_dev_t *dev, const float t)
+{
+    const lsm303_mtcomp_t* const c = &dev->mtc;
+    if (0 == c->off) return;
+    const float u = c->n > 1U ? (t - c->t0) / c->step : 0.0F;
+    uint8_t k = 0U;
+    float f = 0.0F;
+    if (u >= (float)(c->n - 1U)) k = c->n - 1U;
+    else if (u > 0.0F) {
+        k = (uint8_t)u;
+        f = u - (float)k;
+    }
+    for (uint8_t i = 0; i < 3; ++i) {
+        dev->mtc.cur[i] = f > 0.0F ? c->off[k][i] + f * (c->off[k + 1U][i] - c->off[k][i]) : c->off[k][i];
+    }
+    lsm303_mf_affine(dev);
+}
+
+uint8_t lsm303_mf_temp(lsm303_dev_t *dev, float *t)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    const lsm303_reg_cra_t a = { .reg = dev->shadow.mf[LSM303_CRA_REG_M - LSM303_CRA_REG_M] };
+    if (a.temperature == 0U) return HAL_ERROR;
+    uint8_t buf[2] = { 0 };
+    const uint8_t ret = lsm303_read(dev, LSM303_MF_SAD, LSM303_TEMP_OUT_H_M, &buf[0], sizeof(buf));
     if (ret != HAL_OK) {
-        xWarning("SR_REG_M Read Error!\n");
+        xWarning("TEMP_OUT_H_M Read Error!\n");
         return ret;
     }
-    // Check is data ready (0 bit in register)
-    if ((lsm303_buf[0] & 1) == 0) {
-        xWarning("Magnetometer data not ready\n");
-        return HAL_BUSY;
-    }
-    // Read data
-    ret = HAL_I2C_Mem_Read(i2c, LSM303_MF_SAD, LSM303_OUT_X_H_M, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(lsm303_buf), HAL_MAX_DELAY);
+    // 12-bit left-justified, 8 LSB/deg
+    dev->mtc.t = (float)((int16_t)(buf[0] << 8 | buf[1]) >> 4) * 0.125F;
+    dev->mtc.cnt = 0U;
+    lsm303_mf_toff(dev, dev->mtc.t);
+    if (0 != t) *t = dev->mtc.t;
+    return HAL_OK;
+}
+
+// Decimated temperature read after blocking magnetometer read
+static inline void lsm303_mf_tstep(lsm303_dev_t *dev)
+{
+    if (dev->mtc.every == 0U || ++dev->mtc.cnt < dev->mtc.every) return;
+    lsm303_mf_temp(dev, 0);
+}
+
+// Read magnetometer data and status by one burst: SR_REG_M follows OUT_Y_L_M
+static uint8_t lsm303_mf_burst(lsm303_dev_t *dev, uint8_t *sr)
+{
+    const uint32_t t0 = lsm303_instr_start(dev);
+    uint8_t ret = lsm303_read(dev, LSM303_MF_SAD, LSM303_OUT_X_H_M, &dev->buf[0], sizeof(dev->buf));
+    const uint32_t t1 = lsm303_instr_bus(dev, LSM303_MF, t0);
     if (ret != HAL_OK) {
         xWarning("OUT_X_H_M Read Error!\n");
         return ret;
     }
+    const lsm303_reg_sr_m_t status = { .reg = dev->buf[6] };
+    if (0 != sr) *sr = status.reg;
+    // Check is data ready
+    if (status.drdy == 0U) {
+        dev->stats.notready++;
+        dev->instr[LSM303_MF].notready++;
+        return HAL_BUSY;
+    }
+    lsm303_instr_deliver(dev, LSM303_MF, 1U, t1);
+    lsm303_mf_tstep(dev);
+    return HAL_OK;
+}
+
+uint8_t lsm303_mf_rawsr(lsm303_dev_t *dev, int16_t* x, int16_t* y, int16_t* z, uint8_t* sr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    // Read
+    const uint8_t ret = lsm303_mf_burst(dev, sr);
+    if (ret == HAL_BUSY) xWarning("Magnetometer data not ready\n");
+    if (ret != HAL_OK) return ret;
     // Conversion
-    *x = (int16_t)(lsm303_buf[0] << 8 | lsm303_buf[1]);
-    *y = (int16_t)(lsm303_buf[4] << 8 | lsm303_buf[5]);
-    *z = (int16_t)(lsm303_buf[2] << 8 | lsm303_buf[3]);
+    lsm303_mf_conv(&dev->buf[0], x, y, z);
     return HAL_OK;
 }
 
-uint8_t lsm303_mf_read(I2C_HandleTypeDef *i2c, float* x, float* y, float* z)
+uint8_t lsm303_mf_raw(lsm303_dev_t *dev, int16_t* x, int16_t* y, int16_t* z)
+{
+    return lsm303_mf_rawsr(dev, x, y, z, 0);
+}
+
+uint8_t lsm303_mf_readsr(lsm303_dev_t *dev, float* x, float* y, float* z, uint8_t* sr)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    // Read
+    const uint8_t ret = lsm303_mf_burst(dev, sr);
+    if (ret != HAL_OK) return ret;
+    // Conversion
+    int16_t r[3] = { 0 };
+    lsm303_mf_conv(&dev->buf[0], &r[0], &r[1], &r[2]);
+    const float f[3] = { (float)r[0], (float)r[1], (float)r[2] };
+    float m[3];
+    lsm303_mf_apply(dev, f, m);
+    *x = m[0];
+    *y = m[1];
+    *z = m[2];
+    return HAL_OK;
+}
+
+uint8_t lsm303_mf_read(lsm303_dev_t *dev, float* x, float* y, float* z)
+{
+    return lsm303_mf_readsr(dev, x, y, z, 0);
+}
+
+uint8_t lsm303_mf_sample(lsm303_dev_t *dev, lsm303_sample_t *s)
 {
-    if (0 == i2c) return HAL_ERROR;
-    // Read status
-    uint8_t ret = HAL_I2C_Mem_Read(i2c, LSM303_MF_SAD, LSM303_SR_REG_M, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(uint8_t), HAL_MAX_DELAY);
+    if (0 == dev || 0 == dev->i2c || 0 == s) return HAL_ERROR;
+    const uint32_t t0 = lsm303_instr_start(dev);
+    uint8_t ret = lsm303_read(dev, LSM303_MF_SAD, LSM303_OUT_X_H_M, (uint8_t*)s, 7U);
+    const uint32_t t1 = lsm303_instr_bus(dev, LSM303_MF, t0);
     if (ret != HAL_OK) {
-        xWarning("SR_REG_M Read Error!\n");
+        xWarning("OUT_X_H_M Read Error!\n");
         return ret;
     }
-    // Check is data ready (0 bit in register)
-    if ((lsm303_buf[0] & 1) == 0) {
-        //xWarning("Magnetometer data not ready\n");
+    ret = lsm303_mf_unpack(dev, s);
+    if (ret != HAL_OK) return ret;
+    lsm303_instr_deliver(dev, LSM303_MF, 1U, t1);
+    lsm303_mf_tstep(dev);
+    return HAL_OK;
+}
+
+// Push sample to ring buffer (single producer: I2C interrupt)
+static void lsm303_ring_push(lsm303_ring_t* ring, const lsm303_raw_t* smpl)
+{
+    const uint16_t head = ring->head;
+    if ((uint16_t)(head - ring->tail) >= LSM303_RING_SIZE) {
+        ring->lost++;
+        return;
+    }
+    ring->buf[head & (LSM303_RING_SIZE - 1U)] = *smpl;
+    __DMB();
+    ring->head = head + 1U;
+}
+
+// Pop sample from ring buffer (single consumer: application)
+static uint8_t lsm303_ring_pop(lsm303_ring_t* ring, lsm303_raw_t* smpl)
+{
+    const uint16_t tail = ring->tail;
+    if (tail == ring->head) return HAL_BUSY;
+    __DMB();
+    *smpl = ring->buf[tail & (LSM303_RING_SIZE - 1U)];
+    __DMB();
+    ring->tail = tail + 1U;
+    return HAL_OK;
+}
+
+// Lock asynchronous transfer state: started transfer has one owner, blocking transfer of bus port or asynchronous one
+static uint8_t lsm303_async_lock(lsm303_dev_t *dev)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (dev->async.busy != 0U || dev->xfer.wait != 0U) {
+        __set_PRIMASK(primask);
         return HAL_BUSY;
     }
-    // Read data
-    ret = HAL_I2C_Mem_Read(i2c, LSM303_MF_SAD, LSM303_OUT_X_H_M, I2C_MEMADD_SIZE_8BIT, &lsm303_buf[0], sizeof(lsm303_buf), HAL_MAX_DELAY);
+    dev->async.busy = 1U;
+    __set_PRIMASK(primask);
+    return HAL_OK;
+}
+
+// Start asynchronous transfer of locked state
+static uint8_t lsm303_async_xfer(lsm303_dev_t *dev, const lsm303_async_t mode, const uint16_t sad, const uint16_t reg, uint8_t *buf, const uint16_t size)
+{
+    dev->async.start = lsm303_instr_start(dev);
+    const uint8_t ret = mode == LSM303_ASYNC_DMA
+        ? HAL_I2C_Mem_Read_DMA(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, buf, size)
+        : HAL_I2C_Mem_Read_IT(dev->i2c, sad, reg, I2C_MEMADD_SIZE_8BIT, buf, size);
     if (ret != HAL_OK) {
-        xWarning("OUT_X_H_M Read Error!\n");
-        return ret;
+        dev->async.dst = 0;
+        dev->async.busy = 0U;
+    }
+    return ret;
+}
+
+// Start asynchronous transfer. Transfer without callback pushes sample to ring buffer
+static uint8_t lsm303_async_start(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const lsm303_async_t mode, lsm303_cb_t cb)
+{
+    if (lsm303_async_lock(dev) != HAL_OK) return HAL_BUSY;
+    dev->async.sensor = sensor;
+    dev->async.cb = cb;
+    dev->async.dst = 0;
+    const uint16_t sad = sensor == LSM303_LA ? LSM303_LA_SAD : LSM303_MF_SAD;
+    const uint16_t reg = sensor == LSM303_LA ? LSM303_STATUS_REG_A | 0b10000000 : LSM303_OUT_X_H_M;
+    return lsm303_async_xfer(dev, mode, sad, reg, &dev->async.buf[0], sizeof(dev->async.buf));
+}
+
+// Start asynchronous transfer into caller samples: one sample with status or n FIFO samples
+static uint8_t lsm303_async_sample(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const lsm303_async_t mode, lsm303_sample_t *s, const uint8_t n, const uint8_t src, lsm303_sample_cb_t cb)
+{
+    if (lsm303_async_lock(dev) != HAL_OK) return HAL_BUSY;
+    dev->async.sensor = sensor;
+    dev->async.cb = 0;
+    dev->async.dst = s;
+    dev->async.n = n;
+    dev->async.src = src;
+    dev->async.scb = cb;
+    if (n > 0U) return lsm303_async_xfer(dev, mode, LSM303_LA_SAD, LSM303_OUT_X_L_A | 0b10000000, (uint8_t*)s + lsm303_fifo_offset(n), n * 6U);
+    const uint16_t sad = sensor == LSM303_LA ? LSM303_LA_SAD : LSM303_MF_SAD;
+    const uint16_t reg = sensor == LSM303_LA ? LSM303_STATUS_REG_A | 0b10000000 : LSM303_OUT_X_H_M;
+    return lsm303_async_xfer(dev, mode, sad, reg, (uint8_t*)s, 7U);
+}
+
+// Start read of the pending data ready sensor
+static void lsm303_drdy_next(lsm303_dev_t *dev)
+{
+    const uint8_t pending = dev->drdy.pending;
+    if (pending == 0U) return;
+    const lsm303_sensor_t sensor = (pending & (1U << LSM303_LA)) ? LSM303_LA : LSM303_MF;
+    if (lsm303_async_start(dev, sensor, dev->drdy.mode, 0) == HAL_OK) {
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        dev->drdy.pending &= ~(1U << sensor);
+        __set_PRIMASK(primask);
+    }
+}
+
+// Completion of blocking transfer of bus port, the owner of started transfer
+static void lsm303_xfer_done(lsm303_dev_t *dev, const uint8_t status)
+{
+    dev->xfer.status = status;
+    dev->xfer.wait = 0U;
+    dev->port->signal(dev->port->ctx);
+    // Data ready edges deferred by blocking transfer
+    lsm303_drdy_next(dev);
+}
+
+uint8_t lsm303_la_async(lsm303_dev_t *dev, const lsm303_async_t mode, lsm303_cb_t cb)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == cb) return HAL_ERROR;
+    return lsm303_async_start(dev, LSM303_LA, mode, cb);
+}
+
+uint8_t lsm303_mf_async(lsm303_dev_t *dev, const lsm303_async_t mode, lsm303_cb_t cb)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == cb) return HAL_ERROR;
+    return lsm303_async_start(dev, LSM303_MF, mode, cb);
+}
+
+uint8_t lsm303_la_async_sample(lsm303_dev_t *dev, const lsm303_async_t mode, lsm303_sample_t *s, lsm303_sample_cb_t cb)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == s) return HAL_ERROR;
+    return lsm303_async_sample(dev, LSM303_LA, mode, s, 0U, 0U, cb);
+}
+
+uint8_t lsm303_mf_async_sample(lsm303_dev_t *dev, const lsm303_async_t mode, lsm303_sample_t *s, lsm303_sample_cb_t cb)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == s) return HAL_ERROR;
+    return lsm303_async_sample(dev, LSM303_MF, mode, s, 0U, 0U, cb);
+}
+
+uint8_t lsm303_la_fifo_async(lsm303_dev_t *dev, const lsm303_async_t mode, lsm303_sample_t *s, const uint8_t n, const uint8_t src, lsm303_sample_cb_t cb)
+{
+    if (0 == dev || 0 == dev->i2c || 0 == s || n == 0U || n > LSM303_FIFO_SIZE) return HAL_ERROR;
+    return lsm303_async_sample(dev, LSM303_LA, mode, s, n, src, cb);
+}
+
+uint8_t lsm303_async_busy(lsm303_dev_t *dev)
+{
+    return dev->async.busy;
+}
+
+// Completion of transfer into caller samples: conversion in place
+static void lsm303_rx_sample(lsm303_dev_t *dev)
+{
+    const lsm303_sensor_t sensor = dev->async.sensor;
+    const lsm303_sample_cb_t cb = dev->async.scb;
+    lsm303_sample_t* s = dev->async.dst;
+    const uint8_t n = dev->async.n;
+    uint8_t ret = HAL_OK;
+    const uint32_t t1 = lsm303_instr_bus(dev, sensor, dev->async.start);
+    if (n > 0U) {
+        lsm303_la_fifo_ovrn(dev, dev->async.src);
+        lsm303_la_unpack_fifo(dev, s, n, dev->async.src);
+    }
+    else ret = sensor == LSM303_LA ? lsm303_la_unpack(dev, s) : lsm303_mf_unpack(dev, s);
+    if (ret == HAL_OK) lsm303_instr_deliver(dev, sensor, n > 0U ? n : 1U, t1);
+    // Unlock before callback: next transfer can be started from callback
+    dev->async.dst = 0;
+    dev->async.busy = 0U;
+    if (cb != 0) cb(dev, sensor, ret, s);
+    lsm303_drdy_next(dev);
+}
+
+void lsm303_rx_cplt(lsm303_dev_t *dev, I2C_HandleTypeDef *i2c)
+{
+    if (0 == dev || dev->i2c != i2c) return;
+    // Completion of the owner of started transfer
+    if (dev->xfer.wait != 0U) {
+        lsm303_xfer_done(dev, HAL_OK);
+        return;
+    }
+    if (dev->async.busy == 0U) return;
+    if (dev->async.dst != 0) {
+        lsm303_rx_sample(dev);
+        return;
+    }
+    const lsm303_sensor_t sensor = dev->async.sensor;
+    const lsm303_cb_t cb = dev->async.cb;
+    int16_t r[3] = { 0 };
+    uint8_t sr = 0U;
+    uint8_t ret = HAL_OK;
+    const uint32_t t1 = lsm303_instr_bus(dev, sensor, dev->async.start);
+    if (sensor == LSM303_LA) {
+        const lsm303_reg_status_a_t status = { .reg = dev->async.buf[0] };
+        lsm303_la_conv(&dev->async.buf[1], LSM303_ASHIFT(dev), &r[0], &r[1], &r[2]);
+        sr = status.reg;
+        ret = status.zyxda == 0U ? HAL_BUSY : HAL_OK;
+        if (status.zyxovr != 0U) {
+            dev->stats.overrun++;
+            dev->instr[LSM303_LA].overrun++;
+        }
+    }
+    else {
+        const lsm303_reg_sr_m_t status = { .reg = dev->async.buf[6] };
+        lsm303_mf_conv(&dev->async.buf[0], &r[0], &r[1], &r[2]);
+        sr = status.reg;
+        ret = status.drdy == 0U ? HAL_BUSY : HAL_OK;
+    }
+    if (ret == HAL_BUSY) {
+        dev->stats.notready++;
+        dev->instr[sensor].notready++;
+    }
+    // Data ready mode: interval of data ready edges
+    else lsm303_instr_deliver(dev, sensor, 1U, cb == 0 ? dev->drdy.tick[sensor] : t1);
+    // Data ready mode: timestamped raw sample to ring buffer
+    if (cb == 0) {
+        const lsm303_raw_t smpl = { .tick = dev->drdy.tick[sensor], .x = r[0], .y = r[1], .z = r[2], .sr = sr };
+        lsm303_ring_push(&dev->drdy.ring[sensor], &smpl);
+        dev->async.busy = 0U;
+        lsm303_drdy_next(dev);
+        return;
     }
     // Conversion
-    *x = (float)((int16_t)(lsm303_buf[0] << 8 | lsm303_buf[1])) / lsm303_mlsb_xy * 100.0F;
-    *y = (float)((int16_t)(lsm303_buf[4] << 8 | lsm303_buf[5])) / lsm303_mlsb_xy * 100.0F;
-    *z = (float)((int16_t)(lsm303_buf[2] << 8 | lsm303_buf[3])) / lsm303_mlsb_z * 100.0F;
-    return HAL_OK;
+    float d[3] = { 0 };
+    if (sensor == LSM303_LA) {
+        d[0] = (float)r[0] * LSM303_ALSB(dev);
+        d[1] = (float)r[1] * LSM303_ALSB(dev);
+        d[2] = (float)r[2] * LSM303_ALSB(dev);
+    }
+    else {
+        const float f[3] = { (float)r[0], (float)r[1], (float)r[2] };
+        lsm303_mf_apply(dev, f, d);
+    }
+    // Unlock before callback: next transfer can be started from callback
+    dev->async.busy = 0U;
+    cb(dev, sensor, ret, d[0], d[1], d[2]);
+    lsm303_drdy_next(dev);
+}
+
+void lsm303_tx_cplt(lsm303_dev_t *dev, I2C_HandleTypeDef *i2c)
+{
+    if (0 == dev || dev->i2c != i2c) return;
+    if (dev->xfer.wait != 0U) lsm303_xfer_done(dev, HAL_OK);
+}
+
+void lsm303_rx_error(lsm303_dev_t *dev, I2C_HandleTypeDef *i2c)
+{
+    if (0 == dev || dev->i2c != i2c) return;
+    // Completion of the owner of started transfer
+    if (dev->xfer.wait != 0U) {
+        lsm303_xfer_done(dev, HAL_ERROR);
+        return;
+    }
+    if (dev->async.busy == 0U) return;
+    const lsm303_sensor_t sensor = dev->async.sensor;
+    const lsm303_cb_t cb = dev->async.cb;
+    lsm303_sample_t* s = dev->async.dst;
+    const lsm303_sample_cb_t scb = dev->async.scb;
+    dev->async.dst = 0;
+    dev->async.busy = 0U;
+    dev->stats.error++;
+    if (s != 0) {
+        if (scb != 0) scb(dev, sensor, HAL_ERROR, s);
+    }
+    else if (cb == 0) dev->drdy.ring[sensor].lost++;
+    else cb(dev, sensor, HAL_ERROR, 0.0F, 0.0F, 0.0F);
+    lsm303_drdy_next(dev);
+}
+
+uint8_t lsm303_la_drdy(lsm303_dev_t *dev, const uint8_t en)
+{
+    if (0 == dev || 0 == dev->i2c) return HAL_ERROR;
+    lsm303_reg_ctrl_a3_t r = { 0 };
+    const lsm303_reg_ctrl_a3_t mask = { .drdy1 = 1U };
+    r.drdy1 = en == 0U ? 0U : 1U;
+    lsm303_set(dev, LSM303_LA, LSM303_CTRL_REG3_A, mask.reg, r.reg);
+    return lsm303_flush(dev, LSM303_LA);
+}
+
+void lsm303_drdy_irq(lsm303_dev_t *dev, const lsm303_sensor_t sensor, const lsm303_async_t mode)
+{
+    if (0 == dev || 0 == dev->i2c) return;
+    dev->drdy.mode = mode;
+    dev->drdy.tick[sensor] = lsm303_now(dev);
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    dev->drdy.pending |= 1U << sensor;
+    __set_PRIMASK(primask);
+    if (dev->async.busy == 0U) lsm303_drdy_next(dev);
+}
+
+uint8_t lsm303_pop(lsm303_dev_t *dev, const lsm303_sensor_t sensor, lsm303_raw_t *smpl)
+{
+    if (0 == dev || 0 == smpl) return HAL_ERROR;
+    // Retry the read has been deferred by busy bus
+    if (dev->drdy.pending != 0U && dev->async.busy == 0U) lsm303_drdy_next(dev);
+    return lsm303_ring_pop(&dev->drdy.ring[sensor], smpl);
+}
+
+uint32_t lsm303_lost(lsm303_dev_t *dev, const lsm303_sensor_t sensor)
+{
+    return dev->drdy.ring[sensor].lost;
 }
 
 // float motionLP(float x, float y, float z, const float alpha, const float delta, const uint8_t sample)
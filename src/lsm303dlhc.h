@@ -7,6 +7,7 @@
 #define __LSM303_H__
 
 #include "stm32l4xx_hal.h"
+#include "lsm303static.h"
 
 /// \defgroup lsm303data 1. LSM303 Parameters
 /// \brief LSM303 Enumerators, variables, structures
@@ -14,24 +15,6 @@
 /// \defgroup lsm303func 2. LSM303 Functions
 /// \brief LSM303 Setup and read sensor functions
 
-/// \brief Linear accelerometer sensitivity \a mg/LSB
-/// \details This variable is initialized in the function \b lsm303_la_setup
-/// \details Depends on the parameters: full-scale selection, enable/disable low-power mode, enable/disable high-resolution output mode
-/// \ingroup lsm303data
-extern float lsm303_alsb;
-
-/// \brief Magnetic field LSB/Gauss for \c X, \c Y axis \a LSB/Gauss
-/// \details This variable is initialized in the function \b lsm303_mf_setup
-/// \details Depends on the gain setting
-/// \ingroup lsm303data
-extern float lsm303_mlsb_xy;
-
-/// \brief Magnetic field LSB/Gauss for \c Z axis \a LSB/Gauss
-/// \details This variable is initialized in the function \b lsm303_mf_setup
-/// \details Depends on the gain setting
-/// \ingroup lsm303data
-extern float lsm303_mlsb_z;
-
 /// \brief Linear accelerometer data rate
 /// \details \c CTRL_REG1_A register field
 /// \ingroup lsm303data
@@ -78,6 +61,27 @@ typedef enum {
     LSM303_AAND_6D  = 0b11  ///< 6-direction position recognition (when the orientation is inside a known zone)
 } lsm303_la_irq_mode_t;
 
+/// \brief Linear accelerometer interrupt pad
+/// \ingroup lsm303data
+typedef enum {
+    LSM303_APAD_INT1 = 0, ///< \c INT1 pad
+    LSM303_APAD_INT2 = 1  ///< \c INT2 pad
+} lsm303_la_pad_t;
+
+/// \brief Linear accelerometer FIFO mode
+/// \details \c FIFO_CTRL_REG_A register field
+/// \ingroup lsm303data
+typedef enum {
+    LSM303_AFIFO_BYPASS    = 0b00, ///< Bypass mode (FIFO disabled)
+    LSM303_AFIFO_FIFO      = 0b01, ///< FIFO mode: collect samples and stop when FIFO is full
+    LSM303_AFIFO_STREAM    = 0b10, ///< Stream mode: the oldest sample is overwritten when FIFO is full
+    LSM303_AFIFO_TRIGGER   = 0b11  ///< Stream-to-FIFO mode: stream mode until interrupt event, then FIFO mode
+} lsm303_la_fifo_t;
+
+/// \brief Linear accelerometer FIFO depth (samples)
+/// \ingroup lsm303data
+#define LSM303_FIFO_SIZE 32U
+
 /// \brief Magnetic field data rate
 /// \details \c CRA_REG_M register field
 /// \ingroup lsm303data
@@ -115,6 +119,274 @@ typedef enum {
     LSM303_MMODE_SLEEP1        = 0b11  ///< Sleep mode. Device is placed in sleep mode
 } lsm303_mf_md_t;
 
+/// \brief Sensor selection
+/// \ingroup lsm303data
+typedef enum {
+    LSM303_LA = 0,  ///< Linear accelerometer
+    LSM303_MF = 1   ///< Magnetic field sensor
+} lsm303_sensor_t;
+
+/// \brief Asynchronous transfer mode
+/// \ingroup lsm303data
+typedef enum {
+    LSM303_ASYNC_IT    = 0, ///< Interrupt mode: \c HAL_I2C_Mem_Read_IT
+    LSM303_ASYNC_DMA   = 1  ///< DMA mode: \c HAL_I2C_Mem_Read_DMA
+} lsm303_async_t;
+
+/// \brief LSM303 device handler
+/// \ingroup lsm303data
+typedef struct lsm303_dev lsm303_dev_t;
+
+/// \brief Asynchronous read completion callback
+/// \details Called from I2C interrupt context with converted data: \b g for accelerometer, \b nanotesla for magnetometer
+/// \param dev Device handler
+/// \param sensor Sensor of completed transfer
+/// \param status \c HAL_OK if success, \c HAL_BUSY if data was not ready (axis data is previous sample) or error code (axis data is invalid)
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \ingroup lsm303data
+typedef void (*lsm303_cb_t)(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const uint8_t status, const float x, const float y, const float z);
+
+/// \brief Converted sample
+/// \details Sample functions receive raw registers into the struct memory and convert them in place:
+/// \b g for accelerometer, \b nanotesla for magnetometer
+/// \ingroup lsm303data
+typedef struct {
+    float x;        ///< X axis
+    float y;        ///< Y axis
+    float z;        ///< Z axis
+    uint8_t sr;     ///< Status register: \c STATUS_REG_A, \c SR_REG_M or \c FIFO_SRC_REG_A for FIFO samples
+} lsm303_sample_t;
+
+/// \brief Asynchronous sample read completion callback
+/// \details Called from I2C interrupt context
+/// \param dev Device handler
+/// \param sensor Sensor of completed transfer
+/// \param status \c HAL_OK if success, \c HAL_BUSY if data was not ready (axis data is previous sample) or error code (samples are invalid)
+/// \param s Samples passed to start function
+/// \ingroup lsm303data
+typedef void (*lsm303_sample_cb_t)(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const uint8_t status, lsm303_sample_t* s);
+
+/// \brief Bus port: shared bus arbitration and transfer completion wait
+/// \details With a port blocking transfers lock the bus, start interrupt transfer and wait for completion
+/// signaled by \b lsm303_rx_cplt, \b lsm303_tx_cplt or \b lsm303_rx_error instead of polling. Active asynchronous
+/// transfer makes blocking transfer return \c HAL_BUSY, data ready edges are deferred till blocking transfer completion. Set by \b lsm303_port,
+/// FreeRTOS port is \b lsm303_rtos_init
+/// \ingroup lsm303data
+typedef struct {
+    void* ctx;                                          ///< Port context
+    uint8_t (*lock)(void* ctx);                         ///< Lock bus: \c HAL_OK or \c HAL_TIMEOUT
+    void (*unlock)(void* ctx);                          ///< Unlock bus
+    uint8_t (*wait)(void* ctx, const uint32_t timeout); ///< Wait for transfer completion, ms: \c HAL_OK or \c HAL_TIMEOUT
+    void (*signal)(void* ctx);                          ///< Signal transfer completion, interrupt context
+    void (*delay)(void* ctx, const uint32_t ms);        ///< Retry backoff delay releasing CPU
+} lsm303_port_t;
+
+/// \brief Timestamp clock
+/// \details Free-running counter, e.g. 32-bit timer \c CNT register. \c HAL_GetTick by default
+/// \ingroup lsm303data
+typedef uint32_t (*lsm303_clock_t)(void);
+
+/// \brief Magnetometer hard-iron and soft-iron calibration
+/// \details Calibrated field: \c m = S * (m_raw - b), where \c m_raw is uncalibrated field in the same units as \b lsm303_mf_read
+/// \ingroup lsm303data
+typedef struct {
+    float b[3];     ///< Hard-iron offset
+    float S[3][3];  ///< Soft-iron correction matrix
+} lsm303_mcal_t;
+
+/// \brief Magnetometer temperature compensation
+/// \details Offset drift table of calibrated field: \c m = S * (m_raw - b) - off(T). Entry \c i is offset at temperature
+/// <tt>t0 + i * step</tt>, linear interpolation between entries, clamped at the ends. Temperature is the reading of
+/// the on-chip sensor (8 LSB/°C, relative: measure the table with the same sensor). Set by \b lsm303_mf_tcomp
+/// \ingroup lsm303data
+typedef struct {
+    const float (*off)[3];  ///< Offset table, units of \b lsm303_mf_read, or \c 0 - no compensation
+    uint8_t n;              ///< Table entries
+    float t0;               ///< Temperature of the first entry, °C
+    float step;             ///< Temperature step of entries, °C
+    uint16_t every;         ///< Temperature read every \c every blocking magnetometer reads, \c 0 - by \b lsm303_mf_temp only
+    uint16_t cnt;           ///< Blocking magnetometer reads since the last temperature read
+    float t;                ///< Last temperature, °C
+    float cur[3];           ///< Offset at the last temperature
+} lsm303_mtcomp_t;
+
+/// \brief Default timeout of blocking transfer, ms
+/// \details Time beyond the transfer itself, extended by \c LSM303_TIMEOUT_RATE for size of transfer.
+/// Define it in build flags to override. Set at runtime by \b lsm303_timeout
+/// \ingroup lsm303data
+#ifndef LSM303_TIMEOUT
+# define LSM303_TIMEOUT 5U
+#endif
+
+/// \brief Transfer time budget of blocking transfer, bytes per ms
+/// \details HAL timeout bounds the whole transfer: timeout of \c size bytes is extended by <tt>size / LSM303_TIMEOUT_RATE</tt>
+/// ms, rounded up. Default \c 10 fits 100 kHz bus (about 11 bytes per ms), 192-byte FIFO drain gets \c 20 ms more.
+/// Define it in build flags to override
+/// \ingroup lsm303data
+#ifndef LSM303_TIMEOUT_RATE
+# define LSM303_TIMEOUT_RATE 10U
+#endif
+
+/// \brief Default retries of failed blocking transfer
+/// \details Define it in build flags to override. Set at runtime by \b lsm303_timeout
+/// \ingroup lsm303data
+#ifndef LSM303_RETRIES
+# define LSM303_RETRIES 2U
+#endif
+
+/// \brief Half period of \c SCL clock-out of bus recovery, busy loop iterations
+/// \details About 5 us at 80 MHz. Define it in build flags to override
+/// \ingroup lsm303data
+#ifndef LSM303_RECOVER_DELAY
+# define LSM303_RECOVER_DELAY 40U
+#endif
+
+/// \brief Bus health counters
+/// \ingroup lsm303data
+typedef struct {
+    uint32_t nack;      ///< Transfers not acknowledged by the sensor
+    uint32_t timeout;   ///< Transfer timeouts
+    uint32_t busy;      ///< Transfers refused by busy I2C peripheral
+    uint32_t error;     ///< Other transfer errors: bus error, arbitration lost, asynchronous transfer error
+    uint32_t retry;     ///< Retried transfers
+    uint32_t recover;   ///< Bus recoveries
+    uint32_t notready;  ///< Reads without new data (\c HAL_BUSY of read functions)
+    uint32_t overrun;   ///< Data overruns: \c ZYXOR bit of \c STATUS_REG_A or FIFO overrun
+} lsm303_stats_t;
+
+/// \brief Sample instrumentation enable: \c 1 - enabled, \c 0 - hooks are compiled out
+/// \details Define it in build flags to override. Costs two clock reads and a few counters per delivered sample
+/// \ingroup lsm303data
+#ifndef LSM303_INSTR
+# define LSM303_INSTR 1
+#endif
+
+/// \brief Bins of inter-sample interval histogram
+/// \details Define it in build flags to override
+/// \ingroup lsm303data
+#ifndef LSM303_INSTR_BINS
+# define LSM303_INSTR_BINS 8U
+#endif
+
+/// \brief Sample instrumentation of sensor
+/// \details Times are lsm303_dev_t::clock ticks: set microsecond clock by \b lsm303_clock for I2C time.
+/// Interval histogram counts intervals between single-sample deliveries rounded to quarters of expected period
+/// (\b lsm303_instr_period): bin \c 4 is on time (within 1/8 period), the last bin collects missed samples.
+/// FIFO blocks count samples and I2C time only. Magnetometer has no overrun flag: missed samples show as long intervals
+/// \ingroup lsm303data
+typedef struct {
+    uint32_t samples;                   ///< Delivered samples
+    uint32_t overrun;                   ///< Overruns: \c ZYXOR bit of \c STATUS_REG_A or FIFO overrun
+    uint32_t notready;                  ///< Reads without new data
+    uint32_t period;                    ///< Expected interval, ticks (\c 0 - no histogram)
+    uint32_t intervals;                 ///< Measured intervals
+    uint32_t imin;                      ///< Minimum interval
+    uint32_t imax;                      ///< Maximum interval
+    uint32_t hist[LSM303_INSTR_BINS];   ///< Interval histogram
+    uint32_t reads;                     ///< I2C data reads
+    uint32_t bus_max;                   ///< Maximum I2C time of read
+    uint64_t bus;                       ///< Total I2C time of reads
+    uint32_t lat_n;                     ///< Latency measurements
+    uint32_t lat_max;                   ///< Maximum latency
+    uint64_t lat;                       ///< Total latency from data ready edge to detector output
+    uint32_t last;                      ///< Tick of the last single-sample delivery
+    uint8_t valid;                      ///< \c last is valid
+} lsm303_instr_t;
+
+/// \brief Ring buffer size (samples) of data ready sampling
+/// \details Must be a power of two. Define it in build flags to override
+/// \ingroup lsm303data
+#ifndef LSM303_RING_SIZE
+# define LSM303_RING_SIZE 32U
+#endif
+
+/// \brief Timestamped raw sample
+/// \ingroup lsm303data
+typedef struct {
+    uint32_t tick;  ///< Timestamp of data ready edge (lsm303_dev_t::clock)
+    int16_t x;      ///< X axis raw data
+    int16_t y;      ///< Y axis raw data
+    int16_t z;      ///< Z axis raw data
+    uint8_t sr;     ///< Status register: \c STATUS_REG_A (see lsm303_reg_status_a_t) or \c SR_REG_M (see lsm303_reg_sr_m_t)
+} lsm303_raw_t;
+
+/// \brief Single-producer / single-consumer ring buffer of raw samples
+/// \details Producer is I2C interrupt, consumer is application
+/// \ingroup lsm303data
+typedef struct {
+    lsm303_raw_t buf[LSM303_RING_SIZE]; ///< Samples
+    volatile uint16_t head;             ///< Write counter
+    volatile uint16_t tail;             ///< Read counter
+    volatile uint32_t lost;             ///< Lost samples (buffer overflow or transfer error)
+} lsm303_ring_t;
+
+#define LSM303_LA_REGS 30U  ///< Accelerometer shadow registers: \c CTRL_REG1_A .. \c TIME_WINDOW_A
+#define LSM303_MF_REGS 3U   ///< Magnetometer shadow registers: \c CRA_REG_M .. \c MR_REG_M
+
+/// \struct lsm303_dev lsm303dlhc.h
+/// \brief LSM303 device context
+/// \details Holds the bus handler, conversion factors and own transfer buffers. Initialize it by \b lsm303_init
+/// \ingroup lsm303data
+struct lsm303_dev {
+    I2C_HandleTypeDef* i2c;             ///< I2C handler
+    float alsb;                         ///< Linear accelerometer sensitivity \a g/LSB. Initialized in the function \b lsm303_la_setup
+    uint8_t ashift;                     ///< Linear accelerometer data bit shift. Initialized in the function \b lsm303_la_setup
+    float mlsb_xy;                      ///< Magnetic field LSB/Gauss for \c X, \c Y axis. Initialized in the function \b lsm303_mf_setup
+    float mlsb_z;                       ///< Magnetic field LSB/Gauss for \c Z axis. Initialized in the function \b lsm303_mf_setup
+    uint8_t buf[7];                     ///< Buffer of blocking read: status and data
+    lsm303_mcal_t mcal;                 ///< Magnetometer calibration. Identity by \b lsm303_init, set by \b lsm303_mf_calib
+    float mW[3][3];                     ///< Magnetometer affine transform of raw data: scale and soft-iron matrix
+    float mc[3];                        ///< Magnetometer affine transform of raw data: offset
+    lsm303_mtcomp_t mtc;                ///< Magnetometer temperature compensation, folded into lsm303_dev_t::mc
+    lsm303_clock_t clock;               ///< Timestamp clock. Initialized in the function \b lsm303_init, set by \b lsm303_clock
+    uint32_t timeout;                   ///< Timeout of blocking transfer beyond transfer time budget (\c LSM303_TIMEOUT_RATE), ms. \c LSM303_TIMEOUT by \b lsm303_init, set by \b lsm303_timeout
+    uint8_t retries;                    ///< Retries of failed blocking transfer. \c LSM303_RETRIES by \b lsm303_init, set by \b lsm303_timeout
+    /// \brief I2C pins for bus recovery, set by \b lsm303_bus
+    struct {
+        GPIO_TypeDef* scl_port;         ///< \c SCL port or \c 0 - re-init of I2C peripheral only
+        uint16_t scl_pin;               ///< \c SCL pin
+        GPIO_TypeDef* sda_port;         ///< \c SDA port
+        uint16_t sda_pin;               ///< \c SDA pin
+    } bus;
+    lsm303_stats_t stats;               ///< Bus health counters
+    lsm303_instr_t instr[2];            ///< Sample instrumentation of sensors
+    const lsm303_port_t* port;          ///< Bus port or \c 0 - polling transfers. Set by \b lsm303_port
+    /// \brief Blocking transfer of bus port
+    struct {
+        volatile uint8_t wait;          ///< Transfer waits for completion: owner of started transfer, exclusive with lsm303_dev_t::async
+        volatile uint8_t status;        ///< Transfer status
+    } xfer;
+    /// \brief Shadow copy of writable registers
+    /// \details Configuration functions update the copy and write only dirty registers by auto-increment bursts
+    struct {
+        uint8_t la[LSM303_LA_REGS];     ///< Accelerometer registers from \c CTRL_REG1_A
+        uint8_t mf[LSM303_MF_REGS];     ///< Magnetometer registers from \c CRA_REG_M
+        uint32_t la_dirty;              ///< Bit mask of accelerometer registers to write
+        uint8_t mf_dirty;               ///< Bit mask of magnetometer registers to write
+    } shadow;
+    /// \brief Asynchronous transfer state
+    struct {
+        volatile uint8_t busy;          ///< Transfer is active
+        lsm303_sensor_t sensor;         ///< Sensor of active transfer
+        lsm303_cb_t cb;                 ///< Completion callback (\c 0 - data ready sampling)
+        uint8_t buf[7];                 ///< Transfer buffer: status and data
+        lsm303_sample_t* dst;           ///< Caller samples receiving the transfer (\c 0 - transfer buffer)
+        uint8_t n;                      ///< FIFO samples of transfer to \c dst (\c 0 - one sample with status)
+        uint8_t src;                    ///< \c FIFO_SRC_REG_A of FIFO transfer
+        lsm303_sample_cb_t scb;         ///< Completion callback of transfer to \c dst
+        uint32_t start;                 ///< Transfer start tick
+    } async;
+    /// \brief Data ready sampling state
+    struct {
+        lsm303_async_t mode;            ///< Transfer mode
+        volatile uint8_t pending;       ///< Bit mask of sensors with data ready but not read yet
+        volatile uint32_t tick[2];      ///< Data ready timestamp of sensors
+        lsm303_ring_t ring[2];          ///< Samples of sensors
+    } drdy;
+};
+
 /// \union lsm303_reg_int_cfg_a_t lsm303dlhc.h
 /// \brief Interrup configuration
 /// \details Using for configuration \c INT1_CFG_A or \c INT2_CFG_A register
@@ -166,81 +438,706 @@ typedef union {
     uint8_t reg; ///< Register byte
 } lsm303_reg_int_src_a_t;
 
-/// \brief Linear accelerometer setup
+/// \union lsm303_reg_click_cfg_a_t lsm303dlhc.h
+/// \brief Click configuration
+/// \details Using for configuration \c CLICK_CFG_A register
+/// \ingroup lsm303data
+typedef union {
+#ifdef DOXYGEN
+    /// \struct lsm303_reg_click_cfg_a_t::_unnamed lsm303dlhc.h
+    /// \brief Register \c CLICK_CFG_A fields
+    /// \details __attribute__((__packed__))
+    /// \ingroup lsm303data
+    struct _unnamed {
+#else
+    struct __attribute__((__packed__)) {
+#endif
+        uint8_t xs      : 1; ///< Enable interrupt single click on X axis (0: disable, 1: enable)
+        uint8_t xd      : 1; ///< Enable interrupt double click on X axis (0: disable, 1: enable)
+        uint8_t ys      : 1; ///< Enable interrupt single click on Y axis (0: disable, 1: enable)
+        uint8_t yd      : 1; ///< Enable interrupt double click on Y axis (0: disable, 1: enable)
+        uint8_t zs      : 1; ///< Enable interrupt single click on Z axis (0: disable, 1: enable)
+        uint8_t zd      : 1; ///< Enable interrupt double click on Z axis (0: disable, 1: enable)
+        uint8_t reserv  : 2; ///< Reserved bits
+    };
+    uint8_t reg; ///< Register byte
+} lsm303_reg_click_cfg_a_t;
+
+/// \union lsm303_reg_click_src_a_t lsm303dlhc.h
+/// \brief Click source register
+/// \details Read-only \c CLICK_SRC_A register
+/// \ingroup lsm303data
+typedef union {
+#ifdef DOXYGEN
+    /// \struct lsm303_reg_click_src_a_t::_unnamed lsm303dlhc.h
+    /// \brief Register \c CLICK_SRC_A fields
+    /// \details __attribute__((__packed__))
+    /// \ingroup lsm303data
+    struct _unnamed {
+#else
+    struct __attribute__((__packed__)) {
+#endif
+        uint8_t x       : 1; ///< X click detected (0: no interrupt, 1: X high event has occurred)
+        uint8_t y       : 1; ///< Y click detected (0: no interrupt, 1: Y high event has occurred)
+        uint8_t z       : 1; ///< Z click detected (0: no interrupt, 1: Z high event has occurred)
+        uint8_t sign    : 1; ///< Click sign (0: positive detection, 1: negative detection)
+        uint8_t sclick  : 1; ///< Single click detection enabled and detected
+        uint8_t dclick  : 1; ///< Double click detection enabled and detected
+        uint8_t ia      : 1; ///< Interrupt active. (0: no interrupt has been generated, 1: one or more interrupts have been generated)
+        uint8_t reserv  : 1; ///< Reserved bit
+    };
+    uint8_t reg; ///< Register byte
+} lsm303_reg_click_src_a_t;
+
+/// \union lsm303_reg_status_a_t lsm303dlhc.h
+/// \brief Accelerometer status register
+/// \details Read-only \c STATUS_REG_A register
+/// \ingroup lsm303data
+typedef union {
+#ifdef DOXYGEN
+    /// \struct lsm303_reg_status_a_t::_unnamed lsm303dlhc.h
+    /// \brief Register \c STATUS_REG_A fields
+    /// \details __attribute__((__packed__))
+    /// \ingroup lsm303data
+    struct _unnamed {
+#else
+    struct __attribute__((__packed__)) {
+#endif
+        uint8_t xda     : 1; ///< X-axis new data available (0: not available, 1: available)
+        uint8_t yda     : 1; ///< Y-axis new data available (0: not available, 1: available)
+        uint8_t zda     : 1; ///< Z-axis new data available (0: not available, 1: available)
+        uint8_t zyxda   : 1; ///< X, Y and Z-axis new data available (0: not available, 1: available)
+        uint8_t xovr    : 1; ///< X-axis data overrun (0: no overrun, 1: new data has overwritten the previous data)
+        uint8_t yovr    : 1; ///< Y-axis data overrun (0: no overrun, 1: new data has overwritten the previous data)
+        uint8_t zovr    : 1; ///< Z-axis data overrun (0: no overrun, 1: new data has overwritten the previous data)
+        uint8_t zyxovr  : 1; ///< X, Y and Z-axis data overrun (0: no overrun, 1: new data has overwritten the previous data)
+    };
+    uint8_t reg; ///< Register byte
+} lsm303_reg_status_a_t;
+
+/// \union lsm303_reg_sr_m_t lsm303dlhc.h
+/// \brief Magnetometer status register
+/// \details Read-only \c SR_REG_M register
+/// \ingroup lsm303data
+typedef union {
+#ifdef DOXYGEN
+    /// \struct lsm303_reg_sr_m_t::_unnamed lsm303dlhc.h
+    /// \brief Register \c SR_REG_M fields
+    /// \details __attribute__((__packed__))
+    /// \ingroup lsm303data
+    struct _unnamed {
+#else
+    struct __attribute__((__packed__)) {
+#endif
+        uint8_t drdy    : 1; ///< Data output register ready (0: not ready, 1: all six data registers have been written)
+        uint8_t lock    : 1; ///< Data output register lock (1: reading of data registers has been started)
+        uint8_t reserv  : 6; ///< Reserved bits
+    };
+    uint8_t reg; ///< Register byte
+} lsm303_reg_sr_m_t;
+
+/// \union lsm303_reg_fifo_src_a_t lsm303dlhc.h
+/// \brief FIFO source register
+/// \details Read-only \c FIFO_SRC_REG_A register
+/// \ingroup lsm303data
+typedef union {
+#ifdef DOXYGEN
+    /// \struct lsm303_reg_fifo_src_a_t::_unnamed lsm303dlhc.h
+    /// \brief Register \c FIFO_SRC_REG_A fields
+    /// \details __attribute__((__packed__))
+    /// \ingroup lsm303data
+    struct _unnamed {
+#else
+    struct __attribute__((__packed__)) {
+#endif
+        uint8_t fss     : 5; ///< Number of unread samples stored in FIFO
+        uint8_t empty   : 1; ///< FIFO is empty (0: FIFO contains samples, 1: FIFO is empty)
+        uint8_t ovrn    : 1; ///< FIFO overrun (0: FIFO is not completely filled, 1: FIFO is full)
+        uint8_t wtm     : 1; ///< Watermark (0: FIFO filling is lower than watermark level, 1: FIFO filling is equal or higher than watermark level)
+    };
+    uint8_t reg; ///< Register byte
+} lsm303_reg_fifo_src_a_t;
+
+/// \brief Device handler initialization
+/// \details Reset device context and bind it to I2C bus. The device needs the sensors setup after initialization
+/// \param dev Device handler
 /// \param i2c I2C handler
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_init(lsm303_dev_t* dev, I2C_HandleTypeDef* i2c);
+
+/// \brief Timestamp clock of data ready sampling
+/// \details Hardware timer gives sub-millisecond timestamps for high data rates
+/// \param dev Device handler
+/// \param clock Clock function, \c 0 - \c HAL_GetTick
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \ingroup lsm303func
+uint8_t lsm303_clock(lsm303_dev_t* dev, lsm303_clock_t clock);
+
+/// \brief Timeout and retries of blocking transfers
+/// \details Failed transfer is retried after backoff of \c 1, \c 2, \c 4 ... ms; timeout or bus error starts bus recovery.
+/// Timeout of \c size bytes transfer is <tt>timeout + size / LSM303_TIMEOUT_RATE</tt> ms, rounded up. Worst-case latency of
+/// one transfer is about <tt>(retries + 1) * (timeout + size / LSM303_TIMEOUT_RATE + 25) + 2^retries - 1</tt> ms:
+/// HAL waits up to 25 ms for busy bus before the transfer
+/// \details In interrupt context retries are immediate and bus recovery is skipped: tick doesn't advance in handler
+/// preempting SysTick and recovery would break transfer of preempted code. Transfer of bus port returns \c HAL_BUSY there.
+/// HAL timeout relies on tick too, so read sensors in thread context, e.g. by flag of interrupt handler
+/// \param dev Device handler
+/// \param timeout Timeout beyond transfer time budget, ms
+/// \param retries Retries
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \ingroup lsm303func
+uint8_t lsm303_timeout(lsm303_dev_t* dev, const uint32_t timeout, const uint8_t retries);
+
+/// \brief I2C pins for bus recovery
+/// \details Bus recovery without pins only re-initializes I2C peripheral
+/// \param dev Device handler
+/// \param scl_port \c SCL port
+/// \param scl_pin \c SCL pin
+/// \param sda_port \c SDA port
+/// \param sda_pin \c SDA pin
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \ingroup lsm303func
+uint8_t lsm303_bus(lsm303_dev_t* dev, GPIO_TypeDef* scl_port, const uint16_t scl_pin, GPIO_TypeDef* sda_port, const uint16_t sda_pin);
+
+/// \brief I2C bus recovery
+/// \details De-initialize I2C peripheral, clock out \c SCL up to 9 times until a sensor releases \c SDA, generate \c STOP
+/// and initialize I2C peripheral again. Called by failed blocking transfers. Bus is locked by bus port
+/// \param dev Device handler
+/// \return \c HAL_OK, \c HAL_BUSY if asynchronous transfer is active or bus is locked, or error code of \c HAL_I2C_Init
+/// \ingroup lsm303func
+uint8_t lsm303_recover(lsm303_dev_t* dev);
+
+/// \brief Bus port
+/// \details Blocking functions must be called from threads (tasks) only. Asynchronous and data ready functions don't lock the bus:
+/// use them without a port or on a bus not shared with other drivers
+/// \param dev Device handler. I2C interrupts must be configured
+/// \param port Port, valid while device is used, or \c 0 - polling transfers
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback, \b lsm303_tx_cplt from \c HAL_I2C_MemTxCpltCallback
+/// and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_port(lsm303_dev_t* dev, const lsm303_port_t* port);
+
+/// \brief Bus health counters
+/// \param dev Device handler
+/// \return Counters
+/// \ingroup lsm303func
+const lsm303_stats_t* lsm303_stats(const lsm303_dev_t* dev);
+
+/// \brief Sample instrumentation of sensor
+/// \details Encode it for telemetry link by \b lsm303_tlm_instr
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \return Counters
+/// \ingroup lsm303func
+const lsm303_instr_t* lsm303_instr(const lsm303_dev_t* dev, const lsm303_sensor_t sensor);
+
+/// \brief Sample instrumentation reset
+/// \details Clear counters, expected period is kept
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \ingroup lsm303func
+void lsm303_instr_reset(lsm303_dev_t* dev, const lsm303_sensor_t sensor);
+
+/// \brief Expected interval of samples for jitter histogram
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \param period Expected interval, lsm303_dev_t::clock ticks (e.g. \c 2500 us at 400 Hz), \c 0 - no histogram
+/// \ingroup lsm303func
+void lsm303_instr_period(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const uint32_t period);
+
+/// \brief End-to-end latency measurement
+/// \details Call at detector output with timestamp of processed sample
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \param tick Data ready edge tick of sample: lsm303_raw_t::tick
+/// \ingroup lsm303func
+void lsm303_instr_latency(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const uint32_t tick);
+
+/// \brief Linear accelerometer setup
+/// \param dev Device handler
+/// \param odr Data rate
+/// \param lpe Low-power mode: \c 0 - disable, \c 1 - enable
+/// \param hr High-resolution output mode: \c 0 - disable, \c 1 - enable
+/// \param fs Full-scale selection
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_setup(lsm303_dev_t* dev, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr, const lsm303_la_fs_t fs);
+
+/// \brief Linear accelerometer data rate and power mode
+/// \details Runtime reconfiguration by shadow registers: only changed registers are written, sensitivity is updated.
+/// Low-power and high-resolution modes are exclusive, high-resolution is selected if both are requested
+/// \param dev Device handler. Configured by \b lsm303_la_setup
 /// \param odr Data rate
 /// \param lpe Low-power mode: \c 0 - disable, \c 1 - enable
 /// \param hr High-resolution output mode: \c 0 - disable, \c 1 - enable
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_mode(lsm303_dev_t* dev, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr);
+
+/// \brief Linear accelerometer data rate
+/// \param dev Device handler. Configured by \b lsm303_la_setup
+/// \param odr Data rate
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_odr(lsm303_dev_t* dev, const lsm303_la_datarate_t odr);
+
+/// \brief Linear accelerometer full-scale
+/// \details Sensitivity lsm303_dev_t::alsb is updated
+/// \param dev Device handler. Configured by \b lsm303_la_setup
 /// \param fs Full-scale selection
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_la_setup(I2C_HandleTypeDef* i2c, const lsm303_la_datarate_t odr, const uint8_t lpe, const uint8_t hr, const lsm303_la_fs_t fs);
+uint8_t lsm303_la_fs(lsm303_dev_t* dev, const lsm303_la_fs_t fs);
+
+/// \brief Linear accelerometer low-power mode
+/// \details Enabling low-power mode disables high-resolution mode, disabling keeps it. Sensitivity and data bit shift are updated
+/// \param dev Device handler. Configured by \b lsm303_la_setup
+/// \param en Low-power mode: \c 0 - disable, \c 1 - enable
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_lp(lsm303_dev_t* dev, const uint8_t en);
+
+/// \brief Linear accelerometer high-resolution mode
+/// \details Enabling high-resolution mode disables low-power mode. Sensitivity and data bit shift are updated
+/// \param dev Device handler. Configured by \b lsm303_la_setup
+/// \param en High-resolution output mode: \c 0 - disable, \c 1 - enable
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_hr(lsm303_dev_t* dev, const uint8_t en);
 
 /// \brief Linear accelerometer interrupt by \c INT1
 /// \details Need connect \c INT1 to you stm32 pin and configure interrupt handler
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param cfg \c INT1_CFG_A register. Fill lsm303_reg_int_cfg_a_t fields and pass the lsm303_reg_int_cfg_a_t::reg field as a parameter
 /// \param threshould Interrupt trigger threshold
 /// \param duration Duration of the interrupt event
 /// \return \c HAL_OK if success or error code
 /// \note For deactivate this interrupt use \c cfg = \c 0U
 /// \ingroup lsm303func
-uint8_t lsm303_la_int1(I2C_HandleTypeDef* i2c, const uint8_t cfg, uint8_t threshould, uint8_t duration);
+uint8_t lsm303_la_int1(lsm303_dev_t* dev, const uint8_t cfg, uint8_t threshould, uint8_t duration);
 
 /// \brief Linear accelerometer read interrupt source by \c INT1
 /// \details Read \c INT1_SRC_A register
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param src \c INT1_SRC_A register pointer. Pass the &lsm303_reg_int_src_a_t::reg field as a parameter and read lsm303_reg_int_src_a_t fields
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_la_src1(I2C_HandleTypeDef* i2c, uint8_t* src);
+uint8_t lsm303_la_src1(lsm303_dev_t* dev, uint8_t* src);
 
 /// \brief Linear accelerometer read raw data \a without \a conversion
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param x X axis raw data pointer
 /// \param y Y axis raw data pointer
 /// \param z Z axis raw data pointer
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_la_raw(I2C_HandleTypeDef* i2c, int16_t* x, int16_t* y, int16_t* z);
+uint8_t lsm303_la_raw(lsm303_dev_t* dev, int16_t* x, int16_t* y, int16_t* z);
+
+/// \brief Linear accelerometer read raw data \a without \a conversion and status
+/// \details Read \c STATUS_REG_A and data registers by one auto-increment burst
+/// \param dev Device handler
+/// \param x X axis raw data pointer
+/// \param y Y axis raw data pointer
+/// \param z Z axis raw data pointer
+/// \param sr \c STATUS_REG_A pointer (overrun bits) or \c 0. Pass the &lsm303_reg_status_a_t::reg field as a parameter
+/// \return \c HAL_OK if success, \c HAL_BUSY if data unavailable or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_rawsr(lsm303_dev_t* dev, int16_t* x, int16_t* y, int16_t* z, uint8_t* sr);
+
+/// \brief Linear accelerometer read data and status
+/// \details Read \c STATUS_REG_A and data registers by one auto-increment burst and conversion data to \b g
+/// \param dev Device handler
+/// \param x X axis pointer
+/// \param y Y axis pointer
+/// \param z Z axis pointer
+/// \param sr \c STATUS_REG_A pointer (overrun bits) or \c 0. Pass the &lsm303_reg_status_a_t::reg field as a parameter
+/// \return \c HAL_OK if success, \c HAL_BUSY if data unavailable or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_readsr(lsm303_dev_t* dev, float* x, float* y, float* z, uint8_t* sr);
+
+/// \brief Linear accelerometer interrupt by \c INT2
+/// \details Interrupt generator 2 on \c INT2 pad. Need connect \c INT2 to you stm32 pin and configure interrupt handler
+/// \param dev Device handler
+/// \param cfg \c INT2_CFG_A register. Fill lsm303_reg_int_cfg_a_t fields and pass the lsm303_reg_int_cfg_a_t::reg field as a parameter
+/// \param threshould Interrupt trigger threshold, see \b lsm303_la_ths
+/// \param duration Duration of the interrupt event, see \b lsm303_la_ticks
+/// \return \c HAL_OK if success or error code
+/// \note For deactivate this interrupt use \c cfg = \c 0U
+/// \ingroup lsm303func
+uint8_t lsm303_la_int2(lsm303_dev_t* dev, const uint8_t cfg, uint8_t threshould, uint8_t duration);
+
+/// \brief Linear accelerometer read interrupt source by \c INT2
+/// \details Read \c INT2_SRC_A register
+/// \param dev Device handler
+/// \param src \c INT2_SRC_A register pointer. Pass the &lsm303_reg_int_src_a_t::reg field as a parameter and read lsm303_reg_int_src_a_t fields
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_src2(lsm303_dev_t* dev, uint8_t* src);
+
+/// \brief Linear accelerometer single / double click interrupt
+/// \param dev Device handler
+/// \param cfg \c CLICK_CFG_A register. Fill lsm303_reg_click_cfg_a_t fields and pass the lsm303_reg_click_cfg_a_t::reg field as a parameter
+/// \param threshould Click threshold, see \b lsm303_la_ths
+/// \param limit Maximum time of click above threshold, ODR periods (7 bits)
+/// \param latency Time after the first click before double click window, ODR periods
+/// \param window Window of the second click of double click, ODR periods
+/// \param pad Interrupt pad
+/// \return \c HAL_OK if success or error code
+/// \note For deactivate this interrupt use \c cfg = \c 0U
+/// \ingroup lsm303func
+uint8_t lsm303_la_click(lsm303_dev_t* dev, const uint8_t cfg, uint8_t threshould, uint8_t limit, uint8_t latency, uint8_t window, const lsm303_la_pad_t pad);
+
+/// \brief Linear accelerometer read click source
+/// \details Read \c CLICK_SRC_A register: reading clears the interrupt
+/// \param dev Device handler
+/// \param src \c CLICK_SRC_A register pointer. Pass the &lsm303_reg_click_src_a_t::reg field as a parameter and read lsm303_reg_click_src_a_t fields
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_click_src(lsm303_dev_t* dev, uint8_t* src);
+
+/// \brief Linear accelerometer interrupt and click threshold
+/// \details 1 LSB is 16 mg at ±2 g, 32 mg at ±4 g, 62 mg at ±8 g and 186 mg at ±16 g full-scale
+/// \param dev Device handler: full-scale of the last configuration
+/// \param g Threshold, \b g
+/// \return Threshold register value, up to \c 0x7F
+/// \ingroup lsm303func
+uint8_t lsm303_la_ths(const lsm303_dev_t* dev, const float g);
+
+/// \brief Linear accelerometer duration in ODR periods
+/// \param dev Device handler: data rate of the last configuration
+/// \param ms Duration, ms
+/// \return Data rate periods, up to \c 0xFF, or \c 0 in power-down mode
+/// \ingroup lsm303func
+uint8_t lsm303_la_ticks(const lsm303_dev_t* dev, const float ms);
+
+/// \brief Linear accelerometer free-fall interrupt
+/// \details AND combination of X, Y and Z low events: all axes are below threshold during duration.
+/// Interrupt generator 1 for \c INT1 pad (see \b lsm303_la_int1) or 2 for \c INT2 pad (see \b lsm303_la_int2).
+/// Typical threshold is 0.35 g and duration 30 ms (about 4 cm fall)
+/// \param dev Device handler: configure data rate and full-scale first
+/// \param pad Interrupt pad
+/// \param g Threshold, \b g
+/// \param ms Duration, ms
+/// \return \c HAL_OK if success, \c HAL_ERROR in power-down mode or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_freefall(lsm303_dev_t* dev, const lsm303_la_pad_t pad, const float g, const float ms);
 
 /// \brief Linear accelerometer read data
 /// \details Read Linear accelerometer data and conversion to \b g
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param x X axis pointer
 /// \param y Y axis pointer
 /// \param z Z axis pointer
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_la_read(I2C_HandleTypeDef* i2c, float* x, float* y, float* z);
+uint8_t lsm303_la_read(lsm303_dev_t* dev, float* x, float* y, float* z);
+
+/// \brief Linear accelerometer FIFO setup
+/// \details Enable FIFO (\c FIFO_EN bit of \c CTRL_REG5_A) and configure \c FIFO_CTRL_REG_A.
+/// \details In FIFO mode the sensor stops collecting after overrun: switch to \c LSM303_AFIFO_BYPASS and back to restart it
+/// \param dev Device handler
+/// \param fm FIFO mode. \c LSM303_AFIFO_BYPASS disable FIFO
+/// \param wtm Watermark level: \c 0 .. \c 31 samples
+/// \param irq Watermark interrupt on \c INT1: \c 0 - disable, \c 1 - enable
+/// \return \c HAL_OK if success or error code
+/// \note Stream-to-FIFO mode switch to FIFO mode by event of interrupt generator 1
+/// \ingroup lsm303func
+uint8_t lsm303_la_fifo(lsm303_dev_t* dev, const lsm303_la_fifo_t fm, uint8_t wtm, const uint8_t irq);
+
+/// \brief Linear accelerometer read FIFO source
+/// \details Read \c FIFO_SRC_REG_A register: FIFO level for \b lsm303_la_fifo_async
+/// \param dev Device handler
+/// \param src \c FIFO_SRC_REG_A register pointer. Pass the &lsm303_reg_fifo_src_a_t::reg field as a parameter and read lsm303_reg_fifo_src_a_t fields
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_fifo_src(lsm303_dev_t* dev, uint8_t* src);
+
+/// \brief Linear accelerometer read FIFO raw data \a without \a conversion
+/// \details Read FIFO level from \c FIFO_SRC_REG_A and drain up to \c max samples by one auto-increment burst
+/// \param dev Device handler
+/// \param buf Buffer of \c 3 * \c max items for samples: \c X, \c Y, \c Z, \c X, \c Y, \c Z, ...
+/// \param max Maximum samples to read: up to \c LSM303_FIFO_SIZE
+/// \param cnt Pointer to number of samples has been read
+/// \return \c HAL_OK if success, \c HAL_BUSY if FIFO is empty or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_fifo_read(lsm303_dev_t* dev, int16_t* buf, const uint8_t max, uint8_t* cnt);
+
+/// \brief Linear accelerometer FIFO data conversion to \b g
+/// \details Split interleaved raw samples of \b lsm303_la_fifo_read into separate axis arrays (structure of arrays) for block processing
+/// \param dev Device handler
+/// \param buf Raw samples: \c X, \c Y, \c Z, \c X, \c Y, \c Z, ...
+/// \param n Number of samples
+/// \param x X axis array of \c n items
+/// \param y Y axis array of \c n items
+/// \param z Z axis array of \c n items
+/// \ingroup lsm303func
+void lsm303_la_soa(lsm303_dev_t* dev, const int16_t* buf, const uint16_t n, float* x, float* y, float* z);
+
+/// \brief Linear accelerometer read sample
+/// \details Status and data are received into \c s and converted to \b g in place, no intermediate buffer
+/// \param dev Device handler
+/// \param s Sample
+/// \return \c HAL_OK if success, \c HAL_BUSY if data is not available (sample is previous data) or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_sample(lsm303_dev_t* dev, lsm303_sample_t* s);
+
+/// \brief Linear accelerometer read FIFO samples
+/// \details Data are received into the tail of \c s and converted to \b g forward in place: sample \c i
+/// is written below data of sample \c i+1. Status of every sample is \c FIFO_SRC_REG_A
+/// \param dev Device handler
+/// \param s Samples
+/// \param max Capacity of \c s, samples
+/// \param cnt Read samples
+/// \return \c HAL_OK if success, \c HAL_BUSY if FIFO is empty or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_fifo_samples(lsm303_dev_t* dev, lsm303_sample_t* s, const uint8_t max, uint8_t* cnt);
 
 /// \brief Magnetic field sensor setup
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param ten Temperature sensor: \c 0 - disable, \c 1 - enable
 /// \param odr Data rate
 /// \param gn Gain setting
 /// \param md Magnetic sensor operating mode
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_mf_setup(I2C_HandleTypeDef* i2c, const uint8_t ten, const lsm303_mf_do_t odr, const lsm303_mf_gain_t gn, const lsm303_mf_md_t md);
+uint8_t lsm303_mf_setup(lsm303_dev_t* dev, const uint8_t ten, const lsm303_mf_do_t odr, const lsm303_mf_gain_t gn, const lsm303_mf_md_t md);
+
+#if defined(LSM303_STATIC) || defined(DOXYGEN)
+/// \brief Accelerometer and magnetic field sensor setup by static configuration
+/// \details Precomputed register images: \c CTRL_REG1_A .. \c CTRL_REG4_A and \c CRA_REG_M .. \c MR_REG_M bursts.
+/// Requires build flag \c LSM303_STATIC
+/// \param dev Device handler
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303static
+uint8_t lsm303_static_setup(lsm303_dev_t* dev);
+#endif
+
+/// \brief Magnetic field sensor data rate
+/// \param dev Device handler. Configured by \b lsm303_mf_setup
+/// \param odr Data rate
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_odr(lsm303_dev_t* dev, const lsm303_mf_do_t odr);
+
+/// \brief Magnetic field sensor gain
+/// \details Sensitivity and calibration transform are updated
+/// \param dev Device handler. Configured by \b lsm303_mf_setup
+/// \param gn Gain setting
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_gain(lsm303_dev_t* dev, const lsm303_mf_gain_t gn);
 
 /// \brief Magnetic field read data \a without \a conversion
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param x X axis raw data pointer
 /// \param y Y axis raw data pointer
 /// \param z Z axis raw data pointer
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_mf_raw(I2C_HandleTypeDef* i2c, int16_t* x, int16_t* y, int16_t* z);
+uint8_t lsm303_mf_raw(lsm303_dev_t* dev, int16_t* x, int16_t* y, int16_t* z);
+
+/// \brief Magnetic field read data \a without \a conversion and status
+/// \details Read data registers and \c SR_REG_M by one burst
+/// \param dev Device handler
+/// \param x X axis raw data pointer
+/// \param y Y axis raw data pointer
+/// \param z Z axis raw data pointer
+/// \param sr \c SR_REG_M pointer or \c 0. Pass the &lsm303_reg_sr_m_t::reg field as a parameter
+/// \return \c HAL_OK if success, \c HAL_BUSY if data not ready or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_rawsr(lsm303_dev_t* dev, int16_t* x, int16_t* y, int16_t* z, uint8_t* sr);
+
+/// \brief Magnetometer calibration
+/// \details Sensitivity, hard-iron offset and soft-iron matrix are folded into one affine transform of raw data,
+/// applied by \b lsm303_mf_read, \b lsm303_mf_readsr, asynchronous read callback and \b lsm303_mf_apply.
+/// The transform is updated by \b lsm303_mf_setup for new gain
+/// \param dev Device handler
+/// \param cal Calibration or \c 0 for no calibration
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \ingroup lsm303func
+uint8_t lsm303_mf_calib(lsm303_dev_t* dev, const lsm303_mcal_t* cal);
+
+/// \brief Magnetometer conversion of raw data
+/// \details Calibrated conversion of raw (or interpolated raw) data, see \b lsm303_mf_calib
+/// \param dev Device handler
+/// \param r Raw data
+/// \param m Magnetic field
+/// \ingroup lsm303func
+void lsm303_mf_apply(const lsm303_dev_t* dev, const float r[3], float m[3]);
+
+/// \brief Magnetometer temperature compensation setup
+/// \details Offset at temperature is folded into the affine transform of conversion: no per-sample cost.
+/// Temperature is read at decimated rate after blocking magnetometer reads (\b lsm303_mf_read, \b lsm303_mf_sample, ...):
+/// \c TEMP_OUT_H_M is not adjacent to data registers, so it is a separate 2 bytes transfer. Asynchronous and data ready
+/// sampling do not read it from interrupt: call \b lsm303_mf_temp at low rate instead.
+/// Temperature sensor must be enabled by \b lsm303_mf_setup
+/// \param dev Device handler
+/// \param off Offset table, \c n entries; valid while device is used. \c 0 - disable compensation
+/// \param n Table entries
+/// \param t0 Temperature of the first entry, °C
+/// \param step Temperature step of entries, °C
+/// \param every Temperature read every \c every blocking magnetometer reads, \c 0 - by \b lsm303_mf_temp only
+/// \return \c HAL_OK or \c HAL_ERROR for wrong parameters
+/// \ingroup lsm303func
+uint8_t lsm303_mf_tcomp(lsm303_dev_t* dev, const float (*off)[3], const uint8_t n, const float t0, const float step, const uint16_t every);
+
+/// \brief Temperature read and compensation update
+/// \details Reads \c TEMP_OUT_H_M and \c TEMP_OUT_L_M, updates offset of \b lsm303_mf_tcomp table
+/// \param dev Device handler
+/// \param t Temperature pointer, °C (relative), or \c 0
+/// \return \c HAL_OK if success, \c HAL_ERROR if temperature sensor is disabled or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_temp(lsm303_dev_t* dev, float* t);
+
+/// \brief Magnetic field read data and status
+/// \details Read data registers and \c SR_REG_M by one burst and conversion data to \b nanotesla
+/// \param dev Device handler
+/// \param x X axis pointer
+/// \param y Y axis pointer
+/// \param z Z axis pointer
+/// \param sr \c SR_REG_M pointer or \c 0. Pass the &lsm303_reg_sr_m_t::reg field as a parameter
+/// \return \c HAL_OK if success, \c HAL_BUSY if data not ready or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_readsr(lsm303_dev_t* dev, float* x, float* y, float* z, uint8_t* sr);
 
 /// \brief Magnetic field read data
 /// \details Read magnetic field data and conversion \b nanotesla
-/// \param i2c I2C handler
+/// \param dev Device handler
 /// \param x X axis pointer
 /// \param y Y axis pointer
 /// \param z Z axis pointer
 /// \return \c HAL_OK if success or error code
 /// \ingroup lsm303func
-uint8_t lsm303_mf_read(I2C_HandleTypeDef* i2c, float* x, float* y, float* z);
+uint8_t lsm303_mf_read(lsm303_dev_t* dev, float* x, float* y, float* z);
+
+/// \brief Magnetic field read sample
+/// \details Data and status are received into \c s and converted to \b nanotesla in place, no intermediate buffer
+/// \param dev Device handler
+/// \param s Sample
+/// \return \c HAL_OK if success, \c HAL_BUSY if data is not ready (sample is previous data) or error code
+/// \ingroup lsm303func
+uint8_t lsm303_mf_sample(lsm303_dev_t* dev, lsm303_sample_t* s);
+
+/// \brief Linear accelerometer start asynchronous read data
+/// \details Start non-blocking read of data registers. Data is converted to \b g and passed to \c cb on transfer completion.
+/// \details One asynchronous transfer can be active at a time
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param mode Transfer mode
+/// \param cb Completion callback
+/// \return \c HAL_OK if transfer is started, \c HAL_BUSY if other transfer is active or error code
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_la_async(lsm303_dev_t* dev, const lsm303_async_t mode, lsm303_cb_t cb);
+
+/// \brief Magnetic field start asynchronous read data
+/// \details Start non-blocking read of data registers. Data is converted to \b nanotesla and passed to \c cb on transfer completion.
+/// \details One asynchronous transfer can be active at a time
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param mode Transfer mode
+/// \param cb Completion callback
+/// \return \c HAL_OK if transfer is started, \c HAL_BUSY if other transfer is active or error code
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_mf_async(lsm303_dev_t* dev, const lsm303_async_t mode, lsm303_cb_t cb);
+
+/// \brief Linear accelerometer start asynchronous read sample
+/// \details Transfer (DMA) target is \c s, data is converted to \b g in place on transfer completion
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param mode Transfer mode
+/// \param s Sample, valid until completion
+/// \param cb Completion callback or \c 0 - poll \b lsm303_async_busy
+/// \return \c HAL_OK if transfer is started, \c HAL_BUSY if other transfer is active or error code
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_la_async_sample(lsm303_dev_t* dev, const lsm303_async_t mode, lsm303_sample_t* s, lsm303_sample_cb_t cb);
+
+/// \brief Magnetic field start asynchronous read sample
+/// \details Transfer (DMA) target is \c s, data is converted to \b nanotesla in place on transfer completion
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param mode Transfer mode
+/// \param s Sample, valid until completion
+/// \param cb Completion callback or \c 0 - poll \b lsm303_async_busy
+/// \return \c HAL_OK if transfer is started, \c HAL_BUSY if other transfer is active or error code
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_mf_async_sample(lsm303_dev_t* dev, const lsm303_async_t mode, lsm303_sample_t* s, lsm303_sample_cb_t cb);
+
+/// \brief Linear accelerometer start asynchronous read FIFO samples
+/// \details Transfer (DMA) target is the tail of \c s, data is converted to \b g forward in place on transfer completion.
+/// FIFO must hold at least \c n samples, e.g. by \c FIFO_SRC_REG_A of \b lsm303_la_fifo_src. Status of every sample is
+/// \c src, FIFO overrun of \c src is counted on completion as by \b lsm303_la_fifo_samples
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param mode Transfer mode
+/// \param s Samples, valid until completion
+/// \param n Samples to read: \c 1 .. \c LSM303_FIFO_SIZE
+/// \param src \c FIFO_SRC_REG_A read to size \c n, lsm303_reg_fifo_src_a_t
+/// \param cb Completion callback or \c 0 - poll \b lsm303_async_busy
+/// \return \c HAL_OK if transfer is started, \c HAL_BUSY if other transfer is active or error code
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+uint8_t lsm303_la_fifo_async(lsm303_dev_t* dev, const lsm303_async_t mode, lsm303_sample_t* s, const uint8_t n, const uint8_t src, lsm303_sample_cb_t cb);
+
+/// \brief Asynchronous transfer state
+/// \param dev Device handler
+/// \return \c 1U if asynchronous transfer is active or \c 0U
+/// \ingroup lsm303func
+uint8_t lsm303_async_busy(lsm303_dev_t* dev);
+
+/// \brief Asynchronous transfer completion handler
+/// \details Call it from \c HAL_I2C_MemRxCpltCallback for every device. Transfers of other devices are ignored
+/// \param dev Device handler
+/// \param i2c I2C handler passed to \c HAL_I2C_MemRxCpltCallback
+/// \ingroup lsm303func
+void lsm303_rx_cplt(lsm303_dev_t* dev, I2C_HandleTypeDef* i2c);
+
+/// \brief Write transfer completion handler of bus port
+/// \details Call it from \c HAL_I2C_MemTxCpltCallback for every device. Transfers of other devices are ignored
+/// \param dev Device handler
+/// \param i2c I2C handler passed to \c HAL_I2C_MemTxCpltCallback
+/// \ingroup lsm303func
+void lsm303_tx_cplt(lsm303_dev_t* dev, I2C_HandleTypeDef* i2c);
+
+/// \brief Asynchronous transfer error handler
+/// \details Call it from \c HAL_I2C_ErrorCallback for every device. Transfers of other devices are ignored
+/// \param dev Device handler
+/// \param i2c I2C handler passed to \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+void lsm303_rx_error(lsm303_dev_t* dev, I2C_HandleTypeDef* i2c);
+
+/// \brief Linear accelerometer data ready interrupt on \c INT1
+/// \details Set \c I1_DRDY1 bit of \c CTRL_REG3_A
+/// \param dev Device handler
+/// \param en Data ready interrupt: \c 0 - disable, \c 1 - enable
+/// \return \c HAL_OK if success or error code
+/// \ingroup lsm303func
+uint8_t lsm303_la_drdy(lsm303_dev_t* dev, const uint8_t en);
+
+/// \brief Data ready interrupt handler
+/// \details Call it from \c HAL_GPIO_EXTI_Callback for \c INT1 (accelerometer) or \c DRDY (magnetometer) pin.
+/// \details Timestamp the sample and start asynchronous read into ring buffer. Read is deferred while other transfer is active
+/// \param dev Device handler. I2C interrupts (and DMA channel for \c LSM303_ASYNC_DMA) must be configured
+/// \param sensor Sensor with data ready
+/// \param mode Transfer mode
+/// \note Call \b lsm303_rx_cplt from \c HAL_I2C_MemRxCpltCallback and \b lsm303_rx_error from \c HAL_I2C_ErrorCallback
+/// \ingroup lsm303func
+void lsm303_drdy_irq(lsm303_dev_t* dev, const lsm303_sensor_t sensor, const lsm303_async_t mode);
+
+/// \brief Pop sample of data ready sampling
+/// \details Also restart read has been deferred by busy bus
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \param smpl Sample pointer
+/// \return \c HAL_OK if success, \c HAL_BUSY if no samples or error code
+/// \ingroup lsm303func
+uint8_t lsm303_pop(lsm303_dev_t* dev, const lsm303_sensor_t sensor, lsm303_raw_t* smpl);
+
+/// \brief Lost samples of data ready sampling
+/// \param dev Device handler
+/// \param sensor Sensor
+/// \return Number of samples lost by ring buffer overflow or transfer error
+/// \ingroup lsm303func
+uint32_t lsm303_lost(lsm303_dev_t* dev, const lsm303_sensor_t sensor);
 
 #endif // __LSM303_H__
\ No newline at end of file
@@ -0,0 +1,310 @@
+/// \file lsm303fixed.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303fixed.h"
+#include "log.h"
+
+#define Q15_ONE 32768
+#define Q12_ONE 4096U
+
+enum { X, Y, Z };
+
+/// \brief Multiplication by \c Q15 coefficient
+/// \details Compiles to \c SMULL on Cortex-M4
+static inline int32_t lsm303_qmul(const int32_t a, const int32_t b)
+{
+    return (int32_t)(((int64_t)a * b) >> 15);
+}
+
+/// \brief Squared magnitude of \c Q8 vector, \c Q16
+/// \details Compiles to \c SMULL / \c SMLAL on Cortex-M4
+static inline uint64_t lsm303_sum2(const int32_t dX, const int32_t dY, const int32_t dZ)
+{
+    return (uint64_t)((int64_t)dX * dX + (int64_t)dY * dY + (int64_t)dZ * dZ);
+}
+
+/// \brief Squared magnitude of raw vector
+/// \details Uses \c SMLAD on cores with DSP extension
+static inline uint32_t lsm303_mag2(const int16_t x, const int16_t y, const int16_t z)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+    const uint32_t xy = __PKHBT((uint32_t)(uint16_t)x, (uint32_t)(uint16_t)y, 16);
+    return __SMLAD(xy, xy, (uint32_t)((int32_t)z * z));
+#else
+    return (uint32_t)((int32_t)x * x + (int32_t)y * y + (int32_t)z * z);
+#endif
+}
+
+/// \brief Squared threshold in \c Q16 counts^2
+static uint64_t lsm303_thr2(const float thr, const float lsb)
+{
+    const float v = thr / lsb * 256.0F;
+    if (v <= 0.0F) return 0U;
+    if (v >= 4294967295.0F) return UINT64_MAX;
+    return (uint64_t)(v * v);
+}
+
+/// \brief Trigger value from \c Q16 squared magnitude
+static inline uint32_t lsm303_ret2(const uint64_t m2)
+{
+    const uint32_t m = (uint32_t)(m2 >> 16);
+    return m ? m : 1U;
+}
+
+int32_t lsm303_q15(const float a)
+{
+    if (a <= 0.0F) return 0;
+    if (a >= 1.0F) return Q15_ONE;
+    return (int32_t)(a * (float)Q15_ONE + 0.5F);
+}
+
+uint32_t lsm303_isqrt(uint32_t v)
+{
+    uint32_t r = 0U;
+    uint32_t b = 1UL << 30;
+    while (b > v) b >>= 2;
+    while (b != 0U) {
+        if (v >= r + b) {
+            v -= r + b;
+            r = (r >> 1) + b;
+        } else {
+            r >>= 1;
+        }
+        b >>= 2;
+    }
+    return r;
+}
+
+void motionLPq_init(lsm303_motion_lp_q_t* s, const float alpha, const float delta, const float lsb, const uint8_t sample)
+{
+    s->alpha = lsm303_q15(alpha);
+    s->delta2 = lsm303_thr2(delta, lsb);
+    s->sample = sample;
+    motionLPq_reset(s);
+}
+
+void motionLPq_reset(lsm303_motion_lp_q_t* s)
+{
+    s->setup = 0U;
+    s->smpl = 0U;
+}
+
+uint32_t motionLPq_step(lsm303_motion_lp_q_t* s, const int16_t x, const int16_t y, const int16_t z)
+{
+    const int32_t in[3] = { (int32_t)x << 8, (int32_t)y << 8, (int32_t)z << 8 };
+    // first iteration
+    if (s->setup == 0) {
+        for (uint8_t i = 0; i < 3; ++i) s->f[i] = in[i];
+        s->setup++;
+        return 0U;
+    }
+    // Low-pass filter
+    for (uint8_t i = 0; i < 3; ++i) s->f[i] += lsm303_qmul(s->alpha, in[i] - s->f[i]);
+    // Accumulation
+    if (s->setup < CNTSETUP) {
+        for (uint8_t i = 0; i < 3; ++i) s->p[i] = s->f[i];
+        s->setup++;
+        return 0U;
+    }
+    // Samples
+    if (s->smpl++ < s->sample) return 0U;
+    s->smpl = 0;
+    // Squared magnitude
+    const uint64_t m2 = lsm303_sum2(s->f[X] - s->p[X], s->f[Y] - s->p[Y], s->f[Z] - s->p[Z]);
+    if (m2 > s->delta2) {
+        s->setup = 0;
+        xDebug("%d, %d, %d\tD2: %lu\n", x, y, z, (unsigned long)(m2 >> 16));
+        return lsm303_ret2(m2);
+    }
+    return 0U;
+}
+
+void motionKq_init(lsm303_motion_k_q_t* s, const float Q, const float R, const float E, const float delta, const float lsb, const uint8_t sample)
+{
+    const float r = (R > 0.0F) ? R : 1.0F;
+    s->Q = (uint32_t)(Q / r * (float)Q12_ONE + 0.5F);
+    s->E = (uint32_t)(E / r * (float)Q12_ONE + 0.5F);
+    if (s->E > 0xFFFFU) s->E = 0xFFFFU;
+    s->delta2 = lsm303_thr2(delta, lsb);
+    s->limit2 = lsm303_thr2(1.0F, lsb);
+    s->sample = sample;
+    motionKq_reset(s);
+}
+
+void motionKq_reset(lsm303_motion_k_q_t* s)
+{
+    s->setup = 0U;
+    s->smpl = 0U;
+}
+
+uint32_t motionKq_step(lsm303_motion_k_q_t* s, const int16_t x, const int16_t y, const int16_t z)
+{
+    const int32_t in[3] = { (int32_t)x << 8, (int32_t)y << 8, (int32_t)z << 8 };
+    // first iteration
+    if (s->setup == 0) {
+        for (uint8_t i = 0; i < 3; ++i) {
+            s->f[i] = in[i];    // Prediction estimate
+            s->e[i] = s->E;     // Prediction error
+        }
+        s->setup++;
+        return 0U;
+    }
+    // Kalman filter, covariances are relative to R
+    for (uint8_t i = 0; i < 3; ++i) {
+        uint32_t e = s->e[i] + s->Q;                    // Prediction of a new error
+        if (e > 0xFFFFU) e = 0xFFFFU;
+        const int32_t K = (int32_t)((e << 15) / (e + Q12_ONE)); // Calculation of the Kalman coefficient
+        s->f[i] += lsm303_qmul(K, in[i] - s->f[i]);     // Estimate update
+        s->e[i] = (e * (uint32_t)(Q15_ONE - K)) >> 15;  // Error update
+    }
+    // Accumulation
+    if (s->setup < CNTSETUP) {
+        for (uint8_t i = 0; i < 3; ++i) s->p[i] = s->f[i];
+        s->setup++;
+        return 0U;
+    }
+    // Samples
+    if (s->smpl++ < s->sample) return 0U;
+    s->smpl = 0;
+    // Squared magnitude
+    const uint64_t m2 = lsm303_sum2(s->f[X] - s->p[X], s->f[Y] - s->p[Y], s->f[Z] - s->p[Z]);
+    if (m2 > s->delta2 && m2 < s->limit2) {
+        s->setup = 0;
+        xDebug("%d, %d, %d\tD2: %lu\n", x, y, z, (unsigned long)(m2 >> 16));
+        return lsm303_ret2(m2);
+    }
+    return 0U;
+}
+
+void distortionHPq_init(lsm303_distortion_hp_q_t* s, const float alpha, const float delta, const float lsb)
+{
+    s->alpha = lsm303_q15(alpha);
+    s->delta = (delta > 0.0F) ? (uint32_t)(delta / lsb * 4.0F + 0.5F) : 0U;
+    distortionHPq_reset(s);
+}
+
+void distortionHPq_reset(lsm303_distortion_hp_q_t* s)
+{
+    // high-pass filter history is read from the first sample
+    for (uint8_t i = 0; i < 3; ++i) {
+        s->i[i] = 0;
+        s->o[i] = 0;
+    }
+    s->M = 0U;
+    s->setup = 0U;
+}
+
+uint32_t distortionHPq_step(lsm303_distortion_hp_q_t* s, const int16_t x, const int16_t y, const int16_t z)
+{
+    const int32_t in[3] = { (int32_t)x << 8, (int32_t)y << 8, (int32_t)z << 8 };
+    int32_t d[3];
+    for (uint8_t i = 0; i < 3; ++i) {
+        // high-pass filter
+        s->o[i] = lsm303_qmul(s->alpha, s->o[i] + in[i] - s->i[i]);
+        s->i[i] = in[i];
+        // difference, Q2
+        d[i] = (s->i[i] - s->o[i]) >> 6;
+    }
+    // magnitude, Q2
+    const uint32_t m = lsm303_isqrt((uint32_t)(d[X] * d[X]) + (uint32_t)(d[Y] * d[Y]) + (uint32_t)(d[Z] * d[Z]));
+    // average magnitude
+    if (s->setup == 0U) {
+        s->M = m;
+        s->setup++;
+        return 0U;
+    }
+    // magnitude low-pass filter
+    if (s->setup < CNTSETUP) {
+        s->M = (uint32_t)((int32_t)s->M + lsm303_qmul(s->alpha, (int32_t)m - (int32_t)s->M));
+        s->setup++;
+        return 0U;
+    }
+    // check
+    const uint32_t D = (s->M > m) ? s->M - m : m - s->M;
+    if (D > s->delta) {
+        xDebug("%d, %d, %d\tM: %lu m: %lu D: %lu\n", x, y, z, (unsigned long)s->M, (unsigned long)m, (unsigned long)D);
+        s->setup = 0;
+        return D;
+    }
+    return 0U;
+}
+
+void distortionLPq_init(lsm303_distortion_lp_q_t* s, const float alpha, const float delta, const float lsb)
+{
+    s->alpha = lsm303_q15(alpha);
+    s->delta2 = lsm303_thr2(delta, lsb);
+    distortionLPq_reset(s);
+}
+
+void distortionLPq_reset(lsm303_distortion_lp_q_t* s)
+{
+    s->setup = 0U;
+}
+
+uint32_t distortionLPq_step(lsm303_distortion_lp_q_t* s, const int16_t x, const int16_t y, const int16_t z)
+{
+    const int32_t in[3] = { (int32_t)x << 8, (int32_t)y << 8, (int32_t)z << 8 };
+    // first iteration
+    if (s->setup == 0) {
+        for (uint8_t i = 0; i < 3; ++i) s->a[i] = in[i];
+        s->setup++;
+        return 0U;
+    }
+    // difference
+    const uint64_t m2 = lsm303_sum2(in[X] - s->a[X], in[Y] - s->a[Y], in[Z] - s->a[Z]);
+    // low-pass
+    for (uint8_t i = 0; i < 3; ++i) s->a[i] += lsm303_qmul(s->alpha, in[i] - s->a[i]);
+    // accumulate
+    if (s->setup < CNTSETUP) {
+        s->setup++;
+        return 0U;
+    }
+    // squared magnitude
+    if (m2 > s->delta2) {
+        xDebug("%d, %d, %d\tD2: %lu\n", x, y, z, (unsigned long)(m2 >> 16));
+        s->setup = 0;
+        return lsm303_ret2(m2);
+    }
+    return 0U;
+}
+
+void detectFallq_init(lsm303_fall_q_t* s, const float wThs, const float iThs, const float lsb)
+{
+    const float w = wThs / lsb;
+    const float i = iThs / lsb;
+    s->wThs2 = (w * w < 4294967295.0F) ? (uint32_t)(w * w) : UINT32_MAX;
+    s->iThs2 = (i * i < 4294967295.0F) ? (uint32_t)(i * i) : UINT32_MAX;
+    detectFallq_reset(s);
+}
+
+void detectFallq_reset(lsm303_fall_q_t* s)
+{
+    s->stage = STAGE_INIT;
+}
+
+stage_t detectFallq_step(lsm303_fall_q_t* s, const int16_t x, const int16_t y, const int16_t z)
+{
+    const uint32_t M2 = lsm303_mag2(x, y, z);
+    switch (s->stage) {
+    case STAGE_INIT:
+        if (M2 < s->wThs2) {
+            s->stage = STAGE_WEIGHLESSNESS;
+            xDebug("WEIGHLESSNESS: %lu\n", (unsigned long)M2);
+        }
+        break;
+    case STAGE_WEIGHLESSNESS:
+        if (M2 > s->iThs2) {
+            s->stage = STAGE_FALL;
+            xDebug("FALL: %lu\n", (unsigned long)M2);
+        }
+        break;
+    case STAGE_FALL:
+        if (s->wThs2 == 0U && s->iThs2 == 0U) {
+            s->stage = STAGE_INIT;
+            xDebug("Reset Stage to INIT\n");
+        }
+    }
+    return s->stage;
+}
@@ -0,0 +1,208 @@
+/// \file lsm303fixed.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_FIXED_H__
+#define __LSM303_FIXED_H__
+
+#include "stm32l4xx_hal.h"
+#include "lsm303algo.h"
+
+/// \defgroup lsm303fixed 4. LSM303 Fixed-point Algorithmes
+/// \brief LSM303 Algorithmes on raw data without FPU
+/// \details Fixed-point versions of \b lsm303algo detectors working directly on raw counts of \b lsm303_la_raw, \b lsm303_mf_raw or FIFO.
+/// \details Filter coefficients are \c Q15, filtered data is raw counts with 8 fractional bits (\c Q8).
+/// \details Thresholds are scaled to raw counts once by \c *_init functions, magnitudes are compared squared (without square root).
+/// \details Raw data must be in 12-bit range of LSM303DLHC output (\c -4096 .. \c 4095)
+
+/// \brief Fixed-point motion detection by low-pass filter state
+/// \ingroup lsm303fixed
+typedef struct {
+    int32_t alpha;      ///< Coefficient of the low-pass filter, \c Q15
+    uint64_t delta2;    ///< Squared trigger threshold, \c Q16 counts^2
+    uint8_t sample;     ///< Samples for checks (duration of measurement)
+    uint8_t setup;      ///< Accumulated samples
+    uint8_t smpl;       ///< Samples counter
+    int32_t p[3];       ///< Reference (accumulated) data, \c Q8
+    int32_t f[3];       ///< Filtered data, \c Q8
+} lsm303_motion_lp_q_t;
+
+/// \brief Fixed-point motion detection by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. (1 > a > 0)
+/// \param delta Trigger threshold in sensor units (\b g)
+/// \param lsb Sensor units per LSB (lsm303_dev_t::alsb)
+/// \param sample Samples for checks (duration of measurement)
+/// \ingroup lsm303fixed
+void motionLPq_init(lsm303_motion_lp_q_t* s, const float alpha, const float delta, const float lsb, const uint8_t sample);
+
+/// \brief Fixed-point motion detection by low-pass filter reset
+/// \param s State pointer
+/// \ingroup lsm303fixed
+void motionLPq_reset(lsm303_motion_lp_q_t* s);
+
+/// \brief Fixed-point motion detection by linear accelerometer
+/// \details Integer version of \b motionLP_step
+/// \param s State pointer
+/// \param x X axis raw data
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \return \c 0U if motion don't detected or squared magnitude of the trigger in raw counts^2
+/// \ingroup lsm303fixed
+uint32_t motionLPq_step(lsm303_motion_lp_q_t* s, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Fixed-point motion detection by Kalman filter state
+/// \ingroup lsm303fixed
+typedef struct {
+    uint32_t Q;         ///< Process covariance relative to measurement covariance, \c Q12
+    uint32_t E;         ///< Error prediction relative to measurement covariance, \c Q12
+    uint64_t delta2;    ///< Squared trigger threshold, \c Q16 counts^2
+    uint64_t limit2;    ///< Squared upper trigger limit, \c Q16 counts^2
+    uint8_t sample;     ///< Samples for checks (duration of measurement)
+    uint8_t setup;      ///< Accumulated samples
+    uint8_t smpl;       ///< Samples counter
+    int32_t f[3];       ///< Prediction estimate (filtered data), \c Q8
+    uint32_t e[3];      ///< Prediction error relative to measurement covariance, \c Q12
+    int32_t p[3];       ///< Reference (accumulated) data, \c Q8
+} lsm303_motion_k_q_t;
+
+/// \brief Fixed-point motion detection by Kalman filter initialization
+/// \details Covariances are normalized by \c R: Kalman gain depends on their ratio only
+/// \param s State pointer
+/// \param Q Process covariance
+/// \param R Measurement covariance
+/// \param E Error prediction
+/// \param delta Trigger threshold in sensor units (\b g)
+/// \param lsb Sensor units per LSB (lsm303_dev_t::alsb)
+/// \param sample Samples for checks (duration of measurement)
+/// \ingroup lsm303fixed
+void motionKq_init(lsm303_motion_k_q_t* s, const float Q, const float R, const float E, const float delta, const float lsb, const uint8_t sample);
+
+/// \brief Fixed-point motion detection by Kalman filter reset
+/// \param s State pointer
+/// \ingroup lsm303fixed
+void motionKq_reset(lsm303_motion_k_q_t* s);
+
+/// \brief Fixed-point motion detection by linear accelerometer
+/// \details Integer version of \b motionK_step
+/// \param s State pointer
+/// \param x X axis raw data
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \return \c 0U if motion don't detected or squared magnitude of the trigger in raw counts^2
+/// \ingroup lsm303fixed
+uint32_t motionKq_step(lsm303_motion_k_q_t* s, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Fixed-point detection of magnetic field distortion by high-pass filter state
+/// \ingroup lsm303fixed
+typedef struct {
+    int32_t alpha;      ///< Coefficient of the high-pass filter, \c Q15
+    uint32_t delta;     ///< Trigger threshold, \c Q2 counts
+    uint8_t setup;      ///< Accumulated samples
+    int32_t i[3];       ///< Previous input, \c Q8
+    int32_t o[3];       ///< Previous output, \c Q8
+    uint32_t M;         ///< Average magnitude, \c Q2
+} lsm303_distortion_hp_q_t;
+
+/// \brief Fixed-point detection of magnetic field distortion by high-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the high-pass filter. (1 > a > 0)
+/// \param delta Trigger threshold in sensor units (\b uT for X, Y axis)
+/// \param lsb Sensor units per LSB: \c 100.0F / lsm303_dev_t::mlsb_xy
+/// \ingroup lsm303fixed
+void distortionHPq_init(lsm303_distortion_hp_q_t* s, const float alpha, const float delta, const float lsb);
+
+/// \brief Fixed-point detection of magnetic field distortion by high-pass filter reset
+/// \details Restart data accumulation and clear filter history, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303fixed
+void distortionHPq_reset(lsm303_distortion_hp_q_t* s);
+
+/// \brief Fixed-point detection of magnetic field distortion
+/// \details Integer version of \b distortionHP_step. Magnitude uses integer square root
+/// \param s State pointer
+/// \param x X axis raw data
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \return \c 0U if distortion don't detected or value of the trigger, \c Q2 counts
+/// \ingroup lsm303fixed
+uint32_t distortionHPq_step(lsm303_distortion_hp_q_t* s, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Fixed-point detection of magnetic field distortion by low-pass filter state
+/// \ingroup lsm303fixed
+typedef struct {
+    int32_t alpha;      ///< Coefficient of the low-pass filter, \c Q15
+    uint64_t delta2;    ///< Squared trigger threshold, \c Q16 counts^2
+    uint8_t setup;      ///< Accumulated samples
+    int32_t a[3];       ///< Average, \c Q8
+} lsm303_distortion_lp_q_t;
+
+/// \brief Fixed-point detection of magnetic field distortion by low-pass filter initialization
+/// \param s State pointer
+/// \param alpha Coefficient of the low-pass filter. Smaller - more smoothing. (1 > a > 0)
+/// \param delta Trigger threshold in sensor units (\b uT for X, Y axis)
+/// \param lsb Sensor units per LSB: \c 100.0F / lsm303_dev_t::mlsb_xy
+/// \ingroup lsm303fixed
+void distortionLPq_init(lsm303_distortion_lp_q_t* s, const float alpha, const float delta, const float lsb);
+
+/// \brief Fixed-point detection of magnetic field distortion by low-pass filter reset
+/// \param s State pointer
+/// \ingroup lsm303fixed
+void distortionLPq_reset(lsm303_distortion_lp_q_t* s);
+
+/// \brief Fixed-point detection of magnetic field distortion
+/// \details Integer version of \b distortionLP_step
+/// \param s State pointer
+/// \param x X axis raw data
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \return \c 0U if distortion don't detected or squared magnitude of the trigger in raw counts^2
+/// \ingroup lsm303fixed
+uint32_t distortionLPq_step(lsm303_distortion_lp_q_t* s, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Fixed-point fall detection state
+/// \ingroup lsm303fixed
+typedef struct {
+    uint32_t wThs2;     ///< Squared weighlessness threshould, counts^2
+    uint32_t iThs2;     ///< Squared impact threshould, counts^2
+    stage_t stage;      ///< Current stage
+} lsm303_fall_q_t;
+
+/// \brief Fixed-point fall detection initialization
+/// \param s State pointer
+/// \param wThs Weighlessness threshould in \b g
+/// \param iThs Impact threshould in \b g
+/// \param lsb Sensor units per LSB (lsm303_dev_t::alsb)
+/// \ingroup lsm303fixed
+void detectFallq_init(lsm303_fall_q_t* s, const float wThs, const float iThs, const float lsb);
+
+/// \brief Fixed-point fall detection reset
+/// \details Reset stage to \c STAGE_INIT after fall detection
+/// \param s State pointer
+/// \ingroup lsm303fixed
+void detectFallq_reset(lsm303_fall_q_t* s);
+
+/// \brief Fixed-point fall detection
+/// \details Integer version of \b detectFall_step: squared magnitude is compared with squared thresholds
+/// \param s State pointer
+/// \param x X axis raw data
+/// \param y Y axis raw data
+/// \param z Z axis raw data
+/// \return Stage
+/// \ingroup lsm303fixed
+stage_t detectFallq_step(lsm303_fall_q_t* s, const int16_t x, const int16_t y, const int16_t z);
+
+/// \brief Convert coefficient to \c Q15
+/// \param a Coefficient: \c 0.0F .. \c 1.0F
+/// \return \c Q15 coefficient
+/// \ingroup lsm303fixed
+int32_t lsm303_q15(const float a);
+
+/// \brief Integer square root
+/// \param v Value
+/// \return Floor of square root
+/// \ingroup lsm303fixed
+uint32_t lsm303_isqrt(uint32_t v);
+
+#endif // __LSM303_FIXED_H__
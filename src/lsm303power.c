@@ -0,0 +1,116 @@
+/// \file lsm303power.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303power.h"
+#include "log.h"
+
+static inline uint32_t lsm303_lp_now(const lsm303_lp_t* lp)
+{
+    return lp->dev->clock != 0 ? lp->dev->clock() : HAL_GetTick();
+}
+
+uint8_t lsm303_lp_init(lsm303_lp_t* lp, lsm303_dev_t* dev, lsm303_sample_t* s, const uint8_t max, lsm303_lp_cb_t cb, void* ctx)
+{
+    if (0 == lp || 0 == dev || 0 == dev->i2c || 0 == s || max == 0U) return HAL_ERROR;
+    lp->dev = dev;
+    lp->uart = 0;
+    lp->clock = 0;
+    lp->wall = 0;
+    lp->s = s;
+    lp->max = max;
+    lp->cb = cb;
+    lp->ctx = ctx;
+    lp->pending = 0U;
+    lsm303_lp_reset(lp);
+    return HAL_OK;
+}
+
+void lsm303_lp_periph(lsm303_lp_t* lp, UART_HandleTypeDef* uart, void (*clock)(void), lsm303_clock_t wall)
+{
+    lp->uart = uart;
+    lp->clock = clock;
+    lp->wall = wall;
+    lp->start = wall != 0 ? wall() : 0U;
+}
+
+void lsm303_lp_irq(lsm303_lp_t* lp)
+{
+    if (0 == lp) return;
+    lp->pending = 1U;
+    lp->rep.events++;
+}
+
+// Enter STOP2 and restore peripherals after wakeup
+static void lsm303_lp_sleep(lsm303_lp_t* lp)
+{
+    // Logger UART and asynchronous I2C transfer stop in STOP2: stay awake until they are completed
+    const uint32_t t0 = HAL_GetTick();
+    while (log_pending() != 0U && HAL_GetTick() - t0 < LSM303_LP_LOG_TIMEOUT);
+    if (log_pending() != 0U || lp->dev->async.busy != 0U) return;
+
+    lp->rep.awake += lsm303_lp_now(lp) - lp->wake;
+    if (0 != lp->uart) HAL_UART_DeInit(lp->uart);
+    HAL_I2C_DeInit(lp->dev->i2c);
+    HAL_SuspendTick();
+
+    // Interrupt after the check still wakes WFI up: its handler runs after clock restore
+    __disable_irq();
+    if (lp->pending == 0U) {
+        HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+        lp->rep.wakeups++;
+    }
+    HAL_ResumeTick();
+    if (0 != lp->clock) lp->clock();
+    __enable_irq();
+
+    HAL_I2C_Init(lp->dev->i2c);
+    if (0 != lp->uart) HAL_UART_Init(lp->uart);
+    lp->wake = lsm303_lp_now(lp);
+}
+
+uint8_t lsm303_lp_step(lsm303_lp_t* lp)
+{
+    if (0 == lp || 0 == lp->dev) return HAL_ERROR;
+    if (lp->pending == 0U) lsm303_lp_sleep(lp);
+    // Woken up by other interrupt
+    if (lp->pending == 0U) return HAL_BUSY;
+    // Clear before drain: watermark edge during drain is not lost
+    lp->pending = 0U;
+
+    uint8_t ret = HAL_BUSY;
+    uint8_t cnt = 0U;
+    uint8_t st;
+    while ((st = lsm303_la_fifo_samples(lp->dev, lp->s, lp->max, &cnt)) == HAL_OK) {
+        lp->rep.samples += cnt;
+        if (0 != lp->cb) lp->cb(lp->ctx, lp->s, cnt);
+        ret = HAL_OK;
+    }
+    if (st != HAL_BUSY) return st;
+    // FIFO is disabled or event interrupt: current sample
+    if (ret == HAL_BUSY && lsm303_la_sample(lp->dev, &lp->s[0]) == HAL_OK) {
+        lp->rep.samples++;
+        if (0 != lp->cb) lp->cb(lp->ctx, lp->s, 1U);
+        ret = HAL_OK;
+    }
+    return ret;
+}
+
+void lsm303_lp_report(lsm303_lp_t* lp, lsm303_lp_report_t* rep)
+{
+    *rep = lp->rep;
+    rep->awake += lsm303_lp_now(lp) - lp->wake;
+    rep->elapsed = lp->wall != 0 ? lp->wall() - lp->start : 0U;
+}
+
+void lsm303_lp_reset(lsm303_lp_t* lp)
+{
+    lp->rep.wakeups = 0U;
+    lp->rep.events = 0U;
+    lp->rep.samples = 0U;
+    lp->rep.awake = 0U;
+    lp->rep.elapsed = 0U;
+    lp->wake = lsm303_lp_now(lp);
+    lp->start = lp->wall != 0 ? lp->wall() : 0U;
+}
@@ -0,0 +1,110 @@
+/// \file lsm303power.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_POWER_H__
+#define __LSM303_POWER_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303power 10. LSM303 Low Power
+/// \brief Autonomous acquisition with MCU in STOP2 mode between accelerometer events
+/// \details Accelerometer collects samples in FIFO (stream mode, watermark interrupt on \c INT1) or generates
+/// \c INT1 / \c INT2 events while MCU sleeps in STOP2. The interrupt wakes MCU up, \b lsm303_lp_step drains FIFO
+/// into caller buffer, passes blocks to callback and enters STOP2 again.
+/// \details Across stop mode: logger ring buffer is drained, I2C and UART are deinitialized (pins in analog state),
+/// system clock is restored by user function (e.g. \c SystemClock_Config: MCU wakes up on MSI) and I2C and UART are initialized again.
+/// \details Duty-cycle report: wakeups, processed samples, awake time by lsm303_dev_t::clock
+/// (\c HAL_GetTick by default: both stop in STOP2) and optional wall time by a clock running in STOP2 (LPTIM, RTC)
+
+/// \brief Drain timeout of logger before stop mode, ms
+/// \details Define it in build flags to override
+/// \ingroup lsm303power
+#ifndef LSM303_LP_LOG_TIMEOUT
+# define LSM303_LP_LOG_TIMEOUT 20U
+#endif
+
+/// \brief Block of samples callback
+/// \param ctx User context
+/// \param s Samples
+/// \param n Number of samples
+/// \ingroup lsm303power
+typedef void (*lsm303_lp_cb_t)(void* ctx, lsm303_sample_t* s, const uint8_t n);
+
+/// \brief Duty-cycle report
+/// \ingroup lsm303power
+typedef struct {
+    uint32_t wakeups;   ///< STOP2 exits
+    uint32_t events;    ///< Interrupts handled by \b lsm303_lp_irq
+    uint32_t samples;   ///< Samples passed to callback
+    uint32_t awake;     ///< Awake time, ticks of lsm303_dev_t::clock
+    uint32_t elapsed;   ///< Wall time, ticks of lsm303_lp_t::wall or \c 0 without wall clock
+} lsm303_lp_report_t;
+
+/// \brief Low-power acquisition state
+/// \ingroup lsm303power
+typedef struct {
+    lsm303_dev_t* dev;              ///< Device handler
+    UART_HandleTypeDef* uart;       ///< UART re-initialized across stop mode or \c 0
+    void (*clock)(void);            ///< System clock restore after stop mode, e.g. \c SystemClock_Config, or \c 0
+    lsm303_clock_t wall;            ///< Clock running in STOP2 or \c 0
+    lsm303_sample_t* s;             ///< Samples buffer
+    uint8_t max;                    ///< Samples buffer size
+    lsm303_lp_cb_t cb;              ///< Block of samples callback
+    void* ctx;                      ///< Callback context
+    volatile uint8_t pending;       ///< Interrupt not handled yet
+    uint32_t wake;                  ///< Awake start, ticks of lsm303_dev_t::clock
+    uint32_t start;                 ///< Report start, ticks of lsm303_lp_t::wall
+    lsm303_lp_report_t rep;         ///< Duty-cycle report
+} lsm303_lp_t;
+
+/// \brief Low-power acquisition initialization
+/// \details Configure accelerometer first: data rate, FIFO stream mode with watermark interrupt (\b lsm303_la_fifo)
+/// and / or event interrupts (\b lsm303_la_int1, \b lsm303_la_freefall, \b lsm303_la_click)
+/// \param lp State pointer
+/// \param dev Device handler
+/// \param s Samples buffer, \c LSM303_FIFO_SIZE samples for full FIFO in one block
+/// \param max Samples buffer size
+/// \param cb Block of samples callback or \c 0
+/// \param ctx Callback context
+/// \return \c HAL_OK if success or \c HAL_ERROR
+/// \ingroup lsm303power
+uint8_t lsm303_lp_init(lsm303_lp_t* lp, lsm303_dev_t* dev, lsm303_sample_t* s, const uint8_t max, lsm303_lp_cb_t cb, void* ctx);
+
+/// \brief Peripherals restored across stop mode
+/// \param lp State pointer
+/// \param uart Logger UART or \c 0
+/// \param clock System clock restore, e.g. \c SystemClock_Config, or \c 0
+/// \param wall Clock running in STOP2 for wall time of report or \c 0
+/// \ingroup lsm303power
+void lsm303_lp_periph(lsm303_lp_t* lp, UART_HandleTypeDef* uart, void (*clock)(void), lsm303_clock_t wall);
+
+/// \brief Accelerometer interrupt handler
+/// \details Call it from \c HAL_GPIO_EXTI_Callback for \c INT1 / \c INT2 pin
+/// \param lp State pointer
+/// \ingroup lsm303power
+void lsm303_lp_irq(lsm303_lp_t* lp);
+
+/// \brief Low-power acquisition step
+/// \details Enters STOP2 if there is no pending interrupt, on wakeup drains accelerometer FIFO by blocks of
+/// lsm303_lp_t::max samples (one sample if FIFO is empty or disabled) and passes them to callback. Call it in main loop;
+/// events of other interrupts (e.g. \c INT2 sources) are handled after return
+/// \param lp State pointer
+/// \return \c HAL_OK if samples were read, \c HAL_BUSY if no samples or error code
+/// \ingroup lsm303power
+uint8_t lsm303_lp_step(lsm303_lp_t* lp);
+
+/// \brief Duty-cycle report
+/// \details Awake time includes current awake period
+/// \param lp State pointer
+/// \param rep Report
+/// \ingroup lsm303power
+void lsm303_lp_report(lsm303_lp_t* lp, lsm303_lp_report_t* rep);
+
+/// \brief Reset duty-cycle report
+/// \param lp State pointer
+/// \ingroup lsm303power
+void lsm303_lp_reset(lsm303_lp_t* lp);
+
+#endif // __LSM303_POWER_H__
@@ -0,0 +1,150 @@
+/// \file lsm303rtos.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303rtos.h"
+
+#ifdef LSM303_RTOS
+
+#include "log.h"
+
+static uint8_t lsm303_rtos_lock(void* ctx)
+{
+    lsm303_rtos_t* rtos = (lsm303_rtos_t*)ctx;
+    if (xSemaphoreTake(rtos->mutex, pdMS_TO_TICKS(LSM303_RTOS_LOCK_TIMEOUT)) != pdTRUE) return HAL_TIMEOUT;
+    // Drop completion of a transfer timed out before
+    xSemaphoreTake(rtos->done, 0);
+    return HAL_OK;
+}
+
+static void lsm303_rtos_unlock(void* ctx)
+{
+    lsm303_rtos_t* rtos = (lsm303_rtos_t*)ctx;
+    xSemaphoreGive(rtos->mutex);
+}
+
+static uint8_t lsm303_rtos_wait(void* ctx, const uint32_t timeout)
+{
+    lsm303_rtos_t* rtos = (lsm303_rtos_t*)ctx;
+    // One tick more: timeout starts in the middle of a tick
+    return xSemaphoreTake(rtos->done, pdMS_TO_TICKS(timeout) + 1U) == pdTRUE ? HAL_OK : HAL_TIMEOUT;
+}
+
+static void lsm303_rtos_signal(void* ctx)
+{
+    lsm303_rtos_t* rtos = (lsm303_rtos_t*)ctx;
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(rtos->done, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void lsm303_rtos_delay(void* ctx, const uint32_t ms)
+{
+    const TickType_t ticks = pdMS_TO_TICKS(ms);
+    vTaskDelay(ticks > 0U ? ticks : 1U);
+}
+
+uint8_t lsm303_rtos_init(lsm303_rtos_t* rtos, SemaphoreHandle_t mutex)
+{
+    if (0 == rtos) return HAL_ERROR;
+    rtos->mutex = mutex != 0 ? mutex : xSemaphoreCreateMutex();
+    rtos->done = xSemaphoreCreateBinary();
+    if (0 == rtos->mutex || 0 == rtos->done) return HAL_ERROR;
+    rtos->port.ctx = rtos;
+    rtos->port.lock = lsm303_rtos_lock;
+    rtos->port.unlock = lsm303_rtos_unlock;
+    rtos->port.wait = lsm303_rtos_wait;
+    rtos->port.signal = lsm303_rtos_signal;
+    rtos->port.delay = lsm303_rtos_delay;
+    return HAL_OK;
+}
+
+// Send filled block to queue
+static void lsm303_acq_send(lsm303_acq_t* acq, lsm303_acq_blk_t* blk)
+{
+    blk->tick = acq->dev->clock != 0 ? acq->dev->clock() : HAL_GetTick();
+    if (xQueueSend(acq->queue, blk, 0) != pdTRUE) acq->dropped++;
+    blk->n = 0U;
+}
+
+// Read accelerometer: one sample or FIFO bursts until FIFO is empty
+static void lsm303_acq_la(lsm303_acq_t* acq)
+{
+    lsm303_acq_blk_t* blk = &acq->blk[LSM303_LA];
+    if (acq->fifo == 0U) {
+        if (lsm303_la_sample(acq->dev, &blk->s[blk->n]) != HAL_OK) return;
+        if (++blk->n == LSM303_RTOS_BLOCK) lsm303_acq_send(acq, blk);
+        return;
+    }
+    uint8_t cnt = 0U;
+    while (lsm303_la_fifo_samples(acq->dev, &blk->s[blk->n], LSM303_RTOS_BLOCK - blk->n, &cnt) == HAL_OK) {
+        blk->n += cnt;
+        if (blk->n == LSM303_RTOS_BLOCK) lsm303_acq_send(acq, blk);
+    }
+}
+
+static void lsm303_acq_mf(lsm303_acq_t* acq)
+{
+    lsm303_acq_blk_t* blk = &acq->blk[LSM303_MF];
+    if (lsm303_mf_sample(acq->dev, &blk->s[blk->n]) != HAL_OK) return;
+    if (++blk->n == LSM303_RTOS_BLOCK) lsm303_acq_send(acq, blk);
+}
+
+static void lsm303_acq_task(void* arg)
+{
+    lsm303_acq_t* acq = (lsm303_acq_t*)arg;
+    for (;;) {
+        uint32_t bits = 0U;
+        // Poll period expired: read all sensors
+        if (xTaskNotifyWait(0U, UINT32_MAX, &bits, acq->period) != pdTRUE) bits = acq->sensors;
+        bits &= acq->sensors;
+        if (bits & (1U << LSM303_LA)) lsm303_acq_la(acq);
+        if (bits & (1U << LSM303_MF)) lsm303_acq_mf(acq);
+    }
+}
+
+uint8_t lsm303_acq_start(lsm303_acq_t* acq, lsm303_dev_t* dev, const uint8_t sensors, const uint8_t fifo, const TickType_t period, const UBaseType_t depth, const UBaseType_t prio)
+{
+    if (0 == acq || 0 == dev || 0 == dev->port || depth == 0U) return HAL_ERROR;
+    acq->dev = dev;
+    acq->period = period;
+    acq->sensors = sensors & ((1U << LSM303_LA) | (1U << LSM303_MF));
+    acq->fifo = fifo == 0U ? 0U : 1U;
+    acq->dropped = 0U;
+    for (uint8_t i = 0; i < 2U; ++i) {
+        acq->blk[i].sensor = (lsm303_sensor_t)i;
+        acq->blk[i].n = 0U;
+    }
+    acq->task = 0;
+    acq->queue = xQueueCreate(depth, sizeof(lsm303_acq_blk_t));
+    if (0 == acq->queue) return HAL_ERROR;
+    if (xTaskCreate(lsm303_acq_task, "lsm303", LSM303_RTOS_STACK, acq, prio, &acq->task) != pdPASS) {
+        xError("LSM303 acquisition task is not created\n");
+        vQueueDelete(acq->queue);
+        acq->queue = 0;
+        return HAL_ERROR;
+    }
+    return HAL_OK;
+}
+
+void lsm303_acq_irq(lsm303_acq_t* acq, const lsm303_sensor_t sensor)
+{
+    if (0 == acq || 0 == acq->task) return;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(acq->task, 1UL << sensor, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+uint8_t lsm303_acq_pop(lsm303_acq_t* acq, lsm303_acq_blk_t* blk, const TickType_t timeout)
+{
+    if (0 == acq || 0 == acq->queue || 0 == blk) return HAL_ERROR;
+    return xQueueReceive(acq->queue, blk, timeout) == pdTRUE ? HAL_OK : HAL_BUSY;
+}
+
+uint32_t lsm303_acq_dropped(const lsm303_acq_t* acq)
+{
+    return acq->dropped;
+}
+
+#endif // LSM303_RTOS
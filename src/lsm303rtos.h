@@ -0,0 +1,121 @@
+/// \file lsm303rtos.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_RTOS_H__
+#define __LSM303_RTOS_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303rtos 9. LSM303 RTOS Port
+/// \brief FreeRTOS port: shared bus mutex, transfer completion semaphore and acquisition task
+/// \details Define \c LSM303_RTOS in build flags and add FreeRTOS include paths. Without \c LSM303_RTOS the module is empty.
+/// \details Bus port: blocking transfers take the bus mutex (shared with other drivers of the I2C bus), start interrupt transfer
+/// and block on completion semaphore given by \b lsm303_rx_cplt, \b lsm303_tx_cplt or \b lsm303_rx_error.
+/// \details Acquisition task reads samples on data ready or FIFO watermark interrupt (\b lsm303_acq_irq) or by poll period
+/// and sends blocks of \c LSM303_RTOS_BLOCK samples to a queue: consumer tasks run at block rate, not at data rate
+
+#ifdef LSM303_RTOS
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "queue.h"
+#include "task.h"
+
+/// \brief Samples of queue block
+/// \details Define it in build flags to override
+/// \ingroup lsm303rtos
+#ifndef LSM303_RTOS_BLOCK
+# define LSM303_RTOS_BLOCK 8U
+#endif
+
+/// \brief Bus mutex timeout, ms
+/// \details Define it in build flags to override
+/// \ingroup lsm303rtos
+#ifndef LSM303_RTOS_LOCK_TIMEOUT
+# define LSM303_RTOS_LOCK_TIMEOUT 100U
+#endif
+
+/// \brief Stack of acquisition task, words
+/// \details Define it in build flags to override
+/// \ingroup lsm303rtos
+#ifndef LSM303_RTOS_STACK
+# define LSM303_RTOS_STACK 256U
+#endif
+
+/// \brief FreeRTOS bus port
+/// \details One per I2C bus: devices of the bus share it
+/// \ingroup lsm303rtos
+typedef struct {
+    SemaphoreHandle_t mutex;    ///< Bus mutex, shared with other drivers of the bus
+    SemaphoreHandle_t done;     ///< Transfer completion
+    lsm303_port_t port;         ///< Port passed to \b lsm303_port
+} lsm303_rtos_t;
+
+/// \brief Block of samples
+/// \ingroup lsm303rtos
+typedef struct {
+    uint32_t tick;                          ///< Timestamp (lsm303_dev_t::clock) of the last sample read
+    lsm303_sensor_t sensor;                 ///< Sensor
+    uint8_t n;                              ///< Samples
+    lsm303_sample_t s[LSM303_RTOS_BLOCK];   ///< Samples
+} lsm303_acq_blk_t;
+
+/// \brief Acquisition task state
+/// \ingroup lsm303rtos
+typedef struct {
+    lsm303_dev_t* dev;                      ///< Device handler
+    QueueHandle_t queue;                    ///< Queue of lsm303_acq_blk_t
+    TaskHandle_t task;                      ///< Acquisition task
+    TickType_t period;                      ///< Poll period or \c portMAX_DELAY - interrupts only
+    uint8_t sensors;                        ///< Sensors bit mask: <tt>1 << LSM303_LA</tt>, <tt>1 << LSM303_MF</tt>
+    uint8_t fifo;                           ///< Accelerometer is read by FIFO bursts
+    lsm303_acq_blk_t blk[2];                ///< Blocks being filled
+    volatile uint32_t dropped;              ///< Blocks dropped by full queue
+} lsm303_acq_t;
+
+/// \brief FreeRTOS bus port initialization
+/// \details Attach it to devices by <tt>lsm303_port(dev, &rtos->port)</tt>
+/// \param rtos Port
+/// \param mutex Bus mutex shared with other drivers or \c 0 - create new one
+/// \return \c HAL_OK if success or \c HAL_ERROR if semaphores are not created
+/// \ingroup lsm303rtos
+uint8_t lsm303_rtos_init(lsm303_rtos_t* rtos, SemaphoreHandle_t mutex);
+
+/// \brief Start acquisition task
+/// \param acq State, valid while task runs
+/// \param dev Device handler with bus port. Sensors must be configured
+/// \param sensors Sensors bit mask: <tt>1 << LSM303_LA</tt>, <tt>1 << LSM303_MF</tt>
+/// \param fifo Accelerometer FIFO: \c 0 - sample reads, \c 1 - FIFO bursts (stream mode, watermark interrupt)
+/// \param period Poll period or \c portMAX_DELAY - interrupts only
+/// \param depth Queue depth, blocks
+/// \param prio Task priority
+/// \return \c HAL_OK if success or \c HAL_ERROR
+/// \ingroup lsm303rtos
+uint8_t lsm303_acq_start(lsm303_acq_t* acq, lsm303_dev_t* dev, const uint8_t sensors, const uint8_t fifo, const TickType_t period, const UBaseType_t depth, const UBaseType_t prio);
+
+/// \brief Data ready or FIFO watermark interrupt handler
+/// \details Call it from \c HAL_GPIO_EXTI_Callback: notifies acquisition task
+/// \param acq State
+/// \param sensor Sensor
+/// \ingroup lsm303rtos
+void lsm303_acq_irq(lsm303_acq_t* acq, const lsm303_sensor_t sensor);
+
+/// \brief Receive block of samples
+/// \param acq State
+/// \param blk Block
+/// \param timeout Timeout, ticks
+/// \return \c HAL_OK if success or \c HAL_BUSY by timeout
+/// \ingroup lsm303rtos
+uint8_t lsm303_acq_pop(lsm303_acq_t* acq, lsm303_acq_blk_t* blk, const TickType_t timeout);
+
+/// \brief Dropped blocks
+/// \param acq State
+/// \return Blocks dropped by full queue
+/// \ingroup lsm303rtos
+uint32_t lsm303_acq_dropped(const lsm303_acq_t* acq);
+
+#endif // LSM303_RTOS
+
+#endif // __LSM303_RTOS_H__
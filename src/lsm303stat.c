@@ -0,0 +1,184 @@
+/// \file lsm303stat.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303stat.h"
+
+#include <math.h>
+
+uint8_t lsm303_stat_init(lsm303_stat_t* s, const uint16_t window, const uint16_t hop, lsm303_stat_smpl_t* ring, uint16_t* dq)
+{
+    if (0 == s || window < 2U) return HAL_ERROR;
+    if ((0 == ring) != (0 == dq)) return HAL_ERROR;
+    if (0 != ring && (hop == 0U || hop > window)) return HAL_ERROR;
+    s->window = window;
+    s->hop = 0 != ring ? hop : window;
+    s->ring = ring;
+    s->dq = dq;
+    lsm303_stat_reset(s);
+    return HAL_OK;
+}
+
+void lsm303_stat_reset(lsm303_stat_t* s)
+{
+    for (uint8_t i = 0; i < 6U; ++i) s->dqh[i] = s->dqn[i] = 0U;
+    for (uint8_t i = 0; i < 3U; ++i) {
+        s->mean[i] = s->m2[i] = 0.0F;
+        s->zc[i] = 0U;
+    }
+    s->abs = 0.0F;
+    s->pos = 0U;
+    s->n = 0U;
+    s->since = 0U;
+    s->init = 0U;
+    s->side = 0U;
+}
+
+// Crossings of center by new sample: bits 0..2
+static uint8_t lsm303_stat_cross(lsm303_stat_t* s, const float v[3])
+{
+    uint8_t side = 0U;
+    for (uint8_t i = 0; i < 3U; ++i) {
+        // First sample is the center
+        if (s->init == 0U) s->c[i] = v[i];
+        s->last[i] = v[i];
+        if (v[i] >= s->c[i]) side |= 1U << i;
+    }
+    const uint8_t zc = s->init == 0U ? 0U : (uint8_t)(side ^ s->side);
+    s->init = 1U;
+    s->side = side;
+    return zc;
+}
+
+// Monotonic queue k (0..2 - maximum, 3..5 - minimum): push ring position p
+static void lsm303_stat_push(lsm303_stat_t* s, const uint8_t k, const uint16_t p)
+{
+    const uint16_t N = s->window;
+    uint16_t* const q = &s->dq[k * N];
+    const uint8_t c = k % 3U;
+    const float v = s->ring[p].v[c];
+    // Drop samples dominated by the new one from the back
+    while (s->dqn[k] != 0U) {
+        uint16_t b = s->dqh[k] + s->dqn[k] - 1U;
+        if (b >= N) b -= N;
+        const float w = s->ring[q[b]].v[c];
+        if (k < 3U ? w > v : w < v) break;
+        s->dqn[k]--;
+    }
+    uint16_t t = s->dqh[k] + s->dqn[k];
+    if (t >= N) t -= N;
+    q[t] = p;
+    s->dqn[k]++;
+}
+
+// Monotonic queue k: evict ring position p of the oldest sample
+static void lsm303_stat_evict(lsm303_stat_t* s, const uint8_t k, const uint16_t p)
+{
+    if (s->dqn[k] == 0U || s->dq[k * s->window + s->dqh[k]] != p) return;
+    if (++s->dqh[k] == s->window) s->dqh[k] = 0U;
+    s->dqn[k]--;
+}
+
+static void lsm303_stat_emit(lsm303_stat_t* s, lsm303_feat_t* f)
+{
+    const float n = (float)s->n;
+    for (uint8_t i = 0; i < 3U; ++i) {
+        const float var = s->m2[i] > 0.0F ? s->m2[i] / n : 0.0F;
+        f->mean[i] = s->mean[i];
+        f->var[i] = var;
+        f->rms[i] = sqrtf(s->mean[i] * s->mean[i] + var);
+        f->zc[i] = s->zc[i];
+        if (0 == s->ring) {
+            f->p2p[i] = s->hi[i] - s->lo[i];
+        }
+        else {
+            const uint16_t N = s->window;
+            f->p2p[i] = s->ring[s->dq[i * N + s->dqh[i]]].v[i] - s->ring[s->dq[(i + 3U) * N + s->dqh[i + 3U]]].v[i];
+        }
+        // Crossings of the next features around this mean
+        s->c[i] = s->mean[i];
+    }
+    f->sma = s->abs / n;
+    f->n = s->n;
+    // Side of the last sample around the new center
+    s->side = 0U;
+    for (uint8_t i = 0; i < 3U; ++i) {
+        if (s->last[i] >= s->c[i]) s->side |= 1U << i;
+    }
+}
+
+uint8_t lsm303_stat_step(lsm303_stat_t* s, const float x, const float y, const float z, lsm303_feat_t* f)
+{
+    const float v[3] = { x, y, z };
+    const uint8_t zc = lsm303_stat_cross(s, v);
+
+    if (0 == s->ring) {
+        // Tumbling window: running accumulators
+        const float n = (float)++s->n;
+        for (uint8_t i = 0; i < 3U; ++i) {
+            const float d = v[i] - s->mean[i];
+            s->mean[i] += d / n;
+            s->m2[i] += d * (v[i] - s->mean[i]);
+            if (s->n == 1U || v[i] < s->lo[i]) s->lo[i] = v[i];
+            if (s->n == 1U || v[i] > s->hi[i]) s->hi[i] = v[i];
+            s->zc[i] += (zc >> i) & 1U;
+        }
+        s->abs += fabsf(x) + fabsf(y) + fabsf(z);
+        if (s->n < s->window) return 0U;
+        lsm303_stat_emit(s, f);
+        for (uint8_t i = 0; i < 3U; ++i) {
+            s->mean[i] = s->m2[i] = 0.0F;
+            s->zc[i] = 0U;
+        }
+        s->abs = 0.0F;
+        s->n = 0U;
+        return 1U;
+    }
+
+    // Sliding window: remove the oldest sample
+    const uint16_t p = s->pos;
+    lsm303_stat_smpl_t* const o = &s->ring[p];
+    if (s->n == s->window) {
+        const float n = (float)--s->n;
+        for (uint8_t i = 0; i < 3U; ++i) {
+            const float d = o->v[i] - s->mean[i];
+            s->mean[i] -= d / n;
+            s->m2[i] -= d * (o->v[i] - s->mean[i]);
+            s->zc[i] -= (o->zc >> i) & 1U;
+        }
+        s->abs -= fabsf(o->v[0]) + fabsf(o->v[1]) + fabsf(o->v[2]);
+        for (uint8_t k = 0; k < 6U; ++k) lsm303_stat_evict(s, k, p);
+    }
+    // Add the new sample
+    o->v[0] = x;
+    o->v[1] = y;
+    o->v[2] = z;
+    o->zc = zc;
+    const float n = (float)++s->n;
+    for (uint8_t i = 0; i < 3U; ++i) {
+        const float d = v[i] - s->mean[i];
+        s->mean[i] += d / n;
+        s->m2[i] += d * (v[i] - s->mean[i]);
+        s->zc[i] += (zc >> i) & 1U;
+    }
+    s->abs += fabsf(x) + fabsf(y) + fabsf(z);
+    for (uint8_t k = 0; k < 6U; ++k) lsm303_stat_push(s, k, p);
+    s->pos = p + 1U == s->window ? 0U : p + 1U;
+
+    if (++s->since < s->hop || s->n < s->window) return 0U;
+    s->since = 0U;
+    lsm303_stat_emit(s, f);
+    return 1U;
+}
+
+uint16_t lsm303_stat_samples(lsm303_stat_t* s, const lsm303_sample_t* in, const uint16_t n, lsm303_feat_t* f, const uint16_t max)
+{
+    uint16_t k = 0U;
+    lsm303_feat_t tmp;
+    for (uint16_t i = 0; i < n; ++i) {
+        lsm303_feat_t* const dst = k < max ? &f[k] : &tmp;
+        if (lsm303_stat_step(s, in[i].x, in[i].y, in[i].z, dst) != 0U && k < max) ++k;
+    }
+    return k;
+}
@@ -0,0 +1,104 @@
+/// \file lsm303stat.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_STAT_H__
+#define __LSM303_STAT_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303stat 12. LSM303 Window Features
+/// \brief Windowed statistics of accelerometer or magnetometer stream for activity classification
+/// \details Per axis: mean, population variance (Welford), RMS, peak-to-peak and crossings of the mean of the previous
+/// window; signal magnitude area <tt>sum(|x| + |y| + |z|) / n</tt> (pass gravity-free data for body acceleration).
+/// \details Tumbling window: running accumulators, features every \c window samples, no sample memory.
+/// Sliding window: samples ring and monotonic queues of minimum and maximum, features every \c hop samples.
+/// Update cost is O(1) per sample (amortized for peak-to-peak of sliding window), memory is caller-owned and fixed by \c window.
+/// \details One engine per stream: accelerometer and magnetometer have separate states
+
+/// \brief Monotonic queues size of sliding window of \c window samples, \c uint16_t items
+/// \ingroup lsm303stat
+#define LSM303_STAT_DQ(window) (6U * (window))
+
+/// \brief Sample of sliding window ring
+/// \ingroup lsm303stat
+typedef struct {
+    float v[3];     ///< X, Y and Z axis
+    uint8_t zc;     ///< Crossings of X, Y and Z axis: bits \c 0..2
+} lsm303_stat_smpl_t;
+
+/// \brief Window features
+/// \ingroup lsm303stat
+typedef struct {
+    float mean[3];  ///< Mean
+    float var[3];   ///< Population variance
+    float rms[3];   ///< Root mean square
+    float p2p[3];   ///< Peak-to-peak
+    uint16_t zc[3]; ///< Crossings of the mean of the previous window
+    float sma;      ///< Signal magnitude area
+    uint16_t n;     ///< Samples of window
+} lsm303_feat_t;
+
+/// \brief Window features engine state
+/// \details Caller-owned state of \b lsm303_stat_step. Initialize it by \b lsm303_stat_init
+/// \ingroup lsm303stat
+typedef struct {
+    uint16_t window;            ///< Window size, samples
+    uint16_t hop;               ///< Samples between features of sliding window
+    lsm303_stat_smpl_t* ring;   ///< Samples ring of sliding window, \c window items, or \c 0 - tumbling window
+    uint16_t* dq;               ///< Monotonic queues of sliding window, \c LSM303_STAT_DQ(window) items
+    uint16_t dqh[6];            ///< Queue heads: maximum of X, Y, Z, minimum of X, Y, Z
+    uint16_t dqn[6];            ///< Queue sizes
+    uint16_t pos;               ///< Ring position of the oldest sample
+    uint16_t n;                 ///< Samples in window
+    uint16_t since;             ///< Samples since the last features
+    uint8_t init;               ///< Crossing center is set
+    uint8_t side;               ///< Last sample is above crossing center: bits \c 0..2
+    float mean[3];              ///< Running mean
+    float m2[3];                ///< Running sum of squared deviations
+    float lo[3];                ///< Minimum of tumbling window
+    float hi[3];                ///< Maximum of tumbling window
+    float c[3];                 ///< Crossing center
+    float last[3];              ///< Last sample
+    float abs;                  ///< Running sum of <tt>|x| + |y| + |z|</tt>
+    uint16_t zc[3];             ///< Running crossings
+} lsm303_stat_t;
+
+/// \brief Window features engine initialization
+/// \param s State pointer
+/// \param window Window size, samples (\c 2 or more)
+/// \param hop Samples between features of sliding window (\c 1 .. \c window), not used by tumbling window
+/// \param ring Samples ring, \c window items, or \c 0 for tumbling window
+/// \param dq Monotonic queues, \c LSM303_STAT_DQ(window) items, or \c 0 for tumbling window
+/// \return \c HAL_OK or \c HAL_ERROR for wrong parameters
+/// \ingroup lsm303stat
+uint8_t lsm303_stat_init(lsm303_stat_t* s, const uint16_t window, const uint16_t hop, lsm303_stat_smpl_t* ring, uint16_t* dq);
+
+/// \brief Window features engine reset
+/// \details Clear window, parameters are kept
+/// \param s State pointer
+/// \ingroup lsm303stat
+void lsm303_stat_reset(lsm303_stat_t* s);
+
+/// \brief Window features engine step
+/// \param s State pointer
+/// \param x X axis
+/// \param y Y axis
+/// \param z Z axis
+/// \param f Features
+/// \return \c 1 if features of window are written to \c f or \c 0
+/// \ingroup lsm303stat
+uint8_t lsm303_stat_step(lsm303_stat_t* s, const float x, const float y, const float z, lsm303_feat_t* f);
+
+/// \brief Window features engine for block of samples
+/// \param s State pointer
+/// \param in Samples, e.g. by \b lsm303_la_fifo_samples or \b lsm303_dec_samples
+/// \param n Number of samples
+/// \param f Features
+/// \param max Features array size: samples after the last room are processed, their features are dropped
+/// \return Number of features written
+/// \ingroup lsm303stat
+uint16_t lsm303_stat_samples(lsm303_stat_t* s, const lsm303_sample_t* in, const uint16_t n, lsm303_feat_t* f, const uint16_t max);
+
+#endif // __LSM303_STAT_H__
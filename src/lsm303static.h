@@ -0,0 +1,122 @@
+/// \file lsm303static.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_STATIC_H__
+#define __LSM303_STATIC_H__
+
+/// \defgroup lsm303static 14. LSM303 Static Configuration
+/// \brief Build-time data rate, full-scale, power mode and gain (\c LSM303_STATIC)
+/// \details With build flag \c -DLSM303_STATIC accelerometer data shift and sensitivity are compile-time constants:
+/// sample conversion inlines to a constant shift and a multiply by a known constant instead of loads of
+/// lsm303_dev_t::ashift and lsm303_dev_t::alsb. Sensors are configured by \b lsm303_static_setup from precomputed
+/// register images, one burst per sensor.
+/// \details Override configuration by build flags, e.g. <tt>-DLSM303_STATIC_AFS=LSM303_AFS_8G -DLSM303_STATIC_AHR=0</tt>.
+/// Data rate setters keep working; setters of full-scale, low-power / high-resolution mode and gain return \c HAL_ERROR
+/// for configuration other than static one, so \b lsm303adapt (runtime power mode) needs it disabled.
+/// \details Magnetometer conversion is one precomputed affine transform (lsm303_dev_t::mW) of sensitivity and
+/// calibration already, static gain only fixes it
+
+/// \brief Static accelerometer data rate, lsm303_la_datarate_t
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_AODR
+# define LSM303_STATIC_AODR LSM303_ADATARATE_400
+#endif
+
+/// \brief Static accelerometer low-power mode: \c 0 or \c 1 (high-resolution mode wins)
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_ALP
+# define LSM303_STATIC_ALP 0
+#endif
+
+/// \brief Static accelerometer high-resolution mode: \c 0 or \c 1
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_AHR
+# define LSM303_STATIC_AHR 1
+#endif
+
+/// \brief Static accelerometer full-scale, lsm303_la_fs_t
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_AFS
+# define LSM303_STATIC_AFS LSM303_AFS_4G
+#endif
+
+/// \brief Static temperature sensor enable: \c 0 or \c 1
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_MTEMP
+# define LSM303_STATIC_MTEMP 0
+#endif
+
+/// \brief Static magnetometer data rate, lsm303_mf_do_t
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_MODR
+# define LSM303_STATIC_MODR LSM303_MDATARATE_220
+#endif
+
+/// \brief Static magnetometer gain, lsm303_mf_gain_t
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_MGAIN
+# define LSM303_STATIC_MGAIN LSM303_MGAIN_1_3
+#endif
+
+/// \brief Static magnetometer mode, lsm303_mf_md_t
+/// \ingroup lsm303static
+#ifndef LSM303_STATIC_MMODE
+# define LSM303_STATIC_MMODE LSM303_MMODE_CONTINUOUS
+#endif
+
+/// \brief Effective low-power mode
+/// \ingroup lsm303static
+#define LSM303_STATIC_ALPE ((LSM303_STATIC_ALP) != 0 && (LSM303_STATIC_AHR) == 0)
+
+/// \brief Accelerometer data bit shift
+/// \ingroup lsm303static
+#define LSM303_STATIC_ASHIFT ((LSM303_STATIC_AHR) != 0 ? 4U : LSM303_STATIC_ALPE ? 8U : 6U)
+
+/// \brief Accelerometer sensitivity \a g/LSB, the same table as \b lsm303_la_setup
+/// \ingroup lsm303static
+#define LSM303_STATIC_ALSB ( \
+    (LSM303_STATIC_AHR) != 0 ? ( \
+        (LSM303_STATIC_AFS) == LSM303_AFS_2G ? 0.00098F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_4G ? 0.00195F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_8G ? 0.0039F : 0.01172F) : \
+    LSM303_STATIC_ALPE ? ( \
+        (LSM303_STATIC_AFS) == LSM303_AFS_2G ? 0.01563F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_4G ? 0.03126F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_8G ? 0.06252F : 0.18758F) : ( \
+        (LSM303_STATIC_AFS) == LSM303_AFS_2G ? 0.0039F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_4G ? 0.00782F : \
+        (LSM303_STATIC_AFS) == LSM303_AFS_8G ? 0.01563F : 0.0469F))
+
+/// \brief \c CTRL_REG1_A image: data rate, low-power mode, X, Y and Z axis enabled
+/// \ingroup lsm303static
+#define LSM303_STATIC_CTRL_REG1_A ((uint8_t)((LSM303_STATIC_AODR) << 4 | (LSM303_STATIC_ALPE ? 0x08U : 0U) | 0x07U))
+
+/// \brief \c CTRL_REG4_A image: full-scale and high-resolution mode
+/// \ingroup lsm303static
+#define LSM303_STATIC_CTRL_REG4_A ((uint8_t)((LSM303_STATIC_AFS) << 4 | ((LSM303_STATIC_AHR) != 0 ? 0x08U : 0U)))
+
+/// \brief \c CRA_REG_M image: temperature sensor and data rate
+/// \ingroup lsm303static
+#define LSM303_STATIC_CRA_REG_M ((uint8_t)(((LSM303_STATIC_MTEMP) != 0 ? 0x80U : 0U) | (LSM303_STATIC_MODR) << 2))
+
+/// \brief \c CRB_REG_M image: gain
+/// \ingroup lsm303static
+#define LSM303_STATIC_CRB_REG_M ((uint8_t)((LSM303_STATIC_MGAIN) << 5))
+
+/// \brief \c MR_REG_M image: mode
+/// \ingroup lsm303static
+#define LSM303_STATIC_MR_REG_M ((uint8_t)(LSM303_STATIC_MMODE))
+
+/// \brief Accelerometer data bit shift and sensitivity of device: constants or lsm303_dev_t::ashift and lsm303_dev_t::alsb
+/// \ingroup lsm303static
+#ifdef LSM303_STATIC
+# define LSM303_ASHIFT(dev) LSM303_STATIC_ASHIFT
+# define LSM303_ALSB(dev) LSM303_STATIC_ALSB
+#else
+# define LSM303_ASHIFT(dev) ((dev)->ashift)
+# define LSM303_ALSB(dev) ((dev)->alsb)
+#endif
+
+#endif // __LSM303_STATIC_H__
@@ -0,0 +1,76 @@
+/// \file lsm303sync.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303sync.h"
+
+// Signed difference of timestamps: wrap around safe
+static inline int32_t lsm303_dt(const uint32_t a, const uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+uint8_t lsm303_sync_init(lsm303_sync_t* s, lsm303_dev_t* dev, const lsm303_sync_mode_t mode)
+{
+    if (0 == s || 0 == dev) return HAL_ERROR;
+    s->dev = dev;
+    s->mode = mode;
+    s->mcnt = 0U;
+    s->apend = 0U;
+    return HAL_OK;
+}
+
+// Pop magnetometer samples until latest one is newer than accelerometer sample
+static void lsm303_sync_fill(lsm303_sync_t* s)
+{
+    while (s->mcnt == 0U || lsm303_dt(s->m[1].tick, s->a.tick) < 0) {
+        lsm303_raw_t m;
+        if (lsm303_pop(s->dev, LSM303_MF, &m) != HAL_OK) return;
+        s->m[0] = s->m[1];
+        s->m[1] = m;
+        if (s->mcnt < 2U) s->mcnt++;
+    }
+}
+
+uint8_t lsm303_sync_pop(lsm303_sync_t* s, lsm303_pair_t* pair)
+{
+    if (0 == s || 0 == s->dev || 0 == pair) return HAL_ERROR;
+    for (;;) {
+        if (s->apend == 0U) {
+            if (lsm303_pop(s->dev, LSM303_LA, &s->a) != HAL_OK) return HAL_BUSY;
+            s->apend = 1U;
+        }
+        lsm303_sync_fill(s);
+        // Index of the latest magnetometer sample not newer than accelerometer sample
+        int8_t i = -1;
+        if (s->mcnt > 0U && lsm303_dt(s->m[1].tick, s->a.tick) <= 0) i = 1;
+        else if (s->mcnt > 1U && lsm303_dt(s->m[0].tick, s->a.tick) <= 0) i = 0;
+        if (i < 0) {
+            // No magnetometer sample before accelerometer sample
+            s->apend = 0U;
+            continue;
+        }
+        float w = 0.0F;
+        if (s->mode == LSM303_SYNC_LERP) {
+            // Wait for the magnetometer sample after accelerometer sample
+            if (i == 1) return HAL_BUSY;
+            const int32_t span = lsm303_dt(s->m[1].tick, s->m[0].tick);
+            if (span > 0) w = (float)lsm303_dt(s->a.tick, s->m[0].tick) / (float)span;
+        }
+        const lsm303_raw_t* m0 = &s->m[i];
+        const lsm303_raw_t* m1 = &s->m[1];
+        const float mr[3] = {
+            (float)m0->x + w * (float)(m1->x - m0->x),
+            (float)m0->y + w * (float)(m1->y - m0->y),
+            (float)m0->z + w * (float)(m1->z - m0->z)
+        };
+        pair->tick = s->a.tick;
+        pair->a[0] = (float)s->a.x * LSM303_ALSB(s->dev);
+        pair->a[1] = (float)s->a.y * LSM303_ALSB(s->dev);
+        pair->a[2] = (float)s->a.z * LSM303_ALSB(s->dev);
+        lsm303_mf_apply(s->dev, mr, pair->m);
+        s->apend = 0U;
+        return HAL_OK;
+    }
+}
@@ -0,0 +1,61 @@
+/// \file lsm303sync.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_SYNC_H__
+#define __LSM303_SYNC_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303sync 6. LSM303 Synchronization
+/// \brief Time-aligned accelerometer and magnetometer pairs
+/// \details Both sensors run at own data rates by data ready sampling (\b lsm303_la_drdy, \b lsm303_drdy_irq):
+/// every sample is timestamped by lsm303_dev_t::clock in the interrupt and stored into ring buffer, no reads are retried.
+/// \details Pairs follow the accelerometer timeline: each accelerometer sample is paired with the magnetometer
+/// sample held at its timestamp or interpolated between two magnetometer samples around it.
+/// \details Timestamps are compared by signed difference, so clock may wrap around
+
+/// \brief Magnetometer alignment mode
+/// \ingroup lsm303sync
+typedef enum {
+    LSM303_SYNC_HOLD   = 0, ///< Latest magnetometer sample not newer than accelerometer sample
+    LSM303_SYNC_LERP   = 1  ///< Linear interpolation between magnetometer samples around accelerometer sample (one magnetometer period of latency)
+} lsm303_sync_mode_t;
+
+/// \brief Time-aligned pair
+/// \ingroup lsm303sync
+typedef struct {
+    uint32_t tick;      ///< Timestamp of accelerometer sample
+    float a[3];         ///< Linear acceleration, \b g
+    float m[3];         ///< Magnetic field, \b uT
+} lsm303_pair_t;
+
+/// \brief Synchronization state
+/// \ingroup lsm303sync
+typedef struct {
+    lsm303_dev_t* dev;          ///< Device handler
+    lsm303_sync_mode_t mode;    ///< Alignment mode
+    lsm303_raw_t m[2];          ///< Previous and latest magnetometer samples
+    uint8_t mcnt;               ///< Valid magnetometer samples (\c 0 .. \c 2)
+    lsm303_raw_t a;             ///< Accelerometer sample waiting for magnetometer
+    uint8_t apend;              ///< Accelerometer sample is waiting
+} lsm303_sync_t;
+
+/// \brief Synchronization initialization
+/// \param s State pointer
+/// \param dev Device handler with data ready sampling of both sensors
+/// \param mode Alignment mode
+/// \return \c HAL_OK or \c HAL_ERROR
+/// \ingroup lsm303sync
+uint8_t lsm303_sync_init(lsm303_sync_t* s, lsm303_dev_t* dev, const lsm303_sync_mode_t mode);
+
+/// \brief Pop time-aligned pair
+/// \details Call it from main loop until \c HAL_BUSY. Accelerometer samples without magnetometer sample before them are dropped
+/// \param s State pointer
+/// \param pair Pair pointer
+/// \return \c HAL_OK if success, \c HAL_BUSY if no pairs or error code
+/// \ingroup lsm303sync
+uint8_t lsm303_sync_pop(lsm303_sync_t* s, lsm303_pair_t* pair);
+
+#endif // __LSM303_SYNC_H__
@@ -0,0 +1,193 @@
+/// \file lsm303tlm.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303tlm.h"
+
+static inline void put16(uint8_t* buf, const uint16_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t* buf, const uint32_t v)
+{
+    put16(&buf[0], (uint16_t)v);
+    put16(&buf[2], (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get16(const uint8_t* buf)
+{
+    return (uint16_t)(buf[0] | buf[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t* buf)
+{
+    return (uint32_t)get16(&buf[0]) | (uint32_t)get16(&buf[2]) << 16;
+}
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial 0xFFFF, nibble table
+static uint16_t lsm303_tlm_crc(const uint8_t* buf, const uint16_t size)
+{
+    static const uint16_t tbl[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    uint16_t crc = 0xFFFFU;
+    for (uint16_t i = 0; i < size; ++i) {
+        crc = (uint16_t)(crc << 4) ^ tbl[(crc >> 12) ^ (buf[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ tbl[(crc >> 12) ^ (buf[i] & 0x0FU)];
+    }
+    return crc;
+}
+
+// Zigzag varint of 16-bit delta: 1..3 bytes
+static inline uint16_t lsm303_tlm_put(uint8_t* buf, const int16_t prev, const int16_t v)
+{
+    const int32_t d = (int32_t)v - prev;
+    uint32_t u = d < 0 ? ((uint32_t)(-d) << 1) - 1U : (uint32_t)d << 1;
+    uint16_t n = 0U;
+    while (u >= 0x80U) {
+        buf[n++] = (uint8_t)(u | 0x80U);
+        u >>= 7;
+    }
+    buf[n++] = (uint8_t)u;
+    return n;
+}
+
+// Header and CRC of payload size
+static uint16_t lsm303_tlm_frame(uint8_t* buf, const uint16_t payload, const uint16_t seq, const uint8_t flags, const uint8_t n, const uint32_t tick, const uint16_t dt)
+{
+    const uint16_t end = LSM303_TLM_HDR_SIZE + payload;
+    buf[0] = LSM303_TLM_SYNC0;
+    buf[1] = LSM303_TLM_SYNC1;
+    put16(&buf[2], payload);
+    put16(&buf[4], seq);
+    buf[6] = flags;
+    buf[7] = n;
+    put32(&buf[8], tick);
+    put16(&buf[12], dt);
+    put16(&buf[end], lsm303_tlm_crc(&buf[2], end - 2U));
+    return end + 2U;
+}
+
+static void lsm303_tlm_begin(lsm303_tlm_t* t)
+{
+    t->n = 0U;
+    t->pos = LSM303_TLM_HDR_SIZE;
+    t->prev[0] = t->prev[1] = t->prev[2] = 0;
+}
+
+uint8_t lsm303_tlm_init(lsm303_tlm_t* t, const lsm303_sensor_t sensor, const uint8_t block)
+{
+    if (0 == t || block == 0U || block > LSM303_TLM_MAX) return HAL_ERROR;
+    t->sensor = sensor;
+    t->block = block;
+    t->seq = 0U;
+    lsm303_tlm_begin(t);
+    return HAL_OK;
+}
+
+uint16_t lsm303_tlm_add(lsm303_tlm_t* t, const lsm303_raw_t* smpl)
+{
+    if (t->n == 0U) t->tick = smpl->tick;
+    t->last = smpl->tick;
+    t->pos += lsm303_tlm_put(&t->buf[t->pos], t->prev[0], smpl->x);
+    t->pos += lsm303_tlm_put(&t->buf[t->pos], t->prev[1], smpl->y);
+    t->pos += lsm303_tlm_put(&t->buf[t->pos], t->prev[2], smpl->z);
+    t->prev[0] = smpl->x;
+    t->prev[1] = smpl->y;
+    t->prev[2] = smpl->z;
+    if (++t->n < t->block) return 0U;
+    return lsm303_tlm_flush(t);
+}
+
+uint16_t lsm303_tlm_flush(lsm303_tlm_t* t)
+{
+    if (t->n == 0U) return 0U;
+    const uint32_t span = t->last - t->tick;
+    const uint32_t dt = t->n > 1U ? (span + (t->n - 1U) / 2U) / (t->n - 1U) : 0U;
+    const uint16_t size = lsm303_tlm_frame(t->buf, t->pos - LSM303_TLM_HDR_SIZE, t->seq++, (uint8_t)t->sensor & 0x03U, t->n,
+        t->tick, dt > 0xFFFFU ? 0xFFFFU : (uint16_t)dt);
+    lsm303_tlm_begin(t);
+    return size;
+}
+
+uint16_t lsm303_tlm_instr(lsm303_tlm_t* t, const lsm303_instr_t* in, const uint32_t tick, uint8_t* buf)
+{
+    uint8_t* p = &buf[LSM303_TLM_HDR_SIZE];
+    const uint32_t v[] = { in->samples, in->overrun, in->notready, in->period, in->intervals, in->imin, in->imax };
+    for (uint8_t i = 0; i < sizeof(v) / sizeof(v[0]); ++i, p += 4) put32(p, v[i]);
+    for (uint8_t i = 0; i < LSM303_INSTR_BINS; ++i, p += 4) put32(p, in->hist[i]);
+    put32(&p[0], in->reads);
+    put32(&p[4], in->bus_max);
+    put32(&p[8], (uint32_t)in->bus);
+    put32(&p[12], (uint32_t)(in->bus >> 32));
+    put32(&p[16], in->lat_n);
+    put32(&p[20], in->lat_max);
+    put32(&p[24], (uint32_t)in->lat);
+    put32(&p[28], (uint32_t)(in->lat >> 32));
+    p += 32;
+    const uint16_t payload = (uint16_t)(p - &buf[LSM303_TLM_HDR_SIZE]);
+    return lsm303_tlm_frame(buf, payload, t->seq++, LSM303_TLM_INSTR | ((uint8_t)t->sensor & 0x03U), 0U, tick, 0U);
+}
+
+uint8_t lsm303_tlm_parse(const uint8_t* buf, const uint16_t size, lsm303_tlm_hdr_t* hdr, lsm303_raw_t* smpl, uint16_t* used)
+{
+    // Garbage before sync
+    uint16_t s = 0U;
+    while (s + 1U < size && (buf[s] != LSM303_TLM_SYNC0 || buf[s + 1U] != LSM303_TLM_SYNC1)) ++s;
+    if (s + 1U >= size && (size == 0U || buf[size - 1U] != LSM303_TLM_SYNC0)) s = size;
+    *used = s;
+    if (s != 0U || size < LSM303_TLM_HDR_SIZE) return HAL_BUSY;
+
+    const uint16_t payload = get16(&buf[2]);
+    const uint8_t n = buf[7];
+    // Wrong size: skip sync to search the next packet
+    *used = 1U;
+    const uint16_t limit = LSM303_TLM_SIZE > LSM303_TLM_INSTR_SIZE ? LSM303_TLM_SIZE : LSM303_TLM_INSTR_SIZE;
+    if (payload > limit - LSM303_TLM_HDR_SIZE - 2U || n > LSM303_TLM_MAX) return HAL_ERROR;
+    const uint16_t end = LSM303_TLM_HDR_SIZE + payload;
+    if (size < end + 2U) {
+        *used = 0U;
+        return HAL_BUSY;
+    }
+    if (lsm303_tlm_crc(&buf[2], end - 2U) != get16(&buf[end])) return HAL_ERROR;
+
+    hdr->seq = get16(&buf[4]);
+    hdr->sensor = (lsm303_sensor_t)(buf[6] & 0x03U);
+    hdr->n = n;
+    hdr->instr = (buf[6] & LSM303_TLM_INSTR) != 0U ? 1U : 0U;
+    hdr->tick = get32(&buf[8]);
+    hdr->dt = get16(&buf[12]);
+    // Instrumentation counters are decoded by host script
+    if (hdr->instr != 0U) {
+        *used = end + 2U;
+        return HAL_OK;
+    }
+    int32_t prev[3] = { 0, 0, 0 };
+    uint16_t p = LSM303_TLM_HDR_SIZE;
+    for (uint8_t i = 0; i < n; ++i) {
+        for (uint8_t a = 0; a < 3U; ++a) {
+            uint32_t u = 0U;
+            uint8_t sh = 0U;
+            uint8_t b;
+            do {
+                if (p == end || sh > 14U) return HAL_ERROR;
+                b = buf[p++];
+                u |= (uint32_t)(b & 0x7FU) << sh;
+                sh += 7U;
+            } while (b & 0x80U);
+            prev[a] += (u & 1U) != 0U ? -(int32_t)((u + 1U) >> 1) : (int32_t)(u >> 1);
+        }
+        smpl[i].tick = hdr->tick + (uint32_t)i * hdr->dt;
+        smpl[i].x = (int16_t)prev[0];
+        smpl[i].y = (int16_t)prev[1];
+        smpl[i].z = (int16_t)prev[2];
+        smpl[i].sr = 0U;
+    }
+    if (p != end) return HAL_ERROR;
+    *used = end + 2U;
+    return HAL_OK;
+}
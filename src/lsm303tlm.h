@@ -0,0 +1,117 @@
+/// \file lsm303tlm.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_TLM_H__
+#define __LSM303_TLM_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303tlm 13. LSM303 Telemetry
+/// \brief Compact framed packets of raw samples
+/// \details Packet, all values are little-endian:
+/// | Offset | Size | Field                                                            |
+/// |--------|------|------------------------------------------------------------------|
+/// | 0      | 2    | Sync \c 0xAA \c 0x55                                             |
+/// | 2      | 2    | Payload size                                                     |
+/// | 4      | 2    | Sequence number                                                  |
+/// | 6      | 1    | Flags: bits \c 0..1 - sensor, bit \c 7 - instrumentation packet    |
+/// | 7      | 1    | Samples                                                          |
+/// | 8      | 4    | Tick of the first sample                                         |
+/// | 12     | 2    | Mean tick period of samples                                      |
+/// | 14     | n    | Payload: X, Y, Z of every sample, zigzag varint of delta to previous sample of the packet (first sample: to \c 0) |
+/// | 14 + n | 2    | CRC-16/CCITT-FALSE of bytes \c 2 .. \c 13 + n                     |
+/// \details Instrumentation packet has no samples, its payload is lsm303_instr_t counters (\b lsm303_tlm_instr):
+/// \c uint32_t samples, overrun, notready, period, intervals, imin, imax, \c LSM303_INSTR_BINS bins of histogram, reads,
+/// bus_max, \c uint64_t bus, \c uint32_t lat_n, lat_max, \c uint64_t lat. Tick is time of report.
+/// \details Slowly changing axes take 1 byte per value instead of 2 bytes of raw data or ~8 characters of text.
+/// Firmware sends packets by \b log_write (UART DMA), host decodes them by \b host/lsm303tlm.py or \b lsm303_tlm_parse
+
+#define LSM303_TLM_SYNC0 0xAAU      ///< First sync byte
+#define LSM303_TLM_SYNC1 0x55U      ///< Second sync byte
+#define LSM303_TLM_HDR_SIZE 14U     ///< Header size
+#define LSM303_TLM_INSTR 0x80U      ///< Flag of instrumentation packet
+
+/// \brief Max samples of packet
+/// \details Define it in build flags to override, up to \c 255
+/// \ingroup lsm303tlm
+#ifndef LSM303_TLM_MAX
+# define LSM303_TLM_MAX 32U
+#endif
+
+/// \brief Max packet size: varint of 16-bit delta takes up to 3 bytes
+/// \ingroup lsm303tlm
+#define LSM303_TLM_SIZE (LSM303_TLM_HDR_SIZE + 9U * LSM303_TLM_MAX + 2U)
+
+/// \brief Instrumentation packet size
+/// \ingroup lsm303tlm
+#define LSM303_TLM_INSTR_SIZE (LSM303_TLM_HDR_SIZE + 4U * (15U + LSM303_INSTR_BINS) + 2U)
+
+/// \brief Packet header
+/// \ingroup lsm303tlm
+typedef struct {
+    uint16_t seq;               ///< Sequence number
+    lsm303_sensor_t sensor;     ///< Sensor
+    uint8_t n;                  ///< Samples
+    uint8_t instr;              ///< Instrumentation packet: no samples
+    uint32_t tick;              ///< Tick of the first sample
+    uint16_t dt;                ///< Mean tick period of samples
+} lsm303_tlm_hdr_t;
+
+/// \brief Packet encoder state
+/// \ingroup lsm303tlm
+typedef struct {
+    lsm303_sensor_t sensor;         ///< Sensor
+    uint8_t block;                  ///< Samples of packet
+    uint8_t n;                      ///< Samples of current packet
+    uint16_t seq;                   ///< Sequence number of current packet
+    uint16_t pos;                   ///< Size of current packet
+    uint32_t tick;                  ///< Tick of the first sample
+    uint32_t last;                  ///< Tick of the last sample
+    int16_t prev[3];                ///< Previous sample
+    uint8_t buf[LSM303_TLM_SIZE];   ///< Packet
+} lsm303_tlm_t;
+
+/// \brief Packet encoder initialization
+/// \param t State pointer
+/// \param sensor Sensor
+/// \param block Samples of packet, \c 1 .. \c LSM303_TLM_MAX
+/// \return \c HAL_OK or \c HAL_ERROR for wrong parameters
+/// \ingroup lsm303tlm
+uint8_t lsm303_tlm_init(lsm303_tlm_t* t, const lsm303_sensor_t sensor, const uint8_t block);
+
+/// \brief Add sample to packet
+/// \param t State pointer
+/// \param smpl Raw sample (status register is not stored)
+/// \return Packet size if packet is complete (lsm303_tlm_t::buf, valid till the next call) or \c 0
+/// \ingroup lsm303tlm
+uint16_t lsm303_tlm_add(lsm303_tlm_t* t, const lsm303_raw_t* smpl);
+
+/// \brief Complete packet with less samples than block
+/// \param t State pointer
+/// \return Packet size (lsm303_tlm_t::buf, valid till the next call) or \c 0 if packet is empty
+/// \ingroup lsm303tlm
+uint16_t lsm303_tlm_flush(lsm303_tlm_t* t);
+
+/// \brief Instrumentation packet
+/// \details Packet takes the next sequence number of encoder: gaps of sequence are still detected by host
+/// \param t State pointer, sensor of encoder
+/// \param in Counters, e.g. by \b lsm303_instr
+/// \param tick Time of report
+/// \param buf Packet, \c LSM303_TLM_INSTR_SIZE bytes
+/// \return Packet size
+/// \ingroup lsm303tlm
+uint16_t lsm303_tlm_instr(lsm303_tlm_t* t, const lsm303_instr_t* in, const uint32_t tick, uint8_t* buf);
+
+/// \brief Parse packet
+/// \param buf Buffer
+/// \param size Buffer size
+/// \param hdr Header
+/// \param smpl Samples, \c LSM303_TLM_MAX items. Tick is interpolated by mean tick period. Instrumentation packet has no samples
+/// \param used Bytes to drop from buffer: packet size or garbage before sync
+/// \return \c HAL_OK - packet is parsed, \c HAL_BUSY - incomplete packet, \c HAL_ERROR - wrong packet (CRC or size)
+/// \ingroup lsm303tlm
+uint8_t lsm303_tlm_parse(const uint8_t* buf, const uint16_t size, lsm303_tlm_hdr_t* hdr, lsm303_raw_t* smpl, uint16_t* used);
+
+#endif // __LSM303_TLM_H__
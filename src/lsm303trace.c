@@ -0,0 +1,117 @@
+/// \file lsm303trace.c
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#include "lsm303trace.h"
+
+#include <string.h>
+
+static inline void put16(uint8_t* buf, const uint16_t v)
+{
+    buf[0] = (uint8_t)v;
+    buf[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t* buf, const uint32_t v)
+{
+    put16(&buf[0], (uint16_t)v);
+    put16(&buf[2], (uint16_t)(v >> 16));
+}
+
+static inline uint16_t get16(const uint8_t* buf)
+{
+    return (uint16_t)(buf[0] | buf[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t* buf)
+{
+    return (uint32_t)get16(&buf[0]) | (uint32_t)get16(&buf[2]) << 16;
+}
+
+static inline void putf(uint8_t* buf, const float v)
+{
+    uint32_t u;
+    memcpy(&u, &v, sizeof(u));
+    put32(buf, u);
+}
+
+static inline float getf(const uint8_t* buf)
+{
+    const uint32_t u = get32(buf);
+    float v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+uint16_t lsm303_trace_header(const lsm303_dev_t* dev, uint8_t* buf)
+{
+    put32(&buf[0], LSM303_TRACE_MAGIC);
+    buf[4] = LSM303_TRACE_VERSION;
+    buf[5] = buf[6] = buf[7] = 0U;
+    putf(&buf[8], dev->alsb);
+    putf(&buf[12], dev->mlsb_xy);
+    putf(&buf[16], dev->mlsb_z);
+    return LSM303_TRACE_HDR_SIZE;
+}
+
+uint8_t lsm303_trace_parse(const uint8_t* buf, const uint16_t size, lsm303_trace_hdr_t* hdr)
+{
+    if (size < LSM303_TRACE_HDR_SIZE || get32(&buf[0]) != LSM303_TRACE_MAGIC) return HAL_ERROR;
+    if (buf[4] != LSM303_TRACE_VERSION) return HAL_ERROR;
+    hdr->version = buf[4];
+    hdr->alsb = getf(&buf[8]);
+    hdr->mlsb_xy = getf(&buf[12]);
+    hdr->mlsb_z = getf(&buf[16]);
+    return HAL_OK;
+}
+
+void lsm303_trace_init(lsm303_trace_t* t)
+{
+    t->tick = 0U;
+    t->init = 0U;
+}
+
+uint16_t lsm303_trace_encode(lsm303_trace_t* t, const lsm303_sensor_t sensor, const lsm303_raw_t* smpl, uint8_t* buf)
+{
+    const uint32_t dt = smpl->tick - t->tick;
+    uint16_t i = 1U;
+    buf[0] = (uint8_t)sensor & 0x03U;
+    if (t->init == 0U || dt > 0xFFFFU) {
+        buf[0] |= LSM303_TRACE_TICK;
+        put32(&buf[i], smpl->tick);
+        i += 4U;
+    } else {
+        put16(&buf[i], (uint16_t)dt);
+        i += 2U;
+    }
+    put16(&buf[i], (uint16_t)smpl->x);
+    put16(&buf[i + 2U], (uint16_t)smpl->y);
+    put16(&buf[i + 4U], (uint16_t)smpl->z);
+    t->tick = smpl->tick;
+    t->init = 1U;
+    return i + 6U;
+}
+
+uint16_t lsm303_trace_decode(lsm303_trace_t* t, const uint8_t* buf, const uint16_t size, lsm303_sensor_t* sensor, lsm303_raw_t* smpl)
+{
+    if (size < 1U) return 0U;
+    const uint16_t n = (buf[0] & LSM303_TRACE_TICK) ? 11U : 9U;
+    if (size < n) return 0U;
+    uint16_t i = 1U;
+    if (buf[0] & LSM303_TRACE_TICK) {
+        t->tick = get32(&buf[i]);
+        i += 4U;
+    } else {
+        t->tick += get16(&buf[i]);
+        i += 2U;
+    }
+    *sensor = (lsm303_sensor_t)(buf[0] & 0x03U);
+    smpl->tick = t->tick;
+    smpl->x = (int16_t)get16(&buf[i]);
+    smpl->y = (int16_t)get16(&buf[i + 2U]);
+    smpl->z = (int16_t)get16(&buf[i + 4U]);
+    smpl->sr = 0U;
+    t->init = 1U;
+    return n;
+}
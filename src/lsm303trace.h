@@ -0,0 +1,82 @@
+/// \file lsm303trace.h
+/// \brief This file is part of LSM303DLHC Library for STM32 Nucleo L4
+/// \copyright &copy; https://github.com/Ilushenko Oleksandr Ilushenko
+///	\author Oleksandr Ilushenko
+///	\date 2024
+#ifndef __LSM303_TRACE_H__
+#define __LSM303_TRACE_H__
+
+#include "lsm303dlhc.h"
+
+/// \defgroup lsm303trace 5. LSM303 Trace
+/// \brief Binary trace of raw samples
+/// \details Trace is a header and records of raw samples, all values are little-endian.
+/// \details Header (\c LSM303_TRACE_HDR_SIZE bytes): magic \c "L303", version, 3 reserved bytes,
+/// \c float accelerometer \b g per LSB, \c float magnetometer LSB per \b gauss for X, Y and for Z axis.
+/// \details Record: flags byte (bits \c 0..1 - sensor, bit \c 7 - absolute tick), \c uint16 tick delta
+/// or \c uint32 absolute tick, \c int16 X, Y and Z raw data: 9 or 11 bytes.
+/// \details Firmware streams it by \b log_write or any other transport, host replays it through algorithmes
+
+#define LSM303_TRACE_MAGIC 0x3330334CUL    ///< \c "L303"
+#define LSM303_TRACE_VERSION 1U            ///< Trace format version
+#define LSM303_TRACE_HDR_SIZE 20U          ///< Header size
+#define LSM303_TRACE_REC_MAX 11U           ///< Max record size
+#define LSM303_TRACE_TICK 0x80U            ///< Record flag: absolute tick
+
+/// \brief Trace header
+/// \ingroup lsm303trace
+typedef struct {
+    uint8_t version;    ///< Trace format version
+    float alsb;         ///< Accelerometer \b g per LSB
+    float mlsb_xy;      ///< Magnetometer LSB per \b gauss for X, Y axis
+    float mlsb_z;       ///< Magnetometer LSB per \b gauss for Z axis
+} lsm303_trace_hdr_t;
+
+/// \brief Trace encoder / decoder state
+/// \ingroup lsm303trace
+typedef struct {
+    uint32_t tick;      ///< Tick of previous record
+    uint8_t init;       ///< Previous record exists
+} lsm303_trace_t;
+
+/// \brief Trace header
+/// \param dev Device handler: current scales
+/// \param buf Buffer of \c LSM303_TRACE_HDR_SIZE bytes
+/// \return Header size
+/// \ingroup lsm303trace
+uint16_t lsm303_trace_header(const lsm303_dev_t* dev, uint8_t* buf);
+
+/// \brief Parse trace header
+/// \param buf Buffer
+/// \param size Buffer size
+/// \param hdr Header
+/// \return \c HAL_OK or \c HAL_ERROR if buffer is not trace header
+/// \ingroup lsm303trace
+uint8_t lsm303_trace_parse(const uint8_t* buf, const uint16_t size, lsm303_trace_hdr_t* hdr);
+
+/// \brief Trace encoder / decoder initialization
+/// \details First record contains absolute tick
+/// \param t State pointer
+/// \ingroup lsm303trace
+void lsm303_trace_init(lsm303_trace_t* t);
+
+/// \brief Encode record
+/// \param t State pointer
+/// \param sensor Sensor
+/// \param smpl Raw sample (status register is not stored)
+/// \param buf Buffer of \c LSM303_TRACE_REC_MAX bytes
+/// \return Record size
+/// \ingroup lsm303trace
+uint16_t lsm303_trace_encode(lsm303_trace_t* t, const lsm303_sensor_t sensor, const lsm303_raw_t* smpl, uint8_t* buf);
+
+/// \brief Decode record
+/// \param t State pointer
+/// \param buf Buffer
+/// \param size Buffer size
+/// \param sensor Sensor
+/// \param smpl Raw sample
+/// \return Record size or \c 0U if buffer contains incomplete record
+/// \ingroup lsm303trace
+uint16_t lsm303_trace_decode(lsm303_trace_t* t, const uint8_t* buf, const uint16_t size, lsm303_sensor_t* sensor, lsm303_raw_t* smpl);
+
+#endif // __LSM303_TRACE_H__